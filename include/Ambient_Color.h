@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdint.h>
+
+// Ambient colour of the image on the panel, for the LED.
+//
+// While an image is decoded, every AMBIENT_STEP-th pixel of every
+// Row_Step-th row goes into a histogram of 8 x 8 x 8 buckets (the top three
+// bits of each channel) and into running channel sums. PNG rows are
+// sampled inside pngDraw's byte-swap loop and other formats as their rows
+// and blocks reach Image_Rows, so the image is never walked a second time.
+// Row_Step keeps the count under AMBIENT_MAX_ROWS rows, which bounds the
+// cost and keeps the 16-bit bucket counts from overflowing.
+//
+// At Image_End the fullest bucket that is not grey wins if it holds at
+// least 1 / AMBIENT_MIN_SHARE of the samples; otherwise the average colour
+// is used. Either is then scaled up until its largest channel is 255, so a
+// dark photo still gives a visible hue.
+#define AMBIENT_BUCKET_BITS  3
+#define AMBIENT_BUCKETS      (1 << (3 * AMBIENT_BUCKET_BITS))
+#define AMBIENT_STEP         4        // Every fourth pixel of a sampled row
+#define AMBIENT_MAX_ROWS     64
+#define AMBIENT_MIN_SHARE    16
+#define AMBIENT_DARK         16       // An average darker than this stays as it is
+
+struct Ambient_Histogram {
+  uint16_t Counts[AMBIENT_BUCKETS];
+  uint32_t Red;           // Sums of the 5/6/5-bit channels
+  uint32_t Green;
+  uint32_t Blue;
+  uint32_t Samples;
+  uint16_t Row_Step;
+  bool     Active;        // Between Ambient_Begin and Ambient_End
+};
+extern Ambient_Histogram Ambient_Hist;
+
+struct Ambient_Color {
+  bool    Valid;
+  uint8_t Red;
+  uint8_t Green;
+  uint8_t Blue;
+  uint8_t Share;          // Percent of samples in the winning bucket, 0 if the average was used
+};
+extern Ambient_Color Ambient_Last;
+
+void Ambient_Begin(uint16_t height);
+void Ambient_Block(int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t* pixels);
+bool Ambient_End();
+void Ambient_Clear();
+
+// For decoders that sample inside their own conversion loop: whether row y
+// is sampled, and one pixel as a native RGB565 value
+static inline bool Ambient_Row(int16_t y)
+{
+  return Ambient_Hist.Active && y % Ambient_Hist.Row_Step == 0;
+}
+
+static inline void Ambient_Add(uint16_t p)
+{
+  Ambient_Hist.Counts[((p >> 13) << 6) | (((p >> 8) & 7) << 3) | ((p >> 2) & 7)]++;
+  Ambient_Hist.Red += p >> 11;
+  Ambient_Hist.Green += (p >> 5) & 0x3F;
+  Ambient_Hist.Blue += p & 0x1F;
+  Ambient_Hist.Samples++;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "SD_Reader.h"
+#include "Display_ST7789.h"
+
+// Frame sequence (.bla) for short looping animations.
+//
+//   Anim_Header                      little-endian, 16 bytes
+//   uint32_t Offset[Frames + 1]      frame i is Offset[i]..Offset[i+1]
+//   frame data
+//
+// ANIM_CODEC_RAW frames are Width*Height RGB565 pixels. ANIM_CODEC_RLE
+// frames are ceil(Height / Strip_Rows) strips, each a uint16_t packed
+// length followed by one RLE block (Frame_Codec.h). Pixels are in panel
+// (big-endian) byte order. Build them with tools/blimage.py anim.
+#define ANIM_MAGIC         "BLA1"
+#define ANIM_CODEC_RAW     0
+#define ANIM_CODEC_RLE     1
+#define ANIM_MAX_FRAMES    512
+#define ANIM_STRIP_ROWS    16         // Largest Strip_Rows accepted
+#define ANIM_BUFFER_BYTES  (32 * 1024) // Per read-ahead buffer, two are used
+#define ANIM_SLIDE_MS      3000       // How long an animation plays as a slide
+
+struct __attribute__((packed)) Anim_Header {
+  char     Magic[4];
+  uint16_t Width;
+  uint16_t Height;
+  uint16_t Frames;
+  uint16_t Fps;
+  uint16_t Strip_Rows;
+  uint8_t  Codec;
+  uint8_t  Reserved;
+};
+
+// Result of the last Anim_Play
+struct Anim_Stats {
+  uint32_t Shown;         // Frames put on the panel
+  uint32_t Dropped;       // Frames skipped to keep up with the target rate
+  uint32_t Elapsed_Ms;
+  uint32_t Fps_x100;      // Achieved frame rate * 100
+  uint32_t Max_Late_Us;   // Worst lateness of a frame against its slot
+};
+extern Anim_Stats Anim_Last;
+
+bool Anim_Play(const char* filePath, uint32_t durationMs);
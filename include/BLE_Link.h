@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef ARDUINO
+#include <BLEDevice.h>
+#include <BLEServer.h>
+#endif
+
+// BLE connection manager.
+//
+// Up to BLE_LINK_MAX centrals may be connected; advertising restarts after
+// a connect while there is room and after a disconnect only if it had
+// stopped because every slot was taken. Each link is kept in one of two
+// modes:
+//   - fast: BLE_FAST_MIN..BLE_FAST_MAX interval, no peripheral latency, and
+//     the 2M PHY, from the connect and each color write until the link has
+//     been quiet for BLE_IDLE_AFTER_MS, so streamed colors are applied
+//     within one short interval
+//   - idle: BLE_IDLE_MIN..BLE_IDLE_MAX, fewer radio events while nothing is
+//     sent; the first write after idle waits at most one idle interval and
+//     switches the link back to fast at once
+// Intervals are in 1.25 ms units and the supervision timeout in 10 ms
+// units, as on the air. Centrals may refuse or round a request (iOS keeps
+// 15 ms as its shortest interval); what was actually negotiated is kept
+// per link, logged on every change and readable as text through the
+// telemetry characteristic.
+//
+// BLE_Link_Want is the pure policy and builds without ARDUINO.
+#define BLE_LINK_MAX       3
+#define BLE_LINK_MTU       185     // Local MTU offered in the exchange
+#define BLE_FAST_MIN       6       // 7.5 ms
+#define BLE_FAST_MAX       12      // 15 ms
+#define BLE_IDLE_MIN       48      // 60 ms
+#define BLE_IDLE_MAX       96      // 120 ms
+#define BLE_LINK_TIMEOUT   400     // 4 s
+#define BLE_IDLE_AFTER_MS  10000
+#define BLE_RETRY_MS       2000    // Hold between relaxing requests on one link
+
+#define BLE_LINK_DEFAULT   0       // Whatever the central chose
+#define BLE_LINK_FAST      1
+#define BLE_LINK_IDLE      2
+
+struct BLE_Link {
+  bool     Used;
+  uint16_t Conn_Id;
+  uint8_t  Address[6];
+  uint16_t Interval;        // Negotiated
+  uint16_t Latency;
+  uint16_t Timeout;
+  uint16_t Mtu;
+  uint8_t  Tx_Phy;          // 1 = 1M, 2 = 2M, 3 = coded
+  uint8_t  Rx_Phy;
+  uint8_t  Mode;            // BLE_LINK_* last requested
+  uint32_t Last_Active_Ms;  // Connect or last write
+  uint32_t Requested_Ms;
+  uint32_t Writes;
+  uint32_t Updates;         // Parameter updates completed
+};
+extern BLE_Link BLE_Links[BLE_LINK_MAX];
+
+uint8_t BLE_Link_Want(const BLE_Link& link, uint32_t nowMs);
+uint8_t BLE_Link_Count();
+size_t BLE_Link_Format(char* text, size_t size, const char* separator);
+
+#ifdef ARDUINO
+void BLE_Link_Begin(BLEServer* server, BLECharacteristic* telemetry);
+void BLE_Link_Connected(esp_ble_gatts_cb_param_t* param, uint32_t nowMs);
+void BLE_Link_Disconnected(esp_ble_gatts_cb_param_t* param);
+void BLE_Link_Mtu(esp_ble_gatts_cb_param_t* param);
+void BLE_Link_Write(uint16_t connId, uint32_t nowMs);
+void BLE_Link_Run(uint32_t nowMs);
+#endif
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "LCD_Image.h"
+
+// Serial console that runs canned workloads on the board.
+//
+// Type `bench <name> [runs]` (or `bench all`, `bench list`) at 115200 baud.
+// Each workload prints one line per measurement, prefixed so a script can
+// pick them out of the log:
+//
+//   BENCH fill n=20 min_us=14210 mean_us=14236 max_us=14290
+//
+// framed by `BENCH begin <name> build=<date time>` and `BENCH end <name>`,
+// so logs from different firmware builds on the same board and card can be
+// diffed. The panel workloads (fill, blit, decode, formats) live here; the
+// firmware registers its own (LVGL redraw, BLE loop-back) with
+// Bench_Register. A workload registered with draws = false only reports
+// what the firmware measured in normal running: the screen is left alone
+// and `bench all` skips it.
+#define BENCH_LINE_MAX      48
+#define BENCH_WORKLOADS_MAX 10
+#define BENCH_BLIT_ROWS     64        // Tallest strip in the blit workload
+
+struct Bench_Stats {
+  uint32_t Count;
+  uint32_t Min_Us;
+  uint32_t Max_Us;
+  uint64_t Total_Us;
+};
+
+typedef void (*Bench_Workload)(uint16_t runs);
+
+void Bench_Reset(Bench_Stats& stats);
+void Bench_Add(Bench_Stats& stats, uint32_t us);
+void Bench_Report(const char* name, const Bench_Stats& stats);
+void Bench_Register(const char* name, Bench_Workload workload, uint16_t runs, bool draws = true);
+void Bench_Begin(const char* directory, const char* fileExtension, void (*restore)());
+bool Bench_Command(const char* line);
+void Bench_Poll();
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "Display_ST7789.h"
+
+// Strip queue between the decoders and the panel.
+//
+// PNGdec hands over one row per callback and TJpgDec one MCU (8x8 or
+// 16x16) at a time. Sent as they come, each is its own LCD_Blit with a
+// transaction and an address window, and the decoder waits for it. The
+// queue copies rows and blocks into a strip of BLIT_QUEUE_ROWS rows and
+// sends the strip in one transfer when the next row or block falls outside
+// it, or at Blit_Queue_Flush; the decoder only waits on the panel once per
+// strip.
+//
+// Blocks must arrive in raster order of whole rows or whole MCU rows, as
+// both decoders deliver them, so a strip is always fully written when it
+// is sent. Whole strips or anything taller are sent straight away.
+//
+// Strips are sent synchronously; decode and transfer do not overlap. The
+// panel and the SD card share one SPI bus, driven by Arduino's SPIClass
+// (polled, no DMA), and the SD library holds the bus for every card read
+// the decoder makes. Overlapping them would need both devices moved to
+// the IDF spi_master driver, with queued DMA transactions for the panel.
+//
+// Built without ARDUINO there is no panel: transfers go to a stand-in set
+// with Blit_Queue_Panel, so the batching can be checked on the host.
+#define BLIT_QUEUE_ROWS   16      // At least the tallest JPEG MCU
+#define BLIT_QUEUE_WIDTH  LCD_HEIGHT
+
+struct Blit_Queue_Stats {
+  uint32_t Puts;          // Rows or blocks handed in
+  uint32_t Strips;        // Transfers sent from the strip
+  uint32_t Direct;        // Transfers that bypassed it
+};
+extern Blit_Queue_Stats Blit_Queue_Totals;
+
+void Blit_Queue_Enable(bool enable);
+bool Blit_Queue_Enabled();
+void Blit_Queue_Begin(int16_t x, int16_t y, int16_t width);
+void Blit_Queue_Put(int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t* pixels);
+void Blit_Queue_Flush();
+void Blit_Queue_ResetStats();
+
+#ifndef ARDUINO
+typedef void (*Blit_Queue_Sink)(int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t* pixels);
+void Blit_Queue_Panel(Blit_Queue_Sink panel);
+#endif
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <lvgl.h>
+#include "Display_ST7789.h"
+
+// Scanline compositor for the fixed LED-mode screen.
+//
+// The screen is a retained scene of a few rectangles (fill plus border) and
+// text runs over a solid background. Text is rasterised once, when it
+// changes, into 4-bit coverage indices with a 16-entry colour table, so a
+// row is composed from the scene by plain lookups. Each change marks only
+// the area it touches: a new fill colour the rectangle's interior, a new
+// label the columns and rows whose glyph coverage differs. Dash_Flush
+// composes just those areas, DASH_STRIP_ROWS rows at a time, and sends
+// each strip in one LCD_Blit. A colour-box change is a 96x96 transfer and
+// a digit change in a label a few hundred pixels, with no LVGL draw pass.
+//
+// LVGL still owns the panel for everything else. Whatever it flushes while
+// the scene is active is reported through Dash_Damage and repainted from
+// the scene on the next Dash_Flush.
+#define DASH_RECTS_MAX    4
+#define DASH_TEXTS_MAX    6
+#define DASH_TEXT_WIDTH   128     // Widest text run in pixels
+#define DASH_TEXT_HEIGHT  20      // Tallest font line
+#define DASH_TEXT_CHARS   24
+#define DASH_STRIP_ROWS   16
+
+struct Dash_Stats {
+  uint32_t Flushes;       // Dash_Flush calls that sent anything
+  uint32_t Strips;        // LCD_Blit transfers
+  uint32_t Pixels;        // Pixels sent
+};
+extern Dash_Stats Dash_Totals;
+
+// RGB888 to the native RGB565 value the scene stores
+static inline uint16_t Dash_Color(uint8_t r, uint8_t g, uint8_t b)
+{
+  return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+}
+
+void Dash_Begin(uint16_t background);
+void Dash_End();
+bool Dash_Active();
+int8_t Dash_Rect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t fill, uint16_t border, uint8_t borderWidth);
+void Dash_Rect_Fill(int8_t id, uint16_t fill);
+int8_t Dash_Text(int16_t x, int16_t y, const lv_font_t* font);
+void Dash_Text_Set(int8_t id, const char* text, uint16_t color);
+void Dash_Damage(int16_t x1, int16_t y1, int16_t x2, int16_t y2);
+void Dash_Flush();
@@ -1,10 +1,14 @@
 #pragma once
+#ifdef ARDUINO
 #include <Arduino.h>
 #include <SPI.h>
+#else
+#include <stdint.h>      // Host tests only need the geometry and the blit signature
+#endif
 #define LCD_WIDTH   172 //LCD width
 #define LCD_HEIGHT  320 //LCD height
 
-#define SPIFreq                        80000000
+#define SPIFreq                        80000000      // Default write clock; SPI_Clock may pick another
 #define EXAMPLE_PIN_NUM_MISO           5
 #define EXAMPLE_PIN_NUM_MOSI           6
 #define EXAMPLE_PIN_NUM_SCLK           7
@@ -18,14 +22,49 @@
 #define VERTICAL   0
 #define HORIZONTAL 1
 
+#define LCD_ROTATE_0     0 // Portrait, LCD_WIDTH x LCD_HEIGHT
+#define LCD_ROTATE_90    1 // Landscape, LCD_HEIGHT x LCD_WIDTH
+#define LCD_ROTATE_180   2
+#define LCD_ROTATE_270   3
+
 #define Offset_X 34
 #define Offset_Y 0
 
+#define LCD_PROBE_PIXELS    32       // Pattern length of the clock probe
+#define LCD_PROBE_READ_HZ   4000000  // ST7789 read cycle is far slower than its write cycle
+
+#define LCD_FILL_CHUNK 256 // Pixels per burst when filling a solid area
+
+extern uint32_t LCD_SPI_Hz;     // Write clock every panel transaction uses
+
 void SPI_Init();
+void LCD_SetClock(uint32_t Hz);
+bool LCD_Probe(uint32_t Hz, uint32_t* Check);
 
 void LCD_Init(void);
+void LCD_SetRotation(uint8_t Rotation);
+uint8_t LCD_GetRotation(void);
+uint16_t LCD_GetWidth(void);
+uint16_t LCD_GetHeight(void);
 void LCD_SetCursor(uint16_t Xstart, uint16_t Ystart, uint16_t Xend, uint16_t  Yend);
 void LCD_addWindow(uint16_t Xstart, uint16_t Ystart, uint16_t Xend, uint16_t Yend,uint16_t* color);
 
+// 2D primitives, all clipped to the panel. Colors are native RGB565,
+// blit pixels are in panel (big-endian) byte order.
+void LCD_FillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+void LCD_HLine(int16_t x, int16_t y, int16_t w, uint16_t color);
+void LCD_VLine(int16_t x, int16_t y, int16_t h, uint16_t color);
+void LCD_Clear(uint16_t color);
+void LCD_Blit(int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t* pixels);
+
+// Hardware vertical scrolling, portrait (LCD_ROTATE_0) only
+typedef void (*LCD_RowFill)(uint16_t ScreenRow, uint16_t* Pixels, void* Ctx);
+void LCD_ScrollArea(uint16_t Top, uint16_t Bottom);
+void LCD_ScrollTo(uint16_t Offset);
+uint16_t LCD_ScrollOffset(void);
+uint16_t LCD_ScrollMemoryRow(uint16_t ScreenRow);
+void LCD_ScrollUp(uint16_t Lines, LCD_RowFill Fill, void* Ctx);
+void LCD_ScrollOff(void);
+
 void Backlight_Init(void);
 void Set_Backlight(uint8_t Light);
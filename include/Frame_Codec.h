@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdint.h>
+
+// Pixel run-length codec for RGB565 blocks (.rle images, animation frames).
+//
+// A block is a sequence of packets, each starting with a control byte c:
+//   c <  0x80   c + 1 literal pixels follow (1..128)
+//   c >= 0x80   the next pixel repeats c - 0x80 + 2 times (2..129)
+// Pixels are two bytes in panel (big-endian) byte order and are copied as
+// they are, so the decoder never swaps or allocates. Encode with
+// tools/blimage.py rle.
+#define RLE_LITERAL_MAX  128
+#define RLE_REPEAT_MIN   2
+#define RLE_REPEAT_MAX   129
+
+// Worst case encoded size of a block of n pixels (all literals)
+#define RLE_MAX_BYTES(n) ((n) * 2 + ((n) + RLE_LITERAL_MAX - 1) / RLE_LITERAL_MAX)
+
+// Decode one block into exactly dstPixels pixels. Returns false if the
+// block is malformed or does not produce exactly dstPixels pixels.
+bool RLE_Decode(const uint8_t* src, uint32_t srcBytes, uint16_t* dst, uint32_t dstPixels);
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "Thumb_Cache.h"
+
+// Gallery: the catalog as a grid of thumbnails, drawn straight to the
+// portrait panel, GALLERY_COLS x GALLERY_ROWS to a page with a frame around
+// the selected one. A page costs a read of its thumbnail slots and one blit
+// per cell; a thumbnail not built yet shows as a placeholder until
+// Gallery_Refresh draws it. Moving the selection within a page only
+// redraws the two frames.
+#define GALLERY_COLS         3
+#define GALLERY_ROWS         5
+#define GALLERY_PAGE         (GALLERY_COLS * GALLERY_ROWS)
+#define GALLERY_CELL_WIDTH   (LCD_WIDTH / GALLERY_COLS)
+#define GALLERY_CELL_HEIGHT  (LCD_HEIGHT / GALLERY_ROWS)
+#define GALLERY_FRAME_WIDTH  2
+#define GALLERY_BACKGROUND   0x0000
+#define GALLERY_PLACEHOLDER  0x2945   // Dark grey
+#define GALLERY_FRAME        0xFFFF
+
+void Gallery_Show(uint16_t selected);
+void Gallery_Select(uint16_t selected);
+void Gallery_Refresh(uint16_t index);
+uint16_t Gallery_Selected();
+uint16_t Gallery_First();
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <lvgl.h>
+#include "LCD_Image.h"
+
+// PNG, JPEG and the raw formats as an LVGL image decoder. Images are decoded
+// once with Image_Capture into a portrait frame and kept in a small LRU cache,
+// so LVGL can redraw any part of a photo (e.g. under an overlay) from memory
+// instead of decoding the file again. Frames are in panel byte order, which
+// is LVGL's RGB565 layout with LV_COLOR_16_SWAP (lv_conf.h). LVGL's own image
+// cache stays off (LV_IMG_CACHE_DEF_SIZE 0): it reopens the image for every
+// draw and hits this cache.
+#define IMAGE_CACHE_BYTES   (LCD_WIDTH * LCD_HEIGHT * 3)  // A full-screen frame and a half
+#define IMAGE_CACHE_ENTRIES 4
+
+struct Image_Cache_Stats {
+  uint32_t Hits;
+  uint32_t Misses;      // Decoded from the card
+  uint32_t Evictions;
+};
+extern Image_Cache_Stats Image_Cache_Totals;
+
+void Image_Decoder_Init();
+bool Image_Cache_Load(const char* filePath, const Image_Info& info);
+void Image_Cache_Clear();
+
+// Show a slide through an lv_img; false if the format or memory does not allow it
+bool Image_Decoder_Show(lv_obj_t* image, const char* filePath, const Image_Info& info);
+void Image_Decoder_Hide(lv_obj_t* image);
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "SD_Reader.h"
+
+// Header-only image probe: reads the PNG IHDR, the JPEG SOF marker or the
+// header of our own formats to learn the format and size without decoding,
+// so the catalog can drop files that cannot be shown and layout can be
+// decided before a decoder is opened. The format comes from the file's
+// magic bytes, not its name.
+#define IMAGE_FORMAT_UNKNOWN  0
+#define IMAGE_FORMAT_PNG      1
+#define IMAGE_FORMAT_JPEG     2
+#define IMAGE_FORMAT_BLT      3   // Tiled_Image.h
+#define IMAGE_FORMAT_RGB565   4   // Raw_Image.h
+#define IMAGE_FORMAT_INDEXED  5
+#define IMAGE_FORMAT_RLE      6
+#define IMAGE_FORMAT_BLA      7   // Anim_Player.h
+
+#define IMAGE_INFO_INTERLACED  0x01   // Adam7 PNG
+#define IMAGE_INFO_PROGRESSIVE 0x02   // Progressive JPEG
+#define IMAGE_INFO_DITHER      0x04   // PNG named *.dither.png: dithered whatever Set_Image_Dither says
+#define IMAGE_INFO_NO_DITHER   0x08   // PNG named *.nodither.png: always truncated
+
+#define IMAGE_PROBE_JPEG_LIMIT 65536  // Give up looking for SOF past this offset
+
+struct Image_Info {
+  uint16_t Width;
+  uint16_t Height;
+  uint8_t  Bits;      // Bits per pixel as stored
+  uint8_t  Format;    // IMAGE_FORMAT_*
+  uint8_t  Flags;     // IMAGE_INFO_*
+  uint32_t File_Size; // Size and last write time of the file, so caches
+  uint32_t File_Time; // built from it can tell when it changed
+};
+
+bool Image_Probe(const char* filePath, Image_Info& info);
+const char* Image_Unusable(const Image_Info& info);   // Why it cannot be shown, nullptr if it can
+const char* Image_Format_Name(uint8_t format);        // "png", "jpg", "blt", ...
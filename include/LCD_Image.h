@@ -1,14 +1,55 @@
 #pragma once
 
 #include <PNGdec.h>
-#include "SD_Card.h"
+#include "SD_Reader.h"
+#include "Image_Probe.h"
 #include "Display_ST7789.h"
 
 #define BOOT_KEY_PIN     9
-#define MAX_IMAGE_WIDTH   172 // Adjust for your images
+#define MAX_IMAGE_WIDTH   LCD_HEIGHT // Widest line, a landscape image on the rotated panel
+#define LANDSCAPE_ROTATION LCD_ROTATE_90 // Panel rotation used for landscape images
+
+#define IMAGE_TRANSITION_NONE  0 // Draw in place
+#define IMAGE_TRANSITION_SLIDE 1 // Slide up from the bottom with hardware scrolling
+#define LETTERBOX_COLOR   0x0000 // Fill for the margins around smaller images
+
+#define IMAGE_BENCH_FORMATS 8 // Distinct formats tracked by Image_Benchmark
+
+// Cost of the last image shown by Show_Image
+struct Image_Stats {
+  const char* Format;     // File extension without the dot
+  uint32_t    Total_Us;   // Open to last row, the slide-change latency
+  uint32_t    Output_Us;  // Time spent sending rows to the panel
+  uint32_t    Read_Bytes; // Bytes read from the card
+  uint32_t    Card_Reads; // Card read transactions
+  bool        Reads_Counted; // False for JPEG: TJpgDec reads the file itself, past SD_Reader
+};
+extern Image_Stats Image_Last;
+
+// Receiver for Image_Stream
+struct Image_Sink {
+  void (*Begin)(int16_t width, int16_t height);                                   // Decoded size
+  void (*Block)(int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t* pixels);
+};
+extern Image_Info Image_Catalog[];  // Probed header of each SD_Image_Name entry
+extern uint32_t Image_Output_Us;  // Panel time for the current image
 
 void Search_Image(const char* directory, const char* fileExtension);
-void Show_Image(const char * filePath);
+uint8_t Image_Rotation(uint16_t width, uint16_t height);
+void Image_Begin(int16_t width, int16_t height);
+void Image_Rows(int16_t y, int16_t rows, int16_t width, const uint16_t* pixels);
+void Image_End(int16_t height);
+void Show_Image(const char * filePath, const Image_Info* info = nullptr);
+void Image_Output_Size(const Image_Info& info, uint16_t& width, uint16_t& height); // After JPEG scaling
+void Image_Frame_Size(const Image_Info& info, uint16_t& width, uint16_t& height);  // Portrait, clipped to the panel
+bool Image_Capturable(const Image_Info& info);
+bool Image_Capture(const char * filePath, const Image_Info& info, uint16_t* frame);
+bool Image_Stream(const char * filePath, const Image_Info& info, const Image_Sink& sink, uint8_t scale);
+void Image_Show_Frame(const uint16_t* frame, uint16_t width, uint16_t height);
+const Image_Info* Image_Select(const char* directory, const char* fileExtension, uint16_t ID, char* path, size_t size);
+void Set_Image_Transition(uint8_t Transition);
+bool Set_Image_Dither(bool Enabled);
+void Image_Benchmark(const char* directory, const char* fileExtension);
 void Display_Image(const char* directory, const char* fileExtension, uint16_t ID);
 void Image_Next(const char* directory, const char* fileExtension);
 void Image_Next_Loop(const char* directory, const char* fileExtension,uint32_t NextTime);
\ No newline at end of file
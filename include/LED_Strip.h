@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdint.h>
+
+// Addressable LED strip (WS2812 / SK6812, GRB, 800 kHz) driven from a frame
+// buffer.
+//
+// Effects and callers draw RGB triples into LED_Frame() in 8.8 fixed point,
+// so a fade keeps its fraction between whole levels. LED_Show() maps each
+// channel through a gamma 2.2 table, interpolated for the fraction, to 8.8
+// fixed-point light output, scales it by the global brightness and dithers
+// it down to 8 bits over time: every channel carries its remainder into the
+// next frame, so a level between two output steps is shown as the right mix
+// of both and dim fades do not visibly step. The result goes into one of two wire
+// buffers in strip (GRB) order and is queued on the RMT peripheral, then
+// LED_Show() returns: the transfer and the latch gap run in the background
+// while the next frame is rendered. LED_Show() only waits when both wire
+// buffers are still queued.
+//
+// Built without ARDUINO the output is a host stand-in that records every
+// shown frame to a file instead (see LED_Record), so effects and frame
+// timing can be checked offline with tools/ledrec.py.
+#define LED_STRIP_MAX_PIXELS 300
+#define LED_STRIP_RESET_US   300     // Latch gap after each frame (WS2812B needs 280)
+
+#define LED_EFFECT_SOLID     0       // Whole strip in the base colour
+#define LED_EFFECT_BREATHE   1       // Base colour pulsing over 2 s
+#define LED_EFFECT_CHASE     2       // Comet of the base colour running along the strip
+#define LED_EFFECT_WAVE      3       // Travelling brightness wave in the base colour
+#define LED_EFFECT_RAINBOW   4       // Scrolling rainbow, ignores the base colour
+
+struct LED_Stats {
+  uint32_t Frames;        // Frames queued by LED_Show
+  uint32_t Waits;         // LED_Show calls that had to wait for a free wire buffer
+  uint32_t Show_Us;       // Time spent in the last LED_Show
+  uint32_t Max_Show_Us;
+};
+extern LED_Stats LED_Last;
+
+bool LED_Begin(uint8_t pin, uint16_t count);
+uint16_t LED_Count();
+uint16_t* LED_Frame();                                        // Count * 3 channels, R G B in 8.8
+void LED_SetBrightness(uint8_t brightness);                   // 0..255, applied in LED_Show
+void LED_SetDither(bool enabled);                             // Off: round each frame on its own
+void LED_SetPixel(uint16_t index, uint16_t r, uint16_t g, uint16_t b); // 8.8, 0xFF00 is full
+void LED_Fill(uint16_t r, uint16_t g, uint16_t b);
+void LED_Render(uint8_t effect, uint16_t r, uint16_t g, uint16_t b, uint32_t nowMs);
+uint16_t LED_Light(uint16_t value);                           // Gamma of an 8.8 value, 8.8 light
+bool LED_Show();
+bool LED_Busy();                                              // A frame is still on the wire
+
+#ifndef ARDUINO
+// Append every shown frame to filePath as
+//   "LEDR" uint16_t Count                      file header, little-endian
+//   uint32_t Time_Us  GRB bytes[Count * 3]      per frame
+// nullptr stops recording and closes the file
+bool LED_Record(const char* filePath);
+#endif
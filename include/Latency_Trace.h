@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Command-to-photon latency of BLE color writes.
+//
+// A write is stamped when it arrives in onWrite (Latency_Command) and the
+// stamp travels with the command through the loop. Each stage records the
+// time since arrival once (Latency_Mark):
+//   pickup  - the loop starts handling the command
+//   led     - LED_Show has the first frame fading towards the new color
+//   screen  - the panel has it: the dashboard flush, or the last LVGL
+//             flush of the refresh that drew the new color
+//   settled - the fade has reached the color on the LEDs
+// Only the newest command is traced. One that arrives before the previous
+// reached every stage takes the trace over; the old one counts as
+// Superseded and its missing stages are not recorded.
+//
+// Each stage keeps a histogram of LATENCY_BUCKETS log2 buckets: bucket 0
+// holds 0-1 us, bucket b holds [2^b, 2^(b+1)) us, and the last also holds
+// everything above. Percentiles are interpolated inside their bucket and
+// capped at the largest sample. Builds without ARDUINO.
+#define LATENCY_BUCKETS 22        // Last bucket from 2^21 us, about 2 s
+#define LATENCY_TEXT_MAX 512      // Room for Latency_Format
+
+enum { LATENCY_PICKUP, LATENCY_LED, LATENCY_SCREEN, LATENCY_SETTLED, LATENCY_STAGES };
+
+struct Latency_Stage {
+  uint32_t Counts[LATENCY_BUCKETS];
+  uint32_t Samples;
+  uint32_t Max_Us;
+};
+
+struct Latency_Stats {
+  Latency_Stage Stages[LATENCY_STAGES];
+  uint32_t Commands;              // Writes stamped
+  uint32_t Superseded;            // Replaced before reaching every stage
+};
+extern Latency_Stats Latency_Totals;
+
+void Latency_Command(uint32_t nowUs);
+void Latency_Mark(uint8_t stage, uint32_t nowUs);
+uint32_t Latency_Percentile(const Latency_Stage& stage, uint8_t percent);
+size_t Latency_Format(char* text, size_t size, const char* prefix, const char* newline);
+void Latency_Reset();
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdint.h>
+
+// Memory accounting.
+//
+// Pools are named budgets (a static table, a cache malloc'd while an image
+// is open, the LVGL heap) with a capacity, current use and peak use. Fixed
+// buffers are defined once with Mem_Pool_Define(name, size, size); owners of
+// dynamic buffers report with Mem_Pool_Use as they allocate and free, and
+// pools managed elsewhere are copied in with Mem_Pool_Set.
+//
+// On the board Mem_Sample also tracks the heap low-water mark, the smallest
+// largest-free-block seen (fragmentation) and the stack high-water mark of
+// every watched task; Mem_Report prints all of it as "mem ..." lines.
+// Static symbols are reported at build time by tools/footprint.py.
+#define MEM_MAX_POOLS  16
+#define MEM_MAX_TASKS  6
+#define MEM_REPORT_MS  60000
+
+struct Mem_Pool {
+  const char* Name;
+  uint32_t Capacity;     // 0 = no fixed budget (heap-backed)
+  uint32_t Used;
+  uint32_t Peak;
+};
+
+void Mem_Pool_Define(const char* name, uint32_t capacity, uint32_t used = 0);
+void Mem_Pool_Use(const char* name, int32_t bytes);     // + on allocation, - on free
+void Mem_Pool_Set(const char* name, uint32_t used, uint32_t peak = 0);
+const Mem_Pool* Mem_Pool_Find(const char* name);
+uint8_t Mem_Pool_Count();
+const Mem_Pool* Mem_Pool_At(uint8_t index);
+
+#ifdef ARDUINO
+#include <Arduino.h>
+
+struct Mem_Heap {
+  uint32_t Size;
+  uint32_t Free;
+  uint32_t Min_Free;          // Low-water mark since boot
+  uint32_t Largest;           // Largest free block now
+  uint32_t Min_Largest;       // Smallest largest-block seen by Mem_Sample
+};
+extern Mem_Heap Mem_Heap_Last;
+
+void Mem_Watch_Task(TaskHandle_t task, const char* name);   // nullptr = calling task
+void Mem_Sample();
+void Mem_Report();
+#endif
@@ -12,6 +12,9 @@
 #include <lvgl.h>
 #include "SD_Card.h"
 #include "LCD_Image.h"
+#include "Image_Decoder.h"
+#include "State_Store.h"
+#include "Gallery.h"
 
 // External references to global variables from LCD_Image module
 extern uint16_t Image_CNT;
@@ -22,7 +25,15 @@ namespace PhotoViewer {
     bool initialized = false;
     int currentImageIndex = 0;
     const char* imageDirectory = "/";
-    const char* imageExtension = ".png";
+    const char* imageExtension = ".png|.jpg|.jpeg|.blt|.565|.p8|.rle|.bla";   // '|' separated list
+    lv_obj_t* photoImage = nullptr;   // LVGL image that holds decodable photos
+    bool layered = false;             // Current photo is in photoImage, so overlays can be drawn over it
+
+    // Show photos through an LVGL image from now on, nullptr to draw straight to the panel
+    void attach(lv_obj_t* image) {
+        photoImage = image;
+        layered = false;
+    }
 
     // Initialize SD card using SD_Card module
     bool initSD() {
@@ -47,8 +58,9 @@ namespace PhotoViewer {
             return false;
         }
         
-        Serial.println("Scanning for PNG images on SD card...");
+        Serial.println("Scanning for images on SD card...");
         Search_Image(imageDirectory, imageExtension);
+        Thumb_Begin(imageDirectory, imageExtension);
         
         Serial.printf("Found %d images\n", ::Image_CNT);
         return ::Image_CNT > 0;
@@ -66,8 +78,22 @@ namespace PhotoViewer {
             return false;
         }
         
-        // Use LCD_Image module to display the PNG
-        Display_Image(imageDirectory, imageExtension, imageIndex);
+        char path[200];
+        const Image_Info* info = Image_Select(imageDirectory, imageExtension, imageIndex, path, sizeof(path));
+        if (!info) {
+            return false;
+        }
+        Serial.printf("Show  : %s\n", path);
+        
+        // PNG, JPEG and raw go through the LVGL decoder; tiled and animated
+        // slides, or a frame that does not fit in memory, go to the panel
+        layered = photoImage && Image_Decoder_Show(photoImage, path, *info);
+        if (!layered) {
+            if (photoImage) {
+                Image_Decoder_Hide(photoImage);
+            }
+            Show_Image(path, info);
+        }
         
         return true;
     }
@@ -108,6 +134,28 @@ namespace PhotoViewer {
         return displayImage(0, parent);
     }
 
+    // Index of the image whose name hashes to nameHash; fallback (or the
+    // first image) if the card no longer has it
+    int findImage(uint32_t nameHash, int fallback) {
+        for (int i = 0; i < ::Image_CNT; i++) {
+            if (State_Hash(::SD_Image_Name[i]) == nameHash) {
+                return i;
+            }
+        }
+        return fallback < ::Image_CNT ? fallback : 0;
+    }
+
+    // Display a given image and continue the slideshow from it
+    bool showImageAt(int imageIndex, lv_obj_t* parent = nullptr) {
+        if (::Image_CNT == 0) {
+            Serial.println("No images to display");
+            return false;
+        }
+        
+        currentImageIndex = imageIndex % ::Image_CNT;
+        return displayImage(currentImageIndex, parent);
+    }
+
     // Check if images are available
     bool hasImages() {
         return ::Image_CNT > 0;
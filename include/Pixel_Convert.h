@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdint.h>
+
+// 24-bit to RGB565 line conversion, straight into panel byte order.
+//
+// Each channel goes through a lookup table indexed by the 8-bit value plus
+// a threshold. The table holds the channel's bits already shifted and
+// byte-swapped, so a pixel is three loads ORed together, and conversion,
+// byte swap and dither are one pass. With dither the threshold comes from a
+// 4x4 Bayer matrix at (x & 3, y & 3), scaled to the bits each channel
+// drops (0..7 for red and blue, 0..3 for green). A gradient then shows as a
+// fine fixed pattern instead of bands 8 (or 4) levels wide. Without dither
+// the threshold is 0 and the result is plain truncation, bit for bit what
+// PNGdec's getLineAsRGB565 gives. The tables are built by the compiler
+// and live in flash.
+#define PIXEL_BAYER_SIZE 4
+
+// A file can choose for itself by name, whatever the global setting:
+// photo.dither.png is always dithered, logo.nodither.png always truncated.
+// Case is ignored. Image_Probe turns the rule into IMAGE_INFO_DITHER or
+// IMAGE_INFO_NO_DITHER.
+#define PIXEL_DITHER_DEFAULT 0
+#define PIXEL_DITHER_ON      1
+#define PIXEL_DITHER_OFF     2
+
+void Pixel_Convert_RGB(const uint8_t* src, uint8_t stride, uint16_t* dst, uint16_t width, uint16_t y, bool dither);
+void Pixel_Convert_Indexed(const uint8_t* src, const uint8_t* palette, uint16_t* dst, uint16_t width, uint16_t y, bool dither);
+uint8_t Pixel_Dither_Rule(const char* filePath);
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stdint.h>
+
+// Power and performance governor.
+//
+// Once per loop the caller describes what is running or queued
+// (Power_Input) and the governor decides the CPU clock, the backlight
+// level and how to wait for the next loop:
+//   - decode, blend, UI redraws, a pending BLE command or a slide change
+//     due within POWER_RAMP_MS run at POWER_MHZ_BUSY, held for
+//     POWER_HOLD_MS after the work ends so bursts do not thrash the clock;
+//     everything else runs at POWER_MHZ_IDLE
+//   - while anything animates the loop runs every POWER_FRAME_MS; when
+//     idle it polls every POWER_POLL_MS, or sooner if work is due. The
+//     waits are delay(), where the FreeRTOS idle task halts the CPU
+//   - there is no light sleep: advertising runs whenever a link slot is
+//     free, and the BLE controller in the Arduino core cannot keep
+//     advertising or a link up through light sleep (that needs controller
+//     sleep and automatic light sleep, neither built into the core), so a
+//     sleeping board would stop answering BLE
+//   - the backlight steps down POWER_DIM_AFTER_MS and POWER_NIGHT_AFTER_MS
+//     after the last input and is restored by the next one
+//
+// Power_Decide is the pure policy and builds without ARDUINO, so it can be
+// driven by a recorded or simulated workload trace on the host; Power_Run
+// applies its decision on the board.
+#define POWER_MHZ_BUSY        160
+#define POWER_MHZ_IDLE        80      // Lowest clock that keeps SPI/RMT timing unchanged
+#define POWER_RAMP_MS         40      // Clock up this long before scheduled work
+#define POWER_HOLD_MS         500
+#define POWER_FRAME_MS        20
+#define POWER_POLL_MS         50
+#define POWER_BACKLIGHT_FULL  50      // Percent, as Set_Backlight
+#define POWER_DIM_AFTER_MS    120000
+#define POWER_BACKLIGHT_DIM   20
+#define POWER_NIGHT_AFTER_MS  600000
+#define POWER_BACKLIGHT_NIGHT 5
+#define POWER_REPORT_MS       60000
+
+#define POWER_WORK_DECODE     0x01    // Image decode running or queued
+#define POWER_WORK_BLEND      0x02    // Transition between images
+#define POWER_WORK_UI         0x04    // LVGL screen changing
+#define POWER_WORK_LED        0x08    // LED strip fading or animating
+#define POWER_NO_WORK         0xFFFFFFFF
+
+struct Power_Input {
+  uint32_t Now_Ms;
+  uint8_t  Work;            // POWER_WORK_* running now
+  uint32_t Next_Work_Ms;    // Time until the next scheduled work, POWER_NO_WORK if none
+  uint32_t Last_Input_Ms;   // Last button press, BLE connect or BLE command
+  bool     Ble_Pending;     // A BLE command arrived and is not applied yet
+};
+
+struct Power_Decision {
+  uint16_t Cpu_Mhz;
+  uint8_t  Backlight;       // Percent
+  uint32_t Wait_Ms;         // Until the next loop
+};
+
+// Time spent under each kind of decision, accumulated by Power_Decide
+struct Power_Stats {
+  uint32_t Busy_Ms;
+  uint32_t Idle_Ms;
+  uint32_t Clock_Changes;
+};
+
+struct Power_State {
+  uint32_t Busy_Until_Ms;
+  uint32_t Last_Ms;
+  Power_Decision Last;
+  Power_Stats Stats;
+};
+
+void Power_Reset(Power_State& state, uint32_t nowMs);
+Power_Decision Power_Decide(Power_State& state, const Power_Input& in);
+
+#ifdef ARDUINO
+extern Power_State Power_Governor;
+
+void Power_Begin();
+void Power_Run(const Power_Input& in);
+#endif
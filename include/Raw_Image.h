@@ -0,0 +1,35 @@
+#pragma once
+
+#include "SD_Reader.h"
+#include "Display_ST7789.h"
+
+// Uncompressed image formats, streamed to the panel one strip at a time.
+//
+//   .565  Raw_Header "B565", then Width*Height RGB565 pixels
+//   .p8   Raw_Header "BLP8", then a 256 entry RGB565 palette, then
+//         Width*Height palette indices (one byte per pixel)
+//
+//   .rle  Raw_Header "BLZ1", Raw_Rle_Info, uint32_t Offset[Strips + 1],
+//         then each strip of Strip_Rows rows as one RLE block (Frame_Codec.h)
+//
+// Header fields are little-endian, pixels and palette entries are in panel
+// (big-endian) byte order. Build them with tools/blimage.py raw / indexed / rle.
+#define RAW_MAGIC_RGB565   "B565"
+#define RAW_MAGIC_INDEXED  "BLP8"
+#define RAW_MAGIC_RLE      "BLZ1"
+#define RAW_PALETTE_SIZE   256
+#define RAW_STRIP_ROWS     16     // Rows read and sent per strip
+#define RAW_MAX_STRIPS     128    // Compressed strips per image
+
+struct __attribute__((packed)) Raw_Header {
+  char     Magic[4];
+  uint16_t Width;
+  uint16_t Height;
+};
+
+struct __attribute__((packed)) Raw_Rle_Info {
+  uint16_t Strip_Rows;
+  uint16_t Strips;
+};
+
+bool Show_Raw(const char* filePath);
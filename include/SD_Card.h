@@ -7,12 +7,26 @@
 // Digital I/O used
 #define SD_CS     4        //                SD_D3:
 
+#ifndef SD_MOUNT
+#define SD_MOUNT  "/sd"    // VFS mount point SD.begin registers the card under
+#endif
+#define SD_SPI_DEFAULT   80000000   // Clock when calibration cannot read the card
+#define SD_PROBE_SECTORS 8          // Sectors the clock probe reads besides the MBR
+#define SD_PATH_MAX 128    // Longest mount-qualified directory path SD_Enumerate accepts
+
+// Called by SD_Enumerate for each matching file name (no directory part);
+// return false to stop the walk
+typedef bool (*SD_Visitor)(const char* name, void* ctx);
+
 extern uint16_t SDCard_Size;
 extern uint16_t Flash_Size;
+extern uint32_t SD_SPI_Hz;
 
 void SD_Init();
 void Flash_test();
 
+int32_t SD_Enumerate(const char* directory, const char* fileExtension, SD_Visitor visit, void* ctx);
 bool File_Search(const char* directory, const char* fileName);
 uint16_t Folder_retrieval(const char* directory, const char* fileExtension, char File_Name[][100],uint16_t maxFiles);
+bool Match_Extension(const char* fileName, const char* extensions);
 void remove_file_extension(char *file_name);
\ No newline at end of file
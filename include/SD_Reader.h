@@ -0,0 +1,41 @@
+#pragma once
+
+#include "SD_Card.h"
+
+// Buffered reader over an SD file for decoders and streaming formats.
+//
+// Small reads are served from two sector-aligned blocks of SD_READER_BLOCK
+// bytes. A miss right after the last loaded block is a sequential stream,
+// so both blocks are filled in one card transfer (read-ahead of the next
+// block); any other miss loads one block into the least recently used
+// slot, which keeps the other one for seeks back into it. Reads of a block
+// or more skip the buffers and go to the card in one transfer. Seeks only
+// move the position; the card is not touched until data is needed.
+#define SD_READER_BLOCK 4096          // Multiple of the 512-byte sector
+
+struct SD_Reader {
+  File     Handle;
+  uint32_t Size;
+  uint32_t Position;                  // Next byte the caller will read
+  uint32_t Card_Position;             // Where the file on the card is positioned
+  uint8_t* Data;                      // Two blocks, contiguous so read-ahead is one transfer
+  uint32_t Start[2];
+  uint32_t Length[2];                 // 0 = slot empty
+  uint8_t  Recent;                    // Slot used last
+};
+
+// Card traffic since the last SD_Reader_ResetStats, summed over all readers
+struct SD_Reader_Stats {
+  uint32_t Reads;                     // Card read transactions
+  uint32_t Seeks;                     // Card seeks actually issued
+  uint32_t Bytes;                     // Bytes read from the card
+  uint32_t Hits;                      // Reads served entirely from the buffers
+};
+extern SD_Reader_Stats SD_Reader_Totals;
+
+bool SD_Reader_Open(SD_Reader& reader, const char* filePath);
+void SD_Reader_Close(SD_Reader& reader);
+bool SD_Reader_Seek(SD_Reader& reader, uint32_t position);
+int32_t SD_Reader_Read(SD_Reader& reader, void* buffer, uint32_t length);
+bool SD_Reader_ReadAt(SD_Reader& reader, uint32_t position, void* buffer, uint32_t length);
+void SD_Reader_ResetStats();
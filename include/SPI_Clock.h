@@ -0,0 +1,55 @@
+#pragma once
+
+#include <Arduino.h>
+
+// SPI clock calibration for the devices on the shared bus.
+//
+// Each device supplies a probe that moves one known block at a given clock
+// and returns its checksum. At startup the clocks of SPI_CLOCK_LADDER are
+// tried from the top; the first one whose probe repeats the checksum taken
+// at the bottom rung SPI_CLOCK_PASSES times in a row is kept, and stored in
+// NVS with that checksum. The next boot tries the stored clock first and
+// only climbs the ladder again if it no longer reads the stored block (a
+// different card, say). A device whose probe fails at the bottom rung
+// cannot be verified and keeps its default clock.
+//
+// At runtime a driver reports each failed transfer with SPI_Clock_Error.
+// After SPI_CLOCK_ERRORS in a row the device drops one rung; the switch
+// itself waits for SPI_Clock_Poll, since it may mean remounting the card.
+#define SPI_CLOCK_LADDER  { 80000000, 40000000, 26666667, 20000000, 16000000, 10000000 }   // 80 MHz / n
+#define SPI_CLOCK_STEPS   6
+#define SPI_CLOCK_PASSES  3       // Clean repeats a rung needs
+#define SPI_CLOCK_ERRORS  3       // Failed transfers in a row before stepping down
+#define SPI_CLOCK_NAMESPACE "spi_clock"
+#define SPI_CLOCK_HASH_SEED 2166136261u    // FNV-1a offset basis
+
+enum { SPI_CLOCK_SD, SPI_CLOCK_LCD, SPI_CLOCK_DEVICES };
+
+// Move the known block at hz; false if the transfer failed or the device
+// cannot be read back at all
+typedef bool (*SPI_Clock_Probe)(uint32_t hz, uint32_t* check);
+// Run the device at hz from now on
+typedef void (*SPI_Clock_Apply)(uint32_t hz);
+
+struct SPI_Clock_Device {
+  const char*     Name;
+  SPI_Clock_Apply Apply;
+  uint32_t        Hz;               // Clock in use
+  uint32_t        Reference;        // Checksum of the known block
+  uint32_t        Calibrate_Ms;     // Time the last calibration took
+  uint8_t         Errors;           // Failed transfers since the last good one
+  bool            Verified;         // Hz was read back; false = default kept
+  bool            Pending;          // Stepped down, Apply not yet run
+};
+extern SPI_Clock_Device SPI_Clock[SPI_CLOCK_DEVICES];
+
+uint32_t SPI_Clock_Hash(uint32_t hash, const uint8_t* data, uint32_t length);
+bool SPI_Clock_Calibrate(uint8_t device, const char* name, SPI_Clock_Probe probe, SPI_Clock_Apply apply, uint32_t defaultHz);
+void SPI_Clock_Error(uint8_t device);
+void SPI_Clock_Poll();
+
+// A transfer went through, the error run is over
+static inline void SPI_Clock_Good(uint8_t device)
+{
+  SPI_Clock[device].Errors = 0;
+}
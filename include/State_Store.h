@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Warm-resume state: mode, slide and last BLE color, kept in NVS so a power
+// cycle comes back where it left off.
+//
+// The loop hands the current state to State_Update every pass; it is only
+// marked dirty when it differs from what flash holds, and State_Run writes
+// a dirty snapshot at most once per Interval_Ms (STATE_WRITE_MS by
+// default), counted from boot. Over any run of T ms there are therefore at
+// most T / Interval_Ms writes, however often the state changes; a change
+// is lost only if power goes within one interval of it.
+//
+// The snapshot is one small blob with a version byte; a blob of another
+// version or size is ignored at boot. Storage goes through State_KV, so the
+// coalescing builds without ARDUINO and runs against a fake store on the
+// host; State_Nvs is the NVS (Preferences) store on the board.
+#define STATE_VERSION     1
+#define STATE_WRITE_MS    60000
+#define STATE_NAMESPACE   "blelights"
+#define STATE_KEY         "state"
+
+#define STATE_PHOTO_MODE  0x01    // Slideshow rather than the LED control screen
+#define STATE_BLE_COLOR   0x02    // Red/Green/Blue came from a central
+
+struct __attribute__((packed)) State_Snapshot {
+  uint8_t  Version;
+  uint8_t  Flags;           // STATE_*
+  uint8_t  Led_Effect;
+  uint8_t  Red;
+  uint8_t  Green;
+  uint8_t  Blue;
+  uint16_t Image_Index;
+  uint32_t Image_Hash;      // State_Hash of the file name, finds the slide if the card changed
+};
+
+struct State_KV {
+  bool (*Load)(void* data, size_t size);          // false if missing or a different size
+  bool (*Save)(const void* data, size_t size);
+};
+
+struct State_Store {
+  const State_KV* KV;
+  State_Snapshot Saved;     // What flash holds
+  State_Snapshot Pending;   // Latest from the loop
+  bool     Dirty;
+  uint32_t Interval_Ms;
+  uint32_t Last_Write_Ms;   // Boot, or the last write
+  uint32_t Writes;
+  uint32_t Failures;
+};
+
+bool State_Begin(State_Store& store, const State_KV* kv, uint32_t nowMs, State_Snapshot& restored);
+void State_Update(State_Store& store, const State_Snapshot& state);
+bool State_Run(State_Store& store, uint32_t nowMs);
+uint32_t State_Hash(const char* text);
+
+#ifdef ARDUINO
+extern const State_KV State_Nvs;
+#endif
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "LCD_Image.h"
+
+// Thumbnail cache on the card.
+//
+// Each catalog image gets a thumbnail of at most THUMB_SIZE x THUMB_SIZE
+// (aspect kept), box-filtered from the decoder's output as it streams past
+// (Image_Stream), so no full frame is ever held; JPEGs are decoded at the
+// smallest scale that still covers the thumbnail.
+//
+// THUMB_PIXELS_FILE holds THUMB_MAX fixed slots of THUMB_SIZE^2 raw RGB565
+// pixels in panel byte order, a thumbnail of w x h packed at the start of
+// its slot. THUMB_INDEX_FILE is a Thumb_Header followed by THUMB_MAX
+// Thumb_Entry, entry i describing slot i: the file it was made from (name
+// hash, size and last write time) and its size. An entry whose file has a
+// different size or time on the card is stale and its slot is rebuilt.
+// Pixels are written before the entry, so the index never points at a
+// slot that is not there yet.
+//
+// Thumb_Run builds one missing thumbnail per call and is meant to be called
+// from the loop while nothing else is going on; showing thumbnails only
+// costs a read of the slots with Thumb_Load.
+#define THUMB_SIZE          52
+#define THUMB_MAX           100        // Catalog entries, as SD_Image_Name
+#define THUMB_SLOT_BYTES    (THUMB_SIZE * THUMB_SIZE * sizeof(uint16_t))
+#define THUMB_DIRECTORY     "/.thumbs"
+#define THUMB_INDEX_FILE    "/.thumbs/index.bin"
+#define THUMB_PIXELS_FILE   "/.thumbs/thumbs.565"
+#define THUMB_MAGIC         "BLTC"
+#define THUMB_VERSION       1
+
+#define THUMB_MISSING       0xFF       // Thumb_Slot: not built yet
+#define THUMB_FAILED        0xFE       // Thumb_Slot: format without thumbnails, or the decode failed
+
+struct __attribute__((packed)) Thumb_Header {
+  char     Magic[4];
+  uint8_t  Version;
+  uint8_t  Size;          // THUMB_SIZE it was built with
+  uint16_t Count;         // THUMB_MAX
+};
+
+struct __attribute__((packed)) Thumb_Entry {
+  uint32_t Name_Hash;     // State_Hash of the file name, 0 = slot unused
+  uint32_t File_Size;
+  uint32_t File_Time;
+  uint16_t Width;
+  uint16_t Height;
+};
+
+struct Thumb_Stats {
+  uint16_t Cached;        // Valid at Thumb_Begin
+  uint16_t Built;
+  uint16_t Failed;
+  uint32_t Build_Ms;      // Total time spent building
+};
+extern Thumb_Stats Thumb_Totals;
+
+// Thumbnail for catalog entry index, pixels nullptr if there is none (yet)
+typedef void (*Thumb_Draw)(uint16_t index, const uint16_t* pixels, uint16_t width, uint16_t height);
+
+void Thumb_Size(uint16_t width, uint16_t height, uint16_t& thumbWidth, uint16_t& thumbHeight);
+void Thumb_Begin(const char* directory, const char* fileExtension);
+bool Thumb_Pending();
+int16_t Thumb_Run(uint16_t first);
+uint16_t Thumb_Load(uint16_t first, uint16_t count, Thumb_Draw draw);
@@ -0,0 +1,51 @@
+#pragma once
+
+#include "SD_Reader.h"
+#include "Display_ST7789.h"
+
+// Tiled image (.blt): random-access tiles so that only the part of a large
+// picture under the current viewport is read from the card.
+//
+//   Tiled_Header                          little-endian, 20 bytes
+//   uint32_t     Offset[Cols*Rows + 1]     tile i is Offset[i]..Offset[i+1]
+//   tile data                              row-major tile order
+//
+// Raw tiles are always Tile_W x Tile_H RGB565 pixels in panel (big-endian)
+// byte order; edge tiles are padded. Build them with tools/blimage.py tile.
+#define TILED_MAGIC        "BLT1"
+#define TILED_CODEC_RAW    0
+#define TILED_MAX_TILE     64     // Largest supported tile edge
+#define TILED_CACHE_TILES  12     // Decoded tiles kept while a file is open
+#define TILED_STRIP_ROWS   8      // Panel rows composed per blit
+#define TILED_KEN_BURNS_MS 1500   // Slow zoom on images larger than the panel, 0 = off
+#define TILED_SCROLL_PX_PER_S 160 // Hardware scroll speed through tall images, 0 = off
+
+struct __attribute__((packed)) Tiled_Header {
+  char     Magic[4];
+  uint16_t Width;
+  uint16_t Height;
+  uint16_t Tile_W;
+  uint16_t Tile_H;
+  uint16_t Cols;
+  uint16_t Rows;
+  uint8_t  Codec;
+  uint8_t  Reserved[3];
+};
+
+// Source window shown on the panel: top-left source pixel and the source
+// step per panel pixel in 16.16 fixed point (0x10000 = 1:1, 0x20000 = half size)
+struct Tiled_View {
+  int32_t  X;
+  int32_t  Y;
+  uint32_t Step;
+};
+
+bool Tiled_Open(const char* filePath);
+void Tiled_Close();
+uint16_t Tiled_Width();
+uint16_t Tiled_Height();
+Tiled_View Tiled_FitView();
+void Tiled_Draw(const Tiled_View& view);
+void Tiled_KenBurns(const Tiled_View& from, const Tiled_View& to, uint32_t durationMs);
+void Tiled_ScrollDown(const Tiled_View& view, uint16_t pixelsPerS);
+bool Show_Tiled(const char* filePath);
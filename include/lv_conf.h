@@ -72,6 +72,9 @@
 #define LV_IMG_CF_INDEXED   1
 #define LV_IMG_CF_ALPHA     1
 
+/* Photos are cached decoded by Image_Decoder, LVGL reopens them per draw */
+#define LV_IMG_CACHE_DEF_SIZE 0
+
 /* File system */
 #define LV_USE_FS_STDIO     0
 #define LV_USE_FS_POSIX     0
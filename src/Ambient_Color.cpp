@@ -0,0 +1,88 @@
+#include "Ambient_Color.h"
+
+#include <string.h>
+
+Ambient_Histogram Ambient_Hist;
+Ambient_Color Ambient_Last;
+
+// Start sampling an image of the given height; the previous colour is dropped
+void Ambient_Begin(uint16_t height)
+{
+  memset(&Ambient_Hist, 0, sizeof(Ambient_Hist));
+  Ambient_Hist.Row_Step = (height + AMBIENT_MAX_ROWS - 1) / AMBIENT_MAX_ROWS;   // No denser than across a row
+  if (Ambient_Hist.Row_Step < AMBIENT_STEP)
+    Ambient_Hist.Row_Step = AMBIENT_STEP;
+  Ambient_Hist.Active = true;
+  Ambient_Last.Valid = false;
+}
+
+// A block of w x h pixels at (x, y) in panel byte order
+void Ambient_Block(int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t* pixels)
+{
+  if (!Ambient_Hist.Active)
+    return;
+  int16_t r = (Ambient_Hist.Row_Step - y % Ambient_Hist.Row_Step) % Ambient_Hist.Row_Step;
+  for (; r < h; r += Ambient_Hist.Row_Step) {
+    const uint16_t* row = pixels + (int32_t)r * w;
+    for (int16_t c = (AMBIENT_STEP - x % AMBIENT_STEP) % AMBIENT_STEP; c < w; c += AMBIENT_STEP)
+      Ambient_Add((row[c] >> 8) | (row[c] << 8));
+  }
+}
+
+static bool Ambient_Grey(uint16_t bucket)
+{
+  uint8_t r = bucket >> 6, g = (bucket >> 3) & 7, b = bucket & 7;
+  uint8_t hi = r > g ? (r > b ? r : b) : (g > b ? g : b);
+  uint8_t lo = r < g ? (r < b ? r : b) : (g < b ? g : b);
+  return hi - lo <= 1;
+}
+
+/******************************************************************************
+function: Pick the colour of the image sampled since Ambient_Begin
+return    : Whether Ambient_Last holds a colour (false if nothing was sampled)
+******************************************************************************/
+bool Ambient_End()
+{
+  if (!Ambient_Hist.Active)
+    return false;
+  Ambient_Hist.Active = false;
+  uint32_t n = Ambient_Hist.Samples;
+  if (!n)
+    return false;
+
+  uint16_t best = 0;
+  for (uint16_t b = 1; b < AMBIENT_BUCKETS; b++)
+    if (!Ambient_Grey(b) && (Ambient_Grey(best) || Ambient_Hist.Counts[b] > Ambient_Hist.Counts[best]))
+      best = b;
+
+  Ambient_Color color = {};
+  uint32_t count = Ambient_Grey(best) ? 0 : Ambient_Hist.Counts[best];
+  if (count * AMBIENT_MIN_SHARE >= n) {
+    uint8_t half = 1 << (7 - AMBIENT_BUCKET_BITS);                         // Bucket centre
+    color.Red = ((best >> 6) << (8 - AMBIENT_BUCKET_BITS)) | half;
+    color.Green = (((best >> 3) & 7) << (8 - AMBIENT_BUCKET_BITS)) | half;
+    color.Blue = ((best & 7) << (8 - AMBIENT_BUCKET_BITS)) | half;
+    color.Share = count * 100 / n;
+  } else {
+    color.Red = Ambient_Hist.Red * 255 / (31 * n);
+    color.Green = Ambient_Hist.Green * 255 / (63 * n);
+    color.Blue = Ambient_Hist.Blue * 255 / (31 * n);
+  }
+
+  uint8_t peak = color.Red > color.Green ? (color.Red > color.Blue ? color.Red : color.Blue)
+                                         : (color.Green > color.Blue ? color.Green : color.Blue);
+  if (peak >= AMBIENT_DARK) {
+    color.Red = color.Red * 255 / peak;
+    color.Green = color.Green * 255 / peak;
+    color.Blue = color.Blue * 255 / peak;
+  }
+  color.Valid = true;
+  Ambient_Last = color;
+  return true;
+}
+
+// Stop sampling without a result; Ambient_Last is kept
+void Ambient_Clear()
+{
+  Ambient_Hist.Active = false;
+}
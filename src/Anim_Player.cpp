@@ -0,0 +1,196 @@
+#include "Anim_Player.h"
+#include "Frame_Codec.h"
+#include "LCD_Image.h"
+#include "Mem_Budget.h"
+#include "Blit_Queue.h"
+
+Anim_Stats Anim_Last;
+
+static SD_Reader Anim_File;
+static Anim_Header Anim_Hdr;
+static uint32_t Anim_Offset[ANIM_MAX_FRAMES + 1];
+static uint16_t Anim_Strip[ANIM_STRIP_ROWS * MAX_IMAGE_WIDTH];
+
+// One read-ahead slot. Frames larger than the buffer are not loaded ahead
+// (Size stays 0) and are streamed from the card while they are shown.
+struct Anim_Buffer {
+  uint8_t* Data;
+  uint32_t Size;
+  uint16_t Frame;
+};
+
+static bool Anim_Read(void* dst, uint32_t position, uint32_t length)
+{
+  return SD_Reader_ReadAt(Anim_File, position, dst, length);
+}
+
+static bool Anim_Load(Anim_Buffer& buf, uint16_t frame)
+{
+  uint32_t size = Anim_Offset[frame + 1] - Anim_Offset[frame];
+  buf.Frame = frame;
+  buf.Size = 0;
+  if (size > ANIM_BUFFER_BYTES)
+    return true;
+  buf.Size = size;
+  return Anim_Read(buf.Data, Anim_Offset[frame], size);
+}
+
+// Put a frame on the panel. scratch is the other read-ahead buffer, which
+// is free while a frame is shown and holds streamed strips.
+static bool Anim_Show(const Anim_Buffer& buf, uint8_t* scratch)
+{
+  const uint16_t width = Anim_Hdr.Width;
+  const uint16_t stripRows = Anim_Hdr.Codec == ANIM_CODEC_RLE ? Anim_Hdr.Strip_Rows : ANIM_STRIP_ROWS;
+  const bool buffered = buf.Size > 0;
+  const uint8_t* p = buf.Data;
+  const uint8_t* end = buf.Data + buf.Size;
+  uint32_t position = Anim_Offset[buf.Frame];
+
+  for (uint16_t y = 0; y < Anim_Hdr.Height; y += stripRows) {
+    uint16_t rows = Anim_Hdr.Height - y < stripRows ? Anim_Hdr.Height - y : stripRows;
+    uint32_t count = (uint32_t)rows * width;
+
+    if (Anim_Hdr.Codec == ANIM_CODEC_RAW) {
+      const uint16_t* pixels = (const uint16_t*)p;
+      if (buffered) {
+        if ((uint32_t)(end - p) < count * 2) return false;
+        p += count * 2;
+      } else {
+        if (!Anim_Read(Anim_Strip, position, count * 2)) return false;
+        position += count * 2;
+        pixels = Anim_Strip;
+      }
+      Image_Rows(y, rows, width, pixels);
+      continue;
+    }
+
+    uint16_t packed;
+    const uint8_t* block;
+    if (buffered) {
+      if (end - p < 2) return false;
+      memcpy(&packed, p, 2);
+      block = p + 2;
+      p += 2 + packed;
+      if (p > end) return false;
+    } else {
+      if (!Anim_Read(&packed, position, 2) || packed > ANIM_BUFFER_BYTES ||
+          !Anim_Read(scratch, position + 2, packed))
+        return false;
+      position += 2 + packed;
+      block = scratch;
+    }
+    if (!RLE_Decode(block, packed, Anim_Strip, count))
+      return false;
+    Image_Rows(y, rows, width, Anim_Strip);
+  }
+  Blit_Queue_Flush();                                       // Short RLE strips are queued, the frame must not wait for the next
+  return true;
+}
+
+static bool Anim_Open(const char* filePath)
+{
+  if (!SD_Reader_Open(Anim_File, filePath)) {
+    printf("Anim: cannot open %s\r\n", filePath);
+    return false;
+  }
+  bool ok = Anim_Read(&Anim_Hdr, 0, sizeof(Anim_Hdr)) &&
+            memcmp(Anim_Hdr.Magic, ANIM_MAGIC, 4) == 0 &&
+            Anim_Hdr.Width > 0 && Anim_Hdr.Width <= MAX_IMAGE_WIDTH &&
+            Anim_Hdr.Frames > 0 && Anim_Hdr.Frames <= ANIM_MAX_FRAMES &&
+            Anim_Hdr.Fps > 0 && Anim_Hdr.Fps <= 60 &&
+            (Anim_Hdr.Codec == ANIM_CODEC_RAW ||
+             (Anim_Hdr.Codec == ANIM_CODEC_RLE && Anim_Hdr.Strip_Rows > 0 && Anim_Hdr.Strip_Rows <= ANIM_STRIP_ROWS)) &&
+            Anim_Read(Anim_Offset, sizeof(Anim_Hdr), (Anim_Hdr.Frames + 1) * sizeof(uint32_t));
+  if (!ok) {
+    printf("Anim: %s is not a supported animation\r\n", filePath);
+    SD_Reader_Close(Anim_File);
+  }
+  return ok;
+}
+
+/******************************************************************************
+function: Play an animation at its own frame rate
+parameter :
+    filePath   :   .bla file
+    durationMs :   Play time, the sequence loops until it runs out
+note      :   Frames are double-buffered: as soon as one frame is on the
+              panel the next is read into the other buffer, during the slack
+              before its slot. If showing a frame overruns, the frames whose
+              slots have passed are dropped so the sequence keeps wall-clock
+              time. The achieved rate is left in Anim_Last.
+******************************************************************************/
+bool Anim_Play(const char* filePath, uint32_t durationMs)
+{
+  if (!Anim_Open(filePath))
+    return false;
+
+  Anim_Buffer bufs[2];
+  bufs[0].Data = (uint8_t*)malloc(ANIM_BUFFER_BYTES);
+  bufs[1].Data = (uint8_t*)malloc(ANIM_BUFFER_BYTES);
+  if (!bufs[0].Data || !bufs[1].Data) {
+    printf("Anim: no memory for read-ahead buffers\r\n");
+    free(bufs[0].Data);
+    free(bufs[1].Data);
+    SD_Reader_Close(Anim_File);
+    return false;
+  }
+  Mem_Pool_Use("anim_buffers", 2 * ANIM_BUFFER_BYTES);
+  printf("animation: (%d x %d), %d frames at %d fps, %s\r\n", Anim_Hdr.Width, Anim_Hdr.Height,
+         Anim_Hdr.Frames, Anim_Hdr.Fps, Anim_Hdr.Codec == ANIM_CODEC_RLE ? "RLE" : "raw");
+
+  const uint32_t period = 1000000UL / Anim_Hdr.Fps;
+  Anim_Stats stats = {};
+  uint8_t cur = 0;
+  bool ok = Anim_Load(bufs[0], 0);
+  if (ok) {
+    Image_Begin(Anim_Hdr.Width, Anim_Hdr.Height);
+    ok = Anim_Show(bufs[0], bufs[1].Data);
+    Image_End(Anim_Hdr.Height);
+    stats.Shown = 1;
+  }
+
+  uint32_t start = micros();
+  uint32_t slot = 0;
+  while (ok && micros() - start < durationMs * 1000UL) {
+    // Fell behind: skip straight to the slot we are already in
+    uint32_t next = slot + 1;
+    uint32_t current = (micros() - start) / period;
+    if (current > next) {
+      stats.Dropped += current - next;
+      next = current;
+    }
+
+    uint8_t other = cur ^ 1;
+    if (!Anim_Load(bufs[other], next % Anim_Hdr.Frames))
+      break;
+
+    uint32_t due = next * period;
+    for (;;) {
+      uint32_t now = micros() - start;
+      if (now >= due) break;
+      if (due - now > 2000) delay(1);                              // Let the idle task run
+    }
+    uint32_t late = (micros() - start) - due;
+    if (late > stats.Max_Late_Us) stats.Max_Late_Us = late;
+
+    ok = Anim_Show(bufs[other], bufs[cur].Data);
+    cur = other;
+    slot = next;
+    stats.Shown++;
+  }
+
+  stats.Elapsed_Ms = (micros() - start) / 1000;
+  stats.Fps_x100 = stats.Elapsed_Ms ? stats.Shown * 100000UL / stats.Elapsed_Ms : 0;
+  Anim_Last = stats;
+  printf("anim: %lu shown, %lu dropped, %lu.%02lu fps (target %d), worst late %lu us\r\n",
+         (unsigned long)stats.Shown, (unsigned long)stats.Dropped, (unsigned long)(stats.Fps_x100 / 100),
+         (unsigned long)(stats.Fps_x100 % 100), Anim_Hdr.Fps, (unsigned long)stats.Max_Late_Us);
+  if (!ok)
+    printf("Anim: %s is truncated or corrupt\r\n", filePath);
+
+  free(bufs[0].Data);
+  free(bufs[1].Data);
+  Mem_Pool_Use("anim_buffers", -2 * ANIM_BUFFER_BYTES);
+  SD_Reader_Close(Anim_File);
+  return stats.Shown > 0;
+}
@@ -0,0 +1,197 @@
+#include "BLE_Link.h"
+
+#include <stdio.h>
+#include <string.h>
+
+BLE_Link BLE_Links[BLE_LINK_MAX];
+
+uint8_t BLE_Link_Want(const BLE_Link& link, uint32_t nowMs)
+{
+  if (!link.Used)
+    return BLE_LINK_DEFAULT;
+  if (nowMs - link.Last_Active_Ms < BLE_IDLE_AFTER_MS)
+    return BLE_LINK_FAST;
+  return BLE_LINK_IDLE;
+}
+
+uint8_t BLE_Link_Count()
+{
+  uint8_t count = 0;
+  for (const BLE_Link& link : BLE_Links)
+    if (link.Used) count++;
+  return count;
+}
+
+// One entry per link, each followed by separator:
+// "0: 7.50 ms, latency 0, timeout 4000 ms, mtu 185, phy 2M/2M, fast"
+size_t BLE_Link_Format(char* text, size_t size, const char* separator)
+{
+  static const char* phys[] = { "?", "1M", "2M", "coded" };
+  static const char* modes[] = { "default", "fast", "idle" };
+  size_t used = 0;
+  if (size)
+    text[0] = '\0';
+  for (uint8_t i = 0; i < BLE_LINK_MAX; i++) {
+    const BLE_Link& link = BLE_Links[i];
+    if (!link.Used || used >= size)
+      continue;
+    int n = snprintf(text + used, size - used, "%u: %u.%02u ms, latency %u, timeout %u ms, mtu %u, phy %s/%s, %s%s",
+                     i, link.Interval * 125 / 100, link.Interval * 125 % 100, link.Latency, link.Timeout * 10,
+                     link.Mtu, phys[link.Tx_Phy & 3], phys[link.Rx_Phy & 3], modes[link.Mode], separator);
+    if (n > 0)
+      used += (size_t)n < size - used ? n : size - used - 1;
+  }
+  return used;
+}
+
+#ifdef ARDUINO
+
+static BLEServer* BLE_Server = nullptr;
+static BLECharacteristic* BLE_Telemetry = nullptr;
+static volatile bool BLE_Link_Changed = false;
+
+static BLE_Link* BLE_Link_Find(const uint8_t* address)
+{
+  for (BLE_Link& link : BLE_Links)
+    if (link.Used && memcmp(link.Address, address, sizeof(link.Address)) == 0)
+      return &link;
+  return nullptr;
+}
+
+// Connection parameter and PHY updates arrive as GAP events, keyed by address
+static void BLE_Link_Gap(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t* param)
+{
+  if (event == ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT) {
+    BLE_Link* link = BLE_Link_Find(param->update_conn_params.bda);
+    if (!link)
+      return;
+    if (param->update_conn_params.status == ESP_BT_STATUS_SUCCESS) {
+      link->Interval = param->update_conn_params.conn_int;
+      link->Latency = param->update_conn_params.latency;
+      link->Timeout = param->update_conn_params.timeout;
+      link->Updates++;
+    }
+    BLE_Link_Changed = true;
+  }
+#if CONFIG_BT_BLE_50_FEATURES_SUPPORTED
+  else if (event == ESP_GAP_BLE_PHY_UPDATE_COMPLETE_EVT) {
+    BLE_Link* link = BLE_Link_Find(param->phy_update.bda);
+    if (link && param->phy_update.status == ESP_BT_STATUS_SUCCESS) {
+      link->Tx_Phy = param->phy_update.tx_phy;
+      link->Rx_Phy = param->phy_update.rx_phy;
+      BLE_Link_Changed = true;
+    }
+  }
+#endif
+}
+
+void BLE_Link_Begin(BLEServer* server, BLECharacteristic* telemetry)
+{
+  BLE_Server = server;
+  BLE_Telemetry = telemetry;
+  memset(BLE_Links, 0, sizeof(BLE_Links));
+  BLEDevice::setMTU(BLE_LINK_MTU);
+  BLEDevice::setCustomGapHandler(BLE_Link_Gap);
+}
+
+void BLE_Link_Connected(esp_ble_gatts_cb_param_t* param, uint32_t nowMs)
+{
+  BLE_Link* link = nullptr;
+  for (BLE_Link& slot : BLE_Links)
+    if (!slot.Used) { link = &slot; break; }
+  if (link) {
+    memset(link, 0, sizeof(*link));
+    link->Used = true;
+    link->Conn_Id = param->connect.conn_id;
+    memcpy(link->Address, param->connect.remote_bda, sizeof(link->Address));
+    link->Interval = param->connect.conn_params.interval;
+    link->Latency = param->connect.conn_params.latency;
+    link->Timeout = param->connect.conn_params.timeout;
+    link->Mtu = 23;                                         // Until the exchange
+    link->Tx_Phy = link->Rx_Phy = 1;
+    link->Last_Active_Ms = nowMs;                           // An app that just connected is about to send
+    BLE_Link_Changed = true;
+  }
+  // The controller stops advertising on a connection
+  if (BLE_Link_Count() < BLE_LINK_MAX)
+    BLEDevice::startAdvertising();
+}
+
+void BLE_Link_Disconnected(esp_ble_gatts_cb_param_t* param)
+{
+  bool full = BLE_Link_Count() == BLE_LINK_MAX;
+  for (BLE_Link& link : BLE_Links)
+    if (link.Used && link.Conn_Id == param->disconnect.conn_id)
+      link.Used = false;
+  BLE_Link_Changed = true;
+  // Still advertising unless every slot was taken
+  if (full)
+    BLEDevice::startAdvertising();
+}
+
+void BLE_Link_Mtu(esp_ble_gatts_cb_param_t* param)
+{
+  for (BLE_Link& link : BLE_Links)
+    if (link.Used && link.Conn_Id == param->mtu.conn_id)
+      link.Mtu = param->mtu.mtu;
+  BLE_Link_Changed = true;
+}
+
+void BLE_Link_Write(uint16_t connId, uint32_t nowMs)
+{
+  for (BLE_Link& link : BLE_Links) {
+    if (link.Used && link.Conn_Id == connId) {
+      link.Last_Active_Ms = nowMs;
+      link.Writes++;
+    }
+  }
+}
+
+static void BLE_Link_Request(BLE_Link& link, uint8_t mode, uint32_t nowMs)
+{
+  bool fast = mode == BLE_LINK_FAST;
+  BLE_Server->updateConnParams(link.Address, fast ? BLE_FAST_MIN : BLE_IDLE_MIN, fast ? BLE_FAST_MAX : BLE_IDLE_MAX,
+                               0, BLE_LINK_TIMEOUT);
+#if CONFIG_BT_BLE_50_FEATURES_SUPPORTED
+  if (fast && link.Tx_Phy != ESP_BLE_GAP_PHY_2M)
+    esp_ble_gap_set_preferred_phy(link.Address, 0, ESP_BLE_GAP_PHY_2M_PREF_MASK, ESP_BLE_GAP_PHY_2M_PREF_MASK,
+                                  ESP_BLE_GAP_PHY_OPTIONS_NO_PREF);
+#endif
+  link.Mode = mode;
+  link.Requested_Ms = nowMs;
+}
+
+/******************************************************************************
+function: Move links between fast and idle, and publish what was negotiated
+parameter:
+    nowMs : millis()
+note     : Called from the loop; the BLE callbacks only record events, the
+           requests and the telemetry write happen here.
+******************************************************************************/
+void BLE_Link_Run(uint32_t nowMs)
+{
+  if (!BLE_Server)
+    return;
+  for (BLE_Link& link : BLE_Links) {
+    uint8_t want = BLE_Link_Want(link, nowMs);
+    if (!link.Used || want == link.Mode)
+      continue;
+    // A write on a relaxed link is served at once, relaxing can wait
+    if (want != BLE_LINK_FAST && link.Requested_Ms && nowMs - link.Requested_Ms < BLE_RETRY_MS)
+      continue;
+    BLE_Link_Request(link, want, nowMs);
+  }
+
+  if (BLE_Link_Changed) {
+    BLE_Link_Changed = false;
+    char text[BLE_LINK_MAX * 72];
+    BLE_Link_Format(text, sizeof(text), "\r\n");
+    printf("ble links %u\r\n%s", BLE_Link_Count(), text);
+    if (BLE_Telemetry) {
+      BLE_Link_Format(text, sizeof(text), "\n");
+      BLE_Telemetry->setValue(text);
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,255 @@
+#include "Bench_Console.h"
+
+extern uint16_t Image_CNT;
+
+struct Bench_Entry {
+  const char*    Name;
+  Bench_Workload Workload;
+  uint16_t       Runs;      // Used when the command gives none
+  bool           Draws;     // Paints the panel; false for reports
+};
+static Bench_Entry Bench_Workloads[BENCH_WORKLOADS_MAX];
+static uint8_t Bench_Count = 0;
+static const char* Bench_Directory = "/";
+static const char* Bench_Extension = "";
+static void (*Bench_Restore)() = nullptr;      // Puts the screen back after a workload drew over it
+static char Bench_Line[BENCH_LINE_MAX];
+static uint8_t Bench_Length = 0;
+
+void Bench_Reset(Bench_Stats& stats)
+{
+  stats.Count = 0;
+  stats.Min_Us = UINT32_MAX;
+  stats.Max_Us = 0;
+  stats.Total_Us = 0;
+}
+
+void Bench_Add(Bench_Stats& stats, uint32_t us)
+{
+  stats.Count++;
+  stats.Total_Us += us;
+  if (us < stats.Min_Us) stats.Min_Us = us;
+  if (us > stats.Max_Us) stats.Max_Us = us;
+}
+
+void Bench_Report(const char* name, const Bench_Stats& stats)
+{
+  if (!stats.Count) {
+    printf("BENCH %s n=0\r\n", name);
+    return;
+  }
+  printf("BENCH %s n=%lu min_us=%lu mean_us=%lu max_us=%lu\r\n", name, (unsigned long)stats.Count,
+         (unsigned long)stats.Min_Us, (unsigned long)(stats.Total_Us / stats.Count), (unsigned long)stats.Max_Us);
+}
+
+void Bench_Register(const char* name, Bench_Workload workload, uint16_t runs, bool draws)
+{
+  if (Bench_Count >= BENCH_WORKLOADS_MAX) {
+    printf("bench: no room for %s\r\n", name);
+    return;
+  }
+  Bench_Workloads[Bench_Count++] = { name, workload, runs, draws };
+}
+
+// Full-screen solid fills, alternating colors so every run writes the panel
+static void Bench_Fill(uint16_t runs)
+{
+  Bench_Stats stats;
+  Bench_Reset(stats);
+  LCD_SetRotation(LCD_ROTATE_0);
+  for (uint16_t i = 0; i < runs; i++) {
+    uint32_t t = micros();
+    LCD_Clear(i & 1 ? 0xFFFF : 0x0000);
+    Bench_Add(stats, micros() - t);
+  }
+  Bench_Report("fill", stats);
+}
+
+// Full-width strips of several heights, the sizes the decoders and the blit queue send
+static void Bench_Blit(uint16_t runs)
+{
+  static const uint8_t heights[] = { 1, 16, BENCH_BLIT_ROWS };
+  uint16_t* strip = (uint16_t*)malloc(LCD_WIDTH * BENCH_BLIT_ROWS * sizeof(uint16_t));
+  if (!strip) {
+    printf("bench: no memory for the blit strip\r\n");
+    return;
+  }
+  for (uint32_t i = 0; i < LCD_WIDTH * BENCH_BLIT_ROWS; i++)
+    strip[i] = (uint16_t)(i * 2654435761u >> 16);
+  LCD_SetRotation(LCD_ROTATE_0);
+  for (uint8_t h : heights) {
+    Bench_Stats stats;
+    Bench_Reset(stats);
+    for (uint16_t i = 0; i < runs; i++) {
+      int16_t y = (i * h) % (LCD_HEIGHT - h + 1);
+      uint32_t t = micros();
+      LCD_Blit(0, y, LCD_WIDTH, h, strip);
+      Bench_Add(stats, micros() - t);
+    }
+    char name[24];
+    snprintf(name, sizeof(name), "blit_%dx%d", LCD_WIDTH, h);
+    Bench_Report(name, stats);
+  }
+  free(strip);
+}
+
+/******************************************************************************
+function: Show every catalog image and report latency per format and overall
+parameter:
+    runs : Passes over the catalog
+******************************************************************************/
+static void Bench_Decode(uint16_t runs)
+{
+  struct Format_Stats { const char* Format; Bench_Stats Stats; };
+  Format_Stats formats[IMAGE_BENCH_FORMATS];
+  uint8_t count = 0;
+  Bench_Stats all;
+  Bench_Reset(all);
+
+  char path[200];
+  Image_Select(Bench_Directory, Bench_Extension, 0, path, sizeof(path));          // Scans the card if needed
+  for (uint16_t pass = 0; pass < runs; pass++) {
+    for (uint16_t i = 0; i < Image_CNT; i++) {
+      Image_Select(Bench_Directory, Bench_Extension, i, path, sizeof(path));
+      Image_Last.Format = nullptr;
+      Show_Image(path, &Image_Catalog[i]);
+      if (!Image_Last.Format)
+        continue;                                              // Not shown
+      Bench_Add(all, Image_Last.Total_Us);
+      uint8_t f = 0;
+      while (f < count && strcmp(formats[f].Format, Image_Last.Format) != 0)
+        f++;
+      if (f == count) {
+        if (count == IMAGE_BENCH_FORMATS)
+          continue;
+        formats[count].Format = Image_Last.Format;
+        Bench_Reset(formats[count++].Stats);
+      }
+      Bench_Add(formats[f].Stats, Image_Last.Total_Us);
+    }
+  }
+  for (uint8_t f = 0; f < count; f++) {
+    char name[24];
+    snprintf(name, sizeof(name), "decode_%s", formats[f].Format);
+    Bench_Report(name, formats[f].Stats);
+  }
+  Bench_Report("decode", all);
+}
+
+// Catalog PNGs decoded with plain truncation and with ordered dither, the cost of the dither
+static void Bench_Dither(uint16_t runs)
+{
+  Bench_Stats plain, dither;
+  Bench_Reset(plain);
+  Bench_Reset(dither);
+  char path[200];
+  Image_Select(Bench_Directory, Bench_Extension, 0, path, sizeof(path));
+  bool previous = Set_Image_Dither(false);
+  for (uint16_t pass = 0; pass < runs; pass++) {
+    for (uint16_t i = 0; i < Image_CNT; i++) {
+      if (Image_Catalog[i].Format != IMAGE_FORMAT_PNG)
+        continue;
+      Image_Select(Bench_Directory, Bench_Extension, i, path, sizeof(path));
+      Image_Info info = Image_Catalog[i];
+      info.Flags &= ~(IMAGE_INFO_DITHER | IMAGE_INFO_NO_DITHER);
+      for (uint8_t on = 0; on < 2; on++) {
+        Set_Image_Dither(on);
+        Image_Last.Format = nullptr;
+        Show_Image(path, &info);
+        if (Image_Last.Format)
+          Bench_Add(on ? dither : plain, Image_Last.Total_Us);
+      }
+    }
+  }
+  Set_Image_Dither(previous);
+  Bench_Report("png_truncate", plain);
+  Bench_Report("png_dither", dither);
+}
+
+// Image_Benchmark's per-format breakdown, decode-only and unqueued passes included
+static void Bench_Formats(uint16_t runs)
+{
+  Image_Benchmark(Bench_Directory, Bench_Extension);
+}
+
+/******************************************************************************
+function: Register the panel workloads and start listening on the console
+parameter:
+    directory, fileExtension : Catalog the decode workloads show
+    restore                  : Called after a command, to redraw what the
+                               workloads painted over
+******************************************************************************/
+void Bench_Begin(const char* directory, const char* fileExtension, void (*restore)())
+{
+  Bench_Directory = directory;
+  Bench_Extension = fileExtension;
+  Bench_Restore = restore;
+  Bench_Register("fill", Bench_Fill, 20);
+  Bench_Register("blit", Bench_Blit, 100);
+  Bench_Register("decode", Bench_Decode, 1);
+  Bench_Register("formats", Bench_Formats, 1);
+  Bench_Register("dither", Bench_Dither, 1);
+}
+
+static void Bench_Run(const Bench_Entry& entry, uint16_t runs)
+{
+  char build[24];
+  snprintf(build, sizeof(build), "%s_%s", __DATE__, __TIME__);
+  for (char* c = build; *c; c++)
+    if (*c == ' ') *c = '_';                                   // One token for the parser
+  printf("BENCH begin %s build=%s runs=%u\r\n", entry.Name, build, runs ? runs : entry.Runs);
+  entry.Workload(runs ? runs : entry.Runs);
+  printf("BENCH end %s\r\n", entry.Name);
+}
+
+/******************************************************************************
+function: Run one console command
+parameter:
+    line : "bench <name|all|list> [runs]"
+return    : Whether the line was a bench command
+******************************************************************************/
+bool Bench_Command(const char* line)
+{
+  char name[16] = "";
+  unsigned runs = 0;
+  if (sscanf(line, "bench %15s %u", name, &runs) < 1)
+    return false;
+  if (strcmp(name, "list") == 0) {
+    for (uint8_t i = 0; i < Bench_Count; i++)
+      printf("BENCH workload %s runs=%u\r\n", Bench_Workloads[i].Name, Bench_Workloads[i].Runs);
+    return true;
+  }
+  bool all = strcmp(name, "all") == 0, found = false, drew = false;
+  for (uint8_t i = 0; i < Bench_Count; i++) {
+    // "all" leaves out formats, which repeats decode at greater length, and the reports
+    const Bench_Entry& entry = Bench_Workloads[i];
+    if (all ? entry.Draws && strcmp(entry.Name, "formats") != 0 : strcmp(entry.Name, name) == 0) {
+      Bench_Run(entry, runs);
+      found = true;
+      drew |= entry.Draws;
+    }
+  }
+  if (!found)
+    printf("bench: unknown workload %s, try bench list\r\n", name);
+  else if (drew && Bench_Restore)
+    Bench_Restore();
+  return true;
+}
+
+// Collect a console line without blocking; runs it once Enter arrives
+void Bench_Poll()
+{
+  while (Serial.available() > 0) {
+    int c = Serial.read();
+    if (c == '\r' || c == '\n') {
+      if (Bench_Length) {
+        Bench_Line[Bench_Length] = '\0';
+        Bench_Length = 0;
+        if (!Bench_Command(Bench_Line))
+          printf("unknown command: %s\r\n", Bench_Line);
+      }
+    } else if (c >= 0 && Bench_Length < BENCH_LINE_MAX - 1) {
+      Bench_Line[Bench_Length++] = (char)c;
+    }
+  }
+}
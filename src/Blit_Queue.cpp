@@ -0,0 +1,102 @@
+#include "Blit_Queue.h"
+
+#include <string.h>
+
+static uint16_t Queue_Strip[BLIT_QUEUE_ROWS * BLIT_QUEUE_WIDTH];
+static bool Queue_Enabled = true;
+static int16_t Queue_X = 0;           // Panel position of the image
+static int16_t Queue_Y = 0;
+static int16_t Queue_Width = 0;       // Image width, the strip's row stride
+static int16_t Strip_Top = 0;         // First image row in the strip
+static int16_t Strip_Bottom = 0;      // One past the last row written, Strip_Top if empty
+Blit_Queue_Stats Blit_Queue_Totals;
+
+#ifdef ARDUINO
+#define Queue_Send LCD_Blit
+#else
+static Blit_Queue_Sink Queue_Panel = nullptr;
+
+// Stand-in panel for host builds, see Blit_Queue_Panel
+void Blit_Queue_Panel(Blit_Queue_Sink panel)
+{
+  Queue_Panel = panel;
+}
+
+static void Queue_Send(int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t* pixels)
+{
+  if (Queue_Panel)
+    Queue_Panel(x, y, w, h, pixels);
+}
+#endif
+
+// Off sends every row and block straight to the panel, for comparison
+void Blit_Queue_Enable(bool enable)
+{
+  Blit_Queue_Flush();
+  Queue_Enabled = enable;
+}
+
+bool Blit_Queue_Enabled()
+{
+  return Queue_Enabled;
+}
+
+/******************************************************************************
+function: Start queueing an image
+parameter:
+    x, y  : Panel position of the image's top-left corner
+    width : Image width in pixels, at most BLIT_QUEUE_WIDTH to be queued
+******************************************************************************/
+void Blit_Queue_Begin(int16_t x, int16_t y, int16_t width)
+{
+  Blit_Queue_Flush();
+  Queue_X = x;
+  Queue_Y = y;
+  Queue_Width = width;
+  Strip_Top = Strip_Bottom = 0;
+}
+
+// Send the rows collected so far
+void Blit_Queue_Flush()
+{
+  if (Strip_Bottom <= Strip_Top)
+    return;
+  Queue_Send(Queue_X, Queue_Y + Strip_Top, Queue_Width, Strip_Bottom - Strip_Top, Queue_Strip);
+  Blit_Queue_Totals.Strips++;
+  Strip_Top = Strip_Bottom;
+}
+
+/******************************************************************************
+function: Queue a block of the image
+parameter:
+    x, y   : Position in the image
+    w, h   : Size of the block
+    pixels : w*h pixels in panel byte order, free to reuse on return
+******************************************************************************/
+void Blit_Queue_Put(int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t* pixels)
+{
+  Blit_Queue_Totals.Puts++;
+  // Full-width strips from the raw and animation readers are already as batched as they get
+  bool strip = x == 0 && w == Queue_Width && h >= BLIT_QUEUE_ROWS;
+  if (!Queue_Enabled || strip || h > BLIT_QUEUE_ROWS || Queue_Width > BLIT_QUEUE_WIDTH || x < 0 || x + w > Queue_Width) {
+    Blit_Queue_Flush();
+    Queue_Send(Queue_X + x, Queue_Y + y, w, h, pixels);
+    Blit_Queue_Totals.Direct++;
+    return;
+  }
+  // A block below the strip (or above it, which raster order rules out) starts a new one
+  if (Strip_Bottom == Strip_Top || y < Strip_Top || y + h > Strip_Top + BLIT_QUEUE_ROWS) {
+    Blit_Queue_Flush();
+    Strip_Top = Strip_Bottom = y;
+  }
+  uint16_t* dst = Queue_Strip + (y - Strip_Top) * Queue_Width + x;
+  for (int16_t r = 0; r < h; r++, dst += Queue_Width, pixels += w)
+    memcpy(dst, pixels, w * sizeof(uint16_t));
+  if (y + h > Strip_Bottom)
+    Strip_Bottom = y + h;
+}
+
+void Blit_Queue_ResetStats()
+{
+  memset(&Blit_Queue_Totals, 0, sizeof(Blit_Queue_Totals));
+}
@@ -0,0 +1,306 @@
+#include "Dashboard.h"
+#include "Mem_Budget.h"
+
+#include <string.h>
+
+struct Dash_Area {
+  int16_t X1, Y1, X2, Y2;   // Inclusive, empty while X2 < X1
+};
+
+struct Dash_Box {
+  Dash_Area Box;
+  uint16_t  Fill;         // Native RGB565
+  uint16_t  Border;
+  uint8_t   Border_Width;
+  Dash_Area Dirty;
+};
+
+struct Dash_Run {
+  int16_t          X, Y;
+  const lv_font_t* Font;
+  char             Text[DASH_TEXT_CHARS];
+  uint16_t         Color;
+  uint16_t         Lut[16];                                   // Coverage over the background, panel byte order
+  uint8_t          Cover[DASH_TEXT_HEIGHT][DASH_TEXT_WIDTH];  // 4-bit glyph coverage
+  Dash_Area        Dirty;
+};
+
+static Dash_Box Dash_Boxes[DASH_RECTS_MAX];
+static Dash_Run Dash_Runs[DASH_TEXTS_MAX];
+static uint8_t Box_Count = 0;
+static uint8_t Run_Count = 0;
+static uint16_t Dash_Background = 0;
+static bool Dash_On = false;
+static Dash_Area Dash_Damaged;
+static uint16_t Dash_Strip[DASH_STRIP_ROWS * LCD_WIDTH];
+static uint8_t Dash_Glyphs[DASH_TEXT_HEIGHT][DASH_TEXT_WIDTH];   // A new text, before it is diffed
+Dash_Stats Dash_Totals;
+
+static const Dash_Area Area_None = { 0, 0, -1, -1 };
+
+static void Area_Add(Dash_Area& area, int16_t x1, int16_t y1, int16_t x2, int16_t y2)
+{
+  if (x1 < 0) x1 = 0;
+  if (y1 < 0) y1 = 0;
+  if (x2 >= LCD_WIDTH) x2 = LCD_WIDTH - 1;
+  if (y2 >= LCD_HEIGHT) y2 = LCD_HEIGHT - 1;
+  if (x2 < x1 || y2 < y1)
+    return;
+  if (area.X2 < area.X1) {
+    area = { x1, y1, x2, y2 };
+    return;
+  }
+  if (x1 < area.X1) area.X1 = x1;
+  if (y1 < area.Y1) area.Y1 = y1;
+  if (x2 > area.X2) area.X2 = x2;
+  if (y2 > area.Y2) area.Y2 = y2;
+}
+
+static uint16_t Panel_Order(uint16_t color)
+{
+  return (color >> 8) | (color << 8);
+}
+
+// Start a new scene; the whole screen is painted on the next Dash_Flush
+void Dash_Begin(uint16_t background)
+{
+  Box_Count = Run_Count = 0;
+  Dash_Background = background;
+  Dash_Damaged = Area_None;
+  Area_Add(Dash_Damaged, 0, 0, LCD_WIDTH - 1, LCD_HEIGHT - 1);
+  Dash_On = true;
+  Mem_Pool_Define("dashboard", sizeof(Dash_Runs) + sizeof(Dash_Strip) + sizeof(Dash_Glyphs),
+                  sizeof(Dash_Runs) + sizeof(Dash_Strip) + sizeof(Dash_Glyphs));
+}
+
+// Leave the panel to LVGL
+void Dash_End()
+{
+  Dash_On = false;
+}
+
+bool Dash_Active()
+{
+  return Dash_On;
+}
+
+/******************************************************************************
+function: Add a rectangle to the scene
+parameter:
+    x, y, w, h   : Outer bounds on the portrait panel
+    fill, border : Native RGB565 colours
+    borderWidth  : Border thickness in pixels, 0 for none
+return   : Id for Dash_Rect_Fill, -1 if the scene is full
+******************************************************************************/
+int8_t Dash_Rect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t fill, uint16_t border, uint8_t borderWidth)
+{
+  if (Box_Count == DASH_RECTS_MAX)
+    return -1;
+  Dash_Box& box = Dash_Boxes[Box_Count];
+  box.Box = { x, y, (int16_t)(x + w - 1), (int16_t)(y + h - 1) };
+  box.Fill = fill;
+  box.Border = border;
+  box.Border_Width = borderWidth;
+  box.Dirty = Area_None;
+  Area_Add(box.Dirty, box.Box.X1, box.Box.Y1, box.Box.X2, box.Box.Y2);
+  return Box_Count++;
+}
+
+// A new fill repaints the interior only
+void Dash_Rect_Fill(int8_t id, uint16_t fill)
+{
+  if (id < 0 || id >= Box_Count || Dash_Boxes[id].Fill == fill)
+    return;
+  Dash_Box& box = Dash_Boxes[id];
+  box.Fill = fill;
+  Area_Add(box.Dirty, box.Box.X1 + box.Border_Width, box.Box.Y1 + box.Border_Width,
+           box.Box.X2 - box.Border_Width, box.Box.Y2 - box.Border_Width);
+}
+
+// Text run with its top-left corner at (x, y), empty until Dash_Text_Set
+int8_t Dash_Text(int16_t x, int16_t y, const lv_font_t* font)
+{
+  if (Run_Count == DASH_TEXTS_MAX || font->line_height > DASH_TEXT_HEIGHT)
+    return -1;
+  Dash_Run& run = Dash_Runs[Run_Count];
+  run.X = x;
+  run.Y = y;
+  run.Font = font;
+  run.Text[0] = '\0';
+  run.Color = Dash_Background;
+  for (uint8_t i = 0; i < 16; i++)
+    run.Lut[i] = Panel_Order(Dash_Background);
+  memset(run.Cover, 0, sizeof(run.Cover));
+  run.Dirty = Area_None;
+  return Run_Count++;
+}
+
+// Glyphs of a string as LVGL's label would place them on one line
+static void Dash_Rasterise(const lv_font_t* font, const char* text, uint8_t cover[DASH_TEXT_HEIGHT][DASH_TEXT_WIDTH])
+{
+  memset(cover, 0, DASH_TEXT_HEIGHT * DASH_TEXT_WIDTH);
+  int16_t pen = 0;
+  for (const char* c = text; *c && pen < DASH_TEXT_WIDTH; c++) {
+    lv_font_glyph_dsc_t glyph;
+    if (!lv_font_get_glyph_dsc(font, &glyph, (uint8_t)*c, (uint8_t)c[1]))
+      continue;
+    const uint8_t* bitmap = lv_font_get_glyph_bitmap(glyph.resolved_font ? glyph.resolved_font : font, (uint8_t)*c);
+    int16_t top = font->line_height - font->base_line - glyph.box_h - glyph.ofs_y;
+    int16_t left = pen + glyph.ofs_x;
+    uint8_t bpp = glyph.bpp;
+    for (int16_t r = 0; bitmap && r < glyph.box_h; r++) {
+      int16_t y = top + r;
+      if (y < 0 || y >= DASH_TEXT_HEIGHT)
+        continue;
+      for (int16_t col = 0; col < glyph.box_w; col++) {
+        int16_t x = left + col;
+        if (x < 0 || x >= DASH_TEXT_WIDTH)
+          continue;
+        uint32_t bit = (uint32_t)(r * glyph.box_w + col) * bpp;          // Rows are packed without padding
+        uint8_t v = (bitmap[bit >> 3] >> (8 - bpp - (bit & 7))) & ((1 << bpp) - 1);
+        v = bpp == 1 ? v * 15 : bpp == 2 ? v * 5 : bpp == 8 ? v >> 4 : v;
+        if (v > cover[y][x])
+          cover[y][x] = v;
+      }
+    }
+    pen += glyph.adv_w;
+  }
+}
+
+/******************************************************************************
+function: Change a text run
+parameter:
+    id    : From Dash_Text
+    text  : New string, ASCII
+    color : Native RGB565
+note     : Only the cells whose coverage changed are marked, so "R: 128" to
+           "R: 129" repaints one glyph; a colour change repaints the run.
+******************************************************************************/
+void Dash_Text_Set(int8_t id, const char* text, uint16_t color)
+{
+  if (id < 0 || id >= Run_Count)
+    return;
+  Dash_Run& run = Dash_Runs[id];
+  int16_t height = run.Font->line_height;
+  if (color != run.Color) {
+    run.Color = color;
+    uint8_t br = (Dash_Background >> 11) & 0x1F, bg = (Dash_Background >> 5) & 0x3F, bb = Dash_Background & 0x1F;
+    uint8_t fr = (color >> 11) & 0x1F, fg = (color >> 5) & 0x3F, fb = color & 0x1F;
+    for (uint8_t i = 0; i < 16; i++) {
+      uint16_t mix = ((br * (15 - i) + fr * i) / 15 << 11) | ((bg * (15 - i) + fg * i) / 15 << 5) | ((bb * (15 - i) + fb * i) / 15);
+      run.Lut[i] = Panel_Order(mix);
+    }
+    Area_Add(run.Dirty, run.X, run.Y, run.X + DASH_TEXT_WIDTH - 1, run.Y + height - 1);
+  }
+  if (strncmp(text, run.Text, sizeof(run.Text)) == 0)
+    return;
+  strncpy(run.Text, text, sizeof(run.Text) - 1);
+  run.Text[sizeof(run.Text) - 1] = '\0';
+
+  Dash_Rasterise(run.Font, run.Text, Dash_Glyphs);
+  Dash_Area changed = Area_None;
+  for (int16_t y = 0; y < height; y++) {
+    if (memcmp(Dash_Glyphs[y], run.Cover[y], DASH_TEXT_WIDTH) == 0)
+      continue;
+    int16_t x1 = 0, x2 = DASH_TEXT_WIDTH - 1;
+    while (Dash_Glyphs[y][x1] == run.Cover[y][x1]) x1++;
+    while (Dash_Glyphs[y][x2] == run.Cover[y][x2]) x2--;
+    if (changed.X2 < changed.X1) {
+      changed = { x1, y, x2, y };
+    } else {
+      if (x1 < changed.X1) changed.X1 = x1;
+      if (x2 > changed.X2) changed.X2 = x2;
+      changed.Y2 = y;
+    }
+  }
+  if (changed.X2 < changed.X1)
+    return;
+  memcpy(run.Cover, Dash_Glyphs, sizeof(run.Cover));
+  Area_Add(run.Dirty, run.X + changed.X1, run.Y + changed.Y1, run.X + changed.X2, run.Y + changed.Y2);
+}
+
+// Something else (LVGL) painted this area; it is repainted from the scene
+void Dash_Damage(int16_t x1, int16_t y1, int16_t x2, int16_t y2)
+{
+  if (Dash_On)
+    Area_Add(Dash_Damaged, x1, y1, x2, y2);
+}
+
+// One row of the scene between columns x1 and x2, in panel byte order
+static void Dash_Row(int16_t y, int16_t x1, int16_t x2, uint16_t* row)
+{
+  int16_t w = x2 - x1 + 1;
+  uint16_t background = Panel_Order(Dash_Background);
+  for (int16_t i = 0; i < w; i++)
+    row[i] = background;
+
+  for (uint8_t b = 0; b < Box_Count; b++) {
+    const Dash_Box& box = Dash_Boxes[b];
+    if (y < box.Box.Y1 || y > box.Box.Y2 || x2 < box.Box.X1 || x1 > box.Box.X2)
+      continue;
+    uint16_t border = Panel_Order(box.Border), fill = Panel_Order(box.Fill);
+    bool edge = y < box.Box.Y1 + box.Border_Width || y > box.Box.Y2 - box.Border_Width;
+    int16_t from = box.Box.X1 > x1 ? box.Box.X1 : x1;
+    int16_t to = box.Box.X2 < x2 ? box.Box.X2 : x2;
+    for (int16_t x = from; x <= to; x++)
+      row[x - x1] = edge || x < box.Box.X1 + box.Border_Width || x > box.Box.X2 - box.Border_Width ? border : fill;
+  }
+
+  for (uint8_t t = 0; t < Run_Count; t++) {
+    const Dash_Run& run = Dash_Runs[t];
+    if (y < run.Y || y >= run.Y + run.Font->line_height || x2 < run.X || x1 >= run.X + DASH_TEXT_WIDTH)
+      continue;
+    const uint8_t* cover = run.Cover[y - run.Y];
+    int16_t from = run.X > x1 ? run.X : x1;
+    int16_t to = run.X + DASH_TEXT_WIDTH - 1 < x2 ? run.X + DASH_TEXT_WIDTH - 1 : x2;
+    for (int16_t x = from; x <= to; x++)
+      if (cover[x - run.X])
+        row[x - x1] = run.Lut[cover[x - run.X]];
+  }
+}
+
+// Compose an area strip by strip and send each in one transfer
+static void Dash_Send(Dash_Area& area)
+{
+  if (area.X2 < area.X1)
+    return;
+  int16_t w = area.X2 - area.X1 + 1;
+  for (int16_t y = area.Y1; y <= area.Y2; y += DASH_STRIP_ROWS) {
+    int16_t rows = area.Y2 - y + 1 < DASH_STRIP_ROWS ? area.Y2 - y + 1 : DASH_STRIP_ROWS;
+    for (int16_t r = 0; r < rows; r++)
+      Dash_Row(y + r, area.X1, area.X2, Dash_Strip + r * w);
+    LCD_Blit(area.X1, y, w, rows, Dash_Strip);
+    Dash_Totals.Strips++;
+    Dash_Totals.Pixels += (uint32_t)w * rows;
+  }
+  area = Area_None;
+}
+
+// An element's own change is already covered when it lies inside the damage
+static void Dash_Covered(Dash_Area& area)
+{
+  if (area.X1 >= Dash_Damaged.X1 && area.X2 <= Dash_Damaged.X2 && area.Y1 >= Dash_Damaged.Y1 && area.Y2 <= Dash_Damaged.Y2)
+    area = Area_None;
+}
+
+// Send every area that changed since the last flush
+void Dash_Flush()
+{
+  if (!Dash_On)
+    return;
+  uint32_t strips = Dash_Totals.Strips;
+  LCD_SetRotation(LCD_ROTATE_0);
+  if (Dash_Damaged.X2 >= Dash_Damaged.X1) {
+    for (uint8_t b = 0; b < Box_Count; b++)
+      Dash_Covered(Dash_Boxes[b].Dirty);
+    for (uint8_t t = 0; t < Run_Count; t++)
+      Dash_Covered(Dash_Runs[t].Dirty);
+  }
+  Dash_Send(Dash_Damaged);
+  for (uint8_t b = 0; b < Box_Count; b++)
+    Dash_Send(Dash_Boxes[b].Dirty);
+  for (uint8_t t = 0; t < Run_Count; t++)
+    Dash_Send(Dash_Runs[t].Dirty);
+  if (Dash_Totals.Strips != strips)
+    Dash_Totals.Flushes++;
+}
@@ -1,8 +1,12 @@
 #include "Display_ST7789.h"
+#include "SPI_Clock.h"
    
 #define SPI_WRITE(_dat)                               SPI.transfer(_dat)
 #define SPI_WRITE_Word(_dat)                          SPI.transfer16(_dat)
 #define SPI_WRITE_nByte(_SetData,_ReadData,_Size)     SPI.transferBytes(_SetData,_ReadData,_Size)
+
+uint32_t LCD_SPI_Hz = SPIFreq;
+
 void SPI_Init()
 {
   SPI.begin(EXAMPLE_PIN_NUM_SCLK,EXAMPLE_PIN_NUM_MISO,EXAMPLE_PIN_NUM_MOSI); 
@@ -10,7 +14,7 @@ void SPI_Init()
 
 void LCD_WriteCommand(uint8_t Cmd)  
 { 
-  SPI.beginTransaction(SPISettings(SPIFreq, MSBFIRST, SPI_MODE0));
+  SPI.beginTransaction(SPISettings(LCD_SPI_Hz, MSBFIRST, SPI_MODE0));
   digitalWrite(EXAMPLE_PIN_NUM_LCD_CS, LOW);  
   digitalWrite(EXAMPLE_PIN_NUM_LCD_DC, LOW); 
   SPI_WRITE(Cmd);
@@ -19,7 +23,7 @@ void LCD_WriteCommand(uint8_t Cmd)
 }
 void LCD_WriteData(uint8_t Data) 
 { 
-  SPI.beginTransaction(SPISettings(SPIFreq, MSBFIRST, SPI_MODE0));
+  SPI.beginTransaction(SPISettings(LCD_SPI_Hz, MSBFIRST, SPI_MODE0));
   digitalWrite(EXAMPLE_PIN_NUM_LCD_CS, LOW);  
   digitalWrite(EXAMPLE_PIN_NUM_LCD_DC, HIGH);  
   SPI_WRITE(Data);  
@@ -29,7 +33,7 @@ void LCD_WriteData(uint8_t Data)
 
 void LCD_WriteData_Word(uint16_t Data)
 {
-  SPI.beginTransaction(SPISettings(SPIFreq, MSBFIRST, SPI_MODE0));
+  SPI.beginTransaction(SPISettings(LCD_SPI_Hz, MSBFIRST, SPI_MODE0));
   digitalWrite(EXAMPLE_PIN_NUM_LCD_CS, LOW);  
   digitalWrite(EXAMPLE_PIN_NUM_LCD_DC, HIGH); 
   SPI_WRITE_Word(Data);
@@ -38,7 +42,7 @@ void LCD_WriteData_Word(uint16_t Data)
 }  
 void LCD_WriteData_nbyte(uint8_t* SetData,uint8_t* ReadData,uint32_t Size) 
 { 
-  SPI.beginTransaction(SPISettings(SPIFreq, MSBFIRST, SPI_MODE0));
+  SPI.beginTransaction(SPISettings(LCD_SPI_Hz, MSBFIRST, SPI_MODE0));
   digitalWrite(EXAMPLE_PIN_NUM_LCD_CS, LOW);  
   digitalWrite(EXAMPLE_PIN_NUM_LCD_DC, HIGH);  
   SPI_WRITE_nByte(SetData, ReadData, Size);
@@ -46,6 +50,53 @@ void LCD_WriteData_nbyte(uint8_t* SetData,uint8_t* ReadData,uint32_t Size)
   SPI.endTransaction();
 }    
  
+// Raw helpers for callers that batch several commands into one transaction.
+// LCD_Cmd leaves DC high so that data can follow straight away.
+static inline void LCD_Begin(void)
+{
+  SPI.beginTransaction(SPISettings(LCD_SPI_Hz, MSBFIRST, SPI_MODE0));
+  digitalWrite(EXAMPLE_PIN_NUM_LCD_CS, LOW);
+}
+static inline void LCD_End(void)
+{
+  digitalWrite(EXAMPLE_PIN_NUM_LCD_CS, HIGH);
+  SPI.endTransaction();
+}
+static inline void LCD_Cmd(uint8_t Cmd)
+{
+  digitalWrite(EXAMPLE_PIN_NUM_LCD_DC, LOW);
+  SPI_WRITE(Cmd);
+  digitalWrite(EXAMPLE_PIN_NUM_LCD_DC, HIGH);
+}
+// MADCTL address mode and controller RAM offsets for each rotation.
+// The 172 column glass sits in the middle of the 240 column controller RAM,
+// so the offset moves from the column to the row address when MV swaps them.
+struct LCD_Mode {
+  uint8_t  Madctl;
+  uint16_t Col_Offset;
+  uint16_t Row_Offset;
+};
+static const LCD_Mode LCD_Modes[4] = {
+  { 0x00, Offset_X, Offset_Y },                                  // LCD_ROTATE_0   portrait
+  { 0x60, Offset_Y, Offset_X },                                  // LCD_ROTATE_90  MX | MV
+  { 0xC0, Offset_X, Offset_Y },                                  // LCD_ROTATE_180 MX | MY
+  { 0xA0, Offset_Y, Offset_X },                                  // LCD_ROTATE_270 MY | MV
+};
+static uint8_t LCD_Rotation = LCD_ROTATE_0;
+
+// Set the address window and start a memory write, inside an open transaction
+static void LCD_Window(uint16_t Xstart, uint16_t Ystart, uint16_t Xend, uint16_t Yend)
+{
+  const LCD_Mode& mode = LCD_Modes[LCD_Rotation];
+  LCD_Cmd(0x2A);
+  SPI_WRITE_Word(Xstart + mode.Col_Offset);
+  SPI_WRITE_Word(Xend + mode.Col_Offset);
+  LCD_Cmd(0x2B);
+  SPI_WRITE_Word(Ystart + mode.Row_Offset);
+  SPI_WRITE_Word(Yend + mode.Row_Offset);
+  LCD_Cmd(0x2C);
+}
+
 void LCD_Reset(void)
 {
   digitalWrite(EXAMPLE_PIN_NUM_LCD_CS, LOW);       
@@ -67,11 +118,9 @@ void LCD_Init(void)
   //************* Start Initial Sequence **********// 
   LCD_WriteCommand(0x11);
   delay(120);
+  LCD_Rotation = HORIZONTAL ? LCD_ROTATE_0 : LCD_ROTATE_270;
   LCD_WriteCommand(0x36);
-  if (HORIZONTAL)
-      LCD_WriteData(0x00);
-  else
-      LCD_WriteData(0x70);
+  LCD_WriteData(LCD_Modes[LCD_Rotation].Madctl);
 
   LCD_WriteCommand(0x3A);
   LCD_WriteData(0x05);
@@ -154,6 +203,41 @@ void LCD_Init(void)
   LCD_WriteCommand(0x29); 
 }
 /******************************************************************************
+function: Rotate the panel's address mode
+parameter :
+    Rotation: LCD_ROTATE_0/90/180/270
+note      :   Only MADCTL changes, pixels already on the panel stay where
+              they are. Subsequent writes use the rotated coordinate space
+              (LCD_GetWidth() x LCD_GetHeight()), so rows of landscape
+              content can be sent in their natural order.
+******************************************************************************/
+void LCD_SetRotation(uint8_t Rotation)
+{
+  Rotation &= 0x03;
+  if (Rotation == LCD_Rotation)
+    return;
+  LCD_Rotation = Rotation;
+  LCD_Begin();
+  LCD_Cmd(0x36);
+  SPI_WRITE(LCD_Modes[Rotation].Madctl);
+  LCD_End();
+}
+
+uint8_t LCD_GetRotation(void)
+{
+  return LCD_Rotation;
+}
+
+uint16_t LCD_GetWidth(void)
+{
+  return (LCD_Rotation & 0x01) ? LCD_HEIGHT : LCD_WIDTH;
+}
+
+uint16_t LCD_GetHeight(void)
+{
+  return (LCD_Rotation & 0x01) ? LCD_WIDTH : LCD_HEIGHT;
+}
+/******************************************************************************
 function: Set the cursor position
 parameter :
     Xstart:   Start uint16_t x coordinate
@@ -163,37 +247,49 @@ parameter :
 ******************************************************************************/
 void LCD_SetCursor(uint16_t Xstart, uint16_t Ystart, uint16_t Xend, uint16_t  Yend)
 { 
-  if (HORIZONTAL) {
-    // set the X coordinates
-    LCD_WriteCommand(0x2A);
-    LCD_WriteData(Xstart >> 8);
-    LCD_WriteData(Xstart + Offset_X);
-    LCD_WriteData(Xend >> 8);
-    LCD_WriteData(Xend + Offset_X);
-    
-    // set the Y coordinates
-    LCD_WriteCommand(0x2B);
-    LCD_WriteData(Ystart >> 8);
-    LCD_WriteData(Ystart + Offset_Y);
-    LCD_WriteData(Yend >> 8);
-    LCD_WriteData(Yend + Offset_Y);
-  }
-  else {
-    // set the X coordinates
-    LCD_WriteCommand(0x2A);
-    LCD_WriteData(Ystart >> 8);
-    LCD_WriteData(Ystart + Offset_Y);
-    LCD_WriteData(Yend >> 8);
-    LCD_WriteData(Yend + Offset_Y);
-    // set the Y coordinates
-    LCD_WriteCommand(0x2B);
-    LCD_WriteData(Xstart >> 8);
-    LCD_WriteData(Xstart + Offset_X);
-    LCD_WriteData(Xend >> 8);
-    LCD_WriteData(Xend + Offset_X);
+  LCD_Begin();
+  LCD_Window(Xstart, Ystart, Xend, Yend);
+  LCD_End();
+}
+void LCD_SetClock(uint32_t Hz)
+{
+  LCD_SPI_Hz = Hz;
+}
+
+/******************************************************************************
+function: Clock calibration probe, a pattern written at Hz and read back
+parameter:
+    Hz    : Write clock under test; RAMRD always runs at LCD_PROBE_READ_HZ
+    Check : Checksum of what came back
+return    : False if the read-back does not follow the pattern, i.e. the
+            panel's SDA line does not reach MISO
+******************************************************************************/
+bool LCD_Probe(uint32_t Hz, uint32_t* Check)
+{
+  uint16_t pattern[LCD_PROBE_PIXELS];
+  uint8_t readback[2][LCD_PROBE_PIXELS * 3 + 1];         // 18 bits a pixel, plus the dummy cycle
+  for (uint8_t pass = 0; pass < 2; pass++) {
+    for (uint16_t i = 0; i < LCD_PROBE_PIXELS; i++)
+      pattern[i] = (uint16_t)(i * 2654435761u >> 16) ^ (pass ? 0xFFFF : 0);
+    SPI.beginTransaction(SPISettings(Hz, MSBFIRST, SPI_MODE0));
+    digitalWrite(EXAMPLE_PIN_NUM_LCD_CS, LOW);
+    LCD_Window(0, 0, LCD_PROBE_PIXELS - 1, 0);
+    SPI_WRITE_nByte((uint8_t*)pattern, NULL, sizeof(pattern));
+    LCD_End();
+
+    SPI.beginTransaction(SPISettings(LCD_PROBE_READ_HZ, MSBFIRST, SPI_MODE0));
+    digitalWrite(EXAMPLE_PIN_NUM_LCD_CS, LOW);
+    LCD_Cmd(0x2E);                                         // RAMRD, from the window start
+    SPI_WRITE_nByte(NULL, readback[pass], sizeof(readback[pass]));
+    LCD_End();
   }
-  LCD_WriteCommand(0x2C);
+  if (memcmp(readback[0], readback[1], sizeof(readback[0])) == 0)
+    return false;                                          // The bus reads the same whatever was written
+  *Check = SPI_Clock_Hash(SPI_Clock_Hash(SPI_CLOCK_HASH_SEED, readback[0], sizeof(readback[0])),
+                          readback[1], sizeof(readback[1]));
+  return true;
 }
+
 /******************************************************************************
 function: Refresh the image in an area
 parameter :
@@ -205,21 +301,193 @@ parameter :
 ******************************************************************************/
 void LCD_addWindow(uint16_t Xstart, uint16_t Ystart, uint16_t Xend, uint16_t Yend,uint16_t* color)
 {       
-  // uint16_t i,j;
-  // LCD_SetCursor(Xstart, Ystart, Xend,Yend);
-  // uint16_t Show_Width = Xend - Xstart + 1;
-  // uint16_t Show_Height = Yend - Ystart + 1;
-  // for(i = 0; i < Show_Height; i++){               
-  //   for(j = 0; j < Show_Width; j++){
-  //     LCD_WriteData_Word(color[(i*(Show_Width))+j]);                            
-  //   }
-  // }    
-  uint16_t Show_Width = Xend - Xstart + 1;
-  uint16_t Show_Height = Yend - Ystart + 1;
-  uint32_t numBytes = Show_Width * Show_Height * sizeof(uint16_t);
-  uint8_t Read_D[numBytes];
-  LCD_SetCursor(Xstart, Ystart, Xend, Yend);
-  LCD_WriteData_nbyte((uint8_t*)color, Read_D, numBytes);
+  LCD_Blit(Xstart, Ystart, Xend - Xstart + 1, Yend - Ystart + 1, color);
+}
+/******************************************************************************
+function: Clip a rectangle against the panel in the current rotation
+parameter :
+    x, y  :   Top-left corner, updated to the visible corner
+    w, h  :   Size, updated to the visible size
+return    :   false if nothing is visible
+******************************************************************************/
+static bool LCD_ClipRect(int16_t* x, int16_t* y, int16_t* w, int16_t* h)
+{
+  int32_t x0 = *x, y0 = *y;
+  int32_t x1 = x0 + *w, y1 = y0 + *h;
+  if (x0 < 0) x0 = 0;
+  if (y0 < 0) y0 = 0;
+  if (x1 > LCD_GetWidth()) x1 = LCD_GetWidth();
+  if (y1 > LCD_GetHeight()) y1 = LCD_GetHeight();
+  if (x1 <= x0 || y1 <= y0)
+    return false;
+  *x = x0;
+  *y = y0;
+  *w = x1 - x0;
+  *h = y1 - y0;
+  return true;
+}
+/******************************************************************************
+function: Fill a rectangle with a solid color
+parameter :
+    x, y  :   Top-left corner (may be off-panel, the rectangle is clipped)
+    w, h  :   Size in pixels
+    color :   RGB565 color
+note      :   The pixels are streamed from a small pattern buffer in
+              LCD_FILL_CHUNK sized bursts within a single transaction,
+              so a full screen clear is one window set plus ~215 bursts.
+******************************************************************************/
+static uint16_t Fill_Pattern[LCD_FILL_CHUNK];
+static uint16_t Fill_Color = 0;
+static bool Fill_Ready = false;
+
+void LCD_FillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color)
+{
+  if (!LCD_ClipRect(&x, &y, &w, &h))
+    return;
+
+  uint16_t wire = (color >> 8) | (color << 8);                  // Panel expects big-endian pixels
+  if (!Fill_Ready || Fill_Color != wire) {
+    for (uint16_t i = 0; i < LCD_FILL_CHUNK; i++)
+      Fill_Pattern[i] = wire;
+    Fill_Color = wire;
+    Fill_Ready = true;
+  }
+
+  uint32_t remaining = (uint32_t)w * h;
+  LCD_Begin();
+  LCD_Window(x, y, x + w - 1, y + h - 1);
+  while (remaining) {
+    uint32_t n = remaining > LCD_FILL_CHUNK ? LCD_FILL_CHUNK : remaining;
+    SPI.writeBytes((const uint8_t*)Fill_Pattern, n * sizeof(uint16_t));
+    remaining -= n;
+  }
+  LCD_End();
+}
+
+void LCD_HLine(int16_t x, int16_t y, int16_t w, uint16_t color)
+{
+  LCD_FillRect(x, y, w, 1, color);
+}
+
+void LCD_VLine(int16_t x, int16_t y, int16_t h, uint16_t color)
+{
+  LCD_FillRect(x, y, 1, h, color);
+}
+
+void LCD_Clear(uint16_t color)
+{
+  LCD_FillRect(0, 0, LCD_GetWidth(), LCD_GetHeight(), color);
+}
+/******************************************************************************
+function: Copy a block of pixels to the panel, clipped to the panel
+parameter :
+    x, y   :   Top-left corner of the block (may be off-panel)
+    w, h   :   Size of the block in pixels
+    pixels :   w*h RGB565 pixels, row-major, already in panel (big-endian)
+               byte order
+******************************************************************************/
+void LCD_Blit(int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t* pixels)
+{
+  int16_t cx = x, cy = y, cw = w, ch = h;
+  if (!pixels || !LCD_ClipRect(&cx, &cy, &cw, &ch))
+    return;
+
+  const uint16_t* src = pixels + (int32_t)(cy - y) * w + (cx - x);
+  LCD_Begin();
+  LCD_Window(cx, cy, cx + cw - 1, cy + ch - 1);
+  if (cw == w) {                                                 // Rows are contiguous, send in one go
+    SPI.writeBytes((const uint8_t*)src, (uint32_t)cw * ch * sizeof(uint16_t));
+  } else {
+    for (int16_t row = 0; row < ch; row++, src += w)
+      SPI.writeBytes((const uint8_t*)src, (uint32_t)cw * sizeof(uint16_t));
+  }
+  LCD_End();
+}
+/******************************************************************************
+function: Define the hardware vertical scroll area (VSCRDEF, 0x33)
+parameter :
+    Top    :   Rows fixed at the top of the panel
+    Bottom :   Rows fixed at the bottom of the panel
+note      :   Scrolling runs along frame memory rows, so it is only meaningful
+              in LCD_ROTATE_0. The scroll offset restarts at 0.
+******************************************************************************/
+static uint16_t Scroll_Top = 0;
+static uint16_t Scroll_Height = LCD_HEIGHT;
+static uint16_t Scroll_Offset = 0;
+
+void LCD_ScrollArea(uint16_t Top, uint16_t Bottom)
+{
+  if (Top + Bottom >= LCD_HEIGHT)
+    return;
+  Scroll_Top = Top;
+  Scroll_Height = LCD_HEIGHT - Top - Bottom;
+  LCD_Begin();
+  LCD_Cmd(0x33);
+  SPI_WRITE_Word(Top);
+  SPI_WRITE_Word(Scroll_Height);
+  SPI_WRITE_Word(Bottom);
+  LCD_End();
+  LCD_ScrollTo(0);
+}
+/******************************************************************************
+function: Set the vertical scroll start address (VSCSAD, 0x37)
+parameter :
+    Offset :   Frame memory row, relative to the scroll area, that is shown
+               on the first scrolling row of the panel
+******************************************************************************/
+void LCD_ScrollTo(uint16_t Offset)
+{
+  Scroll_Offset = Offset % Scroll_Height;
+  LCD_Begin();
+  LCD_Cmd(0x37);
+  SPI_WRITE_Word(Scroll_Top + Scroll_Offset);
+  LCD_End();
+}
+
+uint16_t LCD_ScrollOffset(void)
+{
+  return Scroll_Offset;
+}
+
+// Frame memory row currently shown on a panel row
+uint16_t LCD_ScrollMemoryRow(uint16_t ScreenRow)
+{
+  if (ScreenRow < Scroll_Top || ScreenRow >= Scroll_Top + Scroll_Height)
+    return ScreenRow;
+  return Scroll_Top + (ScreenRow - Scroll_Top + Scroll_Offset) % Scroll_Height;
+}
+/******************************************************************************
+function: Scroll the content up by Lines rows and stream only the new rows
+parameter :
+    Lines  :   Rows to scroll, at most the scroll area height
+    Fill   :   Called once per newly exposed row, bottom-most last, with the
+               panel row and a LCD_WIDTH pixel buffer to fill in panel byte
+               order
+    Ctx    :   Passed through to Fill
+******************************************************************************/
+void LCD_ScrollUp(uint16_t Lines, LCD_RowFill Fill, void* Ctx)
+{
+  static uint16_t Row[LCD_WIDTH];
+  if (Lines > Scroll_Height) Lines = Scroll_Height;
+  LCD_ScrollTo(Scroll_Offset + Lines);
+  uint16_t first = Scroll_Top + Scroll_Height - Lines;
+  for (uint16_t i = 0; i < Lines; i++) {
+    Fill(first + i, Row, Ctx);
+    LCD_Blit(0, LCD_ScrollMemoryRow(first + i), LCD_WIDTH, 1, Row);
+  }
+}
+
+// Leave scroll mode (NORON, 0x13) and map memory rows 1:1 again
+void LCD_ScrollOff(void)
+{
+  Scroll_Top = 0;
+  Scroll_Height = LCD_HEIGHT;
+  Scroll_Offset = 0;
+  LCD_Begin();
+  LCD_Cmd(0x37);
+  SPI_WRITE_Word(0);
+  LCD_Cmd(0x13);
+  LCD_End();
 }
 // backlight
 void Backlight_Init(void)
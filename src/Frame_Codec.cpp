@@ -0,0 +1,31 @@
+#include "Frame_Codec.h"
+#include <string.h>
+
+bool RLE_Decode(const uint8_t* src, uint32_t srcBytes, uint16_t* dst, uint32_t dstPixels)
+{
+  const uint8_t* end = src + srcBytes;
+  uint16_t* out = dst;
+  uint16_t* outEnd = dst + dstPixels;
+
+  while (src < end) {
+    uint8_t c = *src++;
+    if (c < 0x80) {
+      uint32_t n = c + 1;
+      if ((uint32_t)(end - src) < n * 2 || (uint32_t)(outEnd - out) < n)
+        return false;
+      memcpy(out, src, n * 2);                                     // Already in panel byte order
+      src += n * 2;
+      out += n;
+    } else {
+      uint32_t n = c - 0x80 + RLE_REPEAT_MIN;
+      if (end - src < 2 || (uint32_t)(outEnd - out) < n)
+        return false;
+      uint16_t pixel;
+      memcpy(&pixel, src, 2);
+      src += 2;
+      while (n--)
+        *out++ = pixel;
+    }
+  }
+  return out == outEnd;
+}
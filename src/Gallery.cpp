@@ -0,0 +1,94 @@
+#include "Gallery.h"
+
+extern uint16_t Image_CNT;
+
+static uint16_t Gallery_Current = 0;     // Selected catalog entry
+static uint16_t Gallery_Start = 0;       // First entry on the page shown
+
+static void Gallery_Origin(uint16_t index, int16_t& x, int16_t& y)
+{
+  uint16_t cell = index - Gallery_Start;
+  x = (cell % GALLERY_COLS) * GALLERY_CELL_WIDTH;
+  y = (cell / GALLERY_COLS) * GALLERY_CELL_HEIGHT;
+}
+
+static void Gallery_Frame(uint16_t index, uint16_t color)
+{
+  int16_t x, y;
+  Gallery_Origin(index, x, y);
+  LCD_FillRect(x, y, GALLERY_CELL_WIDTH, GALLERY_FRAME_WIDTH, color);
+  LCD_FillRect(x, y + GALLERY_CELL_HEIGHT - GALLERY_FRAME_WIDTH, GALLERY_CELL_WIDTH, GALLERY_FRAME_WIDTH, color);
+  LCD_FillRect(x, y, GALLERY_FRAME_WIDTH, GALLERY_CELL_HEIGHT, color);
+  LCD_FillRect(x + GALLERY_CELL_WIDTH - GALLERY_FRAME_WIDTH, y, GALLERY_FRAME_WIDTH, GALLERY_CELL_HEIGHT, color);
+}
+
+// Thumbnail centred in its cell, or the placeholder
+static void Gallery_Cell(uint16_t index, const uint16_t* pixels, uint16_t width, uint16_t height)
+{
+  int16_t x, y;
+  Gallery_Origin(index, x, y);
+  if (pixels)
+    LCD_Blit(x + (GALLERY_CELL_WIDTH - width) / 2, y + (GALLERY_CELL_HEIGHT - height) / 2, width, height, pixels);
+  else
+    LCD_FillRect(x + (GALLERY_CELL_WIDTH - THUMB_SIZE) / 2, y + (GALLERY_CELL_HEIGHT - THUMB_SIZE) / 2, THUMB_SIZE,
+                 THUMB_SIZE, GALLERY_PLACEHOLDER);
+}
+
+/******************************************************************************
+function: Draw the page holding a catalog entry and select it
+parameter:
+    selected : Catalog entry
+******************************************************************************/
+void Gallery_Show(uint16_t selected)
+{
+  if (!Image_CNT)
+    return;
+  if (selected >= Image_CNT)
+    selected = 0;
+  uint32_t start = micros();
+  Gallery_Current = selected;
+  Gallery_Start = selected - selected % GALLERY_PAGE;
+  LCD_SetRotation(LCD_ROTATE_0);
+  LCD_Clear(GALLERY_BACKGROUND);
+  uint16_t loaded = Thumb_Load(Gallery_Start, GALLERY_PAGE, Gallery_Cell);
+  Gallery_Frame(Gallery_Current, GALLERY_FRAME);
+  printf("gallery %u-%u of %u: %u thumbnails in %lu ms\r\n", Gallery_Start + 1,
+         Gallery_Start + GALLERY_PAGE < Image_CNT ? Gallery_Start + GALLERY_PAGE : Image_CNT, Image_CNT, loaded,
+         (unsigned long)((micros() - start) / 1000));
+}
+
+// Move the frame, turning the page if the entry is on another one
+void Gallery_Select(uint16_t selected)
+{
+  if (selected >= Image_CNT)
+    selected = 0;
+  if (selected < Gallery_Start || selected >= Gallery_Start + GALLERY_PAGE) {
+    Gallery_Show(selected);
+    return;
+  }
+  Gallery_Frame(Gallery_Current, GALLERY_BACKGROUND);
+  Gallery_Current = selected;
+  Gallery_Frame(Gallery_Current, GALLERY_FRAME);
+}
+
+// Redraw one cell, e.g. once its thumbnail has been built
+void Gallery_Refresh(uint16_t index)
+{
+  if (index < Gallery_Start || index >= Gallery_Start + GALLERY_PAGE || index >= Image_CNT)
+    return;
+  int16_t x, y;
+  Gallery_Origin(index, x, y);
+  LCD_FillRect(x + GALLERY_FRAME_WIDTH, y + GALLERY_FRAME_WIDTH, GALLERY_CELL_WIDTH - 2 * GALLERY_FRAME_WIDTH,
+               GALLERY_CELL_HEIGHT - 2 * GALLERY_FRAME_WIDTH, GALLERY_BACKGROUND);
+  Thumb_Load(index, 1, Gallery_Cell);
+}
+
+uint16_t Gallery_Selected()
+{
+  return Gallery_Current;
+}
+
+uint16_t Gallery_First()
+{
+  return Gallery_Start;
+}
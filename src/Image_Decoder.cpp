@@ -0,0 +1,214 @@
+#include "Image_Decoder.h"
+#include "Mem_Budget.h"
+
+struct Image_Cache_Entry {
+  char      Path[100];
+  uint16_t  Width;
+  uint16_t  Height;
+  uint16_t* Pixels;       // Width * Height, nullptr when the slot is free
+  uint32_t  Used;         // Image_Cache_Clock at the last lookup
+};
+static Image_Cache_Entry Image_Cache[IMAGE_CACHE_ENTRIES];
+static uint32_t Image_Cache_Bytes = 0;
+static uint32_t Image_Cache_Clock = 0;
+Image_Cache_Stats Image_Cache_Totals;
+
+static uint32_t Cache_Size(const Image_Cache_Entry& entry)
+{
+  return (uint32_t)entry.Width * entry.Height * sizeof(uint16_t);
+}
+
+static void Cache_Evict(Image_Cache_Entry& entry)
+{
+  uint32_t bytes = Cache_Size(entry);
+  free(entry.Pixels);
+  entry.Pixels = nullptr;
+  Image_Cache_Bytes -= bytes;
+  Mem_Pool_Use("image_cache", -(int32_t)bytes);
+}
+
+// Least recently used frame, nullptr if the cache is empty
+static Image_Cache_Entry* Cache_Oldest()
+{
+  Image_Cache_Entry* oldest = nullptr;
+  for (auto& entry : Image_Cache)
+    if (entry.Pixels && (!oldest || entry.Used < oldest->Used))
+      oldest = &entry;
+  return oldest;
+}
+
+static Image_Cache_Entry* Cache_Find(const char* filePath)
+{
+  for (auto& entry : Image_Cache) {
+    if (entry.Pixels && strcmp(entry.Path, filePath) == 0) {
+      entry.Used = ++Image_Cache_Clock;
+      return &entry;
+    }
+  }
+  return nullptr;
+}
+
+// Decode into a new entry, evicting the oldest frames until it fits
+static Image_Cache_Entry* Cache_Decode(const char* filePath, const Image_Info& info)
+{
+  if (!Image_Capturable(info) || strlen(filePath) >= sizeof(Image_Cache[0].Path))
+    return nullptr;
+  uint16_t width, height;
+  Image_Frame_Size(info, width, height);
+  uint32_t bytes = (uint32_t)width * height * sizeof(uint16_t);
+  if (bytes > IMAGE_CACHE_BYTES)
+    return nullptr;
+
+  Image_Cache_Entry* slot = nullptr;
+  for (;;) {
+    slot = nullptr;
+    for (auto& entry : Image_Cache)
+      if (!entry.Pixels) slot = &entry;
+    if (slot && Image_Cache_Bytes + bytes <= IMAGE_CACHE_BYTES)
+      break;
+    Cache_Evict(*Cache_Oldest());
+    Image_Cache_Totals.Evictions++;
+  }
+
+  uint16_t* pixels = (uint16_t*)malloc(bytes);
+  if (!pixels) {
+    // The heap may be too fragmented for a full frame, free the rest and retry
+    while (Image_Cache_Entry* oldest = Cache_Oldest()) {
+      Cache_Evict(*oldest);
+      Image_Cache_Totals.Evictions++;
+    }
+    pixels = (uint16_t*)malloc(bytes);
+    if (!pixels) {
+      printf("image cache: no memory for %s (%lu bytes)\r\n", filePath, (unsigned long)bytes);
+      return nullptr;
+    }
+  }
+  if (!Image_Capture(filePath, info, pixels)) {
+    free(pixels);
+    return nullptr;
+  }
+
+  strcpy(slot->Path, filePath);
+  slot->Width = width;
+  slot->Height = height;
+  slot->Pixels = pixels;
+  slot->Used = ++Image_Cache_Clock;
+  Image_Cache_Bytes += bytes;
+  Mem_Pool_Use("image_cache", bytes);
+  Image_Cache_Totals.Misses++;
+  return slot;
+}
+
+static Image_Cache_Entry* Cache_Get(const char* filePath, const Image_Info* known)
+{
+  Image_Cache_Entry* entry = Cache_Find(filePath);
+  if (entry) {
+    Image_Cache_Totals.Hits++;
+    return entry;
+  }
+  Image_Info info;
+  if (known)
+    info = *known;
+  else if (!Image_Probe(filePath, info) || Image_Unusable(info))
+    return nullptr;
+  return Cache_Decode(filePath, info);
+}
+
+bool Image_Cache_Load(const char* filePath, const Image_Info& info)
+{
+  return Cache_Get(filePath, &info) != nullptr;
+}
+
+void Image_Cache_Clear()
+{
+  for (auto& entry : Image_Cache)
+    if (entry.Pixels) Cache_Evict(entry);
+}
+
+// LVGL asks for the size first; a cached frame answers without touching the card
+static lv_res_t Decoder_Info(lv_img_decoder_t* decoder, const void* src, lv_img_header_t* header)
+{
+  if (lv_img_src_get_type(src) != LV_IMG_SRC_FILE)
+    return LV_RES_INV;
+  const char* filePath = (const char*)src;
+  uint16_t width, height;
+  Image_Cache_Entry* entry = Cache_Find(filePath);
+  if (entry) {
+    width = entry->Width;
+    height = entry->Height;
+  } else {
+    Image_Info info;
+    if (!Image_Probe(filePath, info) || Image_Unusable(info) || !Image_Capturable(info))
+      return LV_RES_INV;
+    Image_Frame_Size(info, width, height);
+  }
+  header->always_zero = 0;
+  header->cf = LV_IMG_CF_TRUE_COLOR;
+  header->w = width;
+  header->h = height;
+  return LV_RES_OK;
+}
+
+// The whole frame is handed over, so LVGL never needs read_line
+static lv_res_t Decoder_Open(lv_img_decoder_t* decoder, lv_img_decoder_dsc_t* dsc)
+{
+  if (dsc->src_type != LV_IMG_SRC_FILE)
+    return LV_RES_INV;
+  Image_Cache_Entry* entry = Cache_Get((const char*)dsc->src, nullptr);
+  if (!entry)
+    return LV_RES_INV;
+  dsc->img_data = (const uint8_t*)entry->Pixels;
+  return LV_RES_OK;
+}
+
+void Image_Decoder_Init()
+{
+  lv_img_decoder_t* decoder = lv_img_decoder_create();       // Inserted ahead of LVGL's built-in decoder
+  lv_img_decoder_set_info_cb(decoder, Decoder_Info);
+  lv_img_decoder_set_open_cb(decoder, Decoder_Open);
+  Mem_Pool_Define("image_cache", IMAGE_CACHE_BYTES);
+}
+
+/******************************************************************************
+function: Show a slide through an LVGL image object
+parameter :
+    image    :   lv_img centred on the screen
+    filePath :   File on the card
+    info     :   Its probed header
+note      :   The frame is decoded (or found in the cache) and sent to the
+              panel once, with the current transition, exactly as a direct
+              slide would be. The image then points at the same frame with
+              invalidation off, so LVGL knows what is on the panel without
+              repainting it, and later redraws of any area (an overlay, say)
+              composite over the photo from memory.
+******************************************************************************/
+bool Image_Decoder_Show(lv_obj_t* image, const char* filePath, const Image_Info& info)
+{
+  uint32_t hits = Image_Cache_Totals.Hits;
+  Image_Cache_Entry* entry = Cache_Get(filePath, &info);
+  if (!entry)
+    return false;
+
+  uint32_t start = micros();
+  Image_Show_Frame(entry->Pixels, entry->Width, entry->Height);
+  printf("frame %dx%d %s: panel %lu ms, cache %lu of %lu bytes\r\n", entry->Width, entry->Height,
+         Image_Cache_Totals.Hits != hits ? "from cache" : "decoded", (unsigned long)((micros() - start) / 1000),
+         (unsigned long)Image_Cache_Bytes, (unsigned long)IMAGE_CACHE_BYTES);
+
+  lv_disp_t* disp = lv_disp_get_default();
+  lv_disp_enable_invalidation(disp, false);
+  lv_img_set_src(image, filePath);
+  lv_obj_clear_flag(image, LV_OBJ_FLAG_HIDDEN);
+  lv_obj_update_layout(image);                                // Recentre now, not at the next refresh
+  lv_disp_enable_invalidation(disp, true);
+  return true;
+}
+
+// Hide the image without repainting, before a slide is drawn straight to the panel
+void Image_Decoder_Hide(lv_obj_t* image)
+{
+  lv_disp_t* disp = lv_disp_get_default();
+  lv_disp_enable_invalidation(disp, false);
+  lv_obj_add_flag(image, LV_OBJ_FLAG_HIDDEN);
+  lv_disp_enable_invalidation(disp, true);
+}
@@ -0,0 +1,144 @@
+#include "Image_Probe.h"
+#include "LCD_Image.h"
+#include "Pixel_Convert.h"
+
+static uint16_t Probe_BE16(const uint8_t* p) { return (p[0] << 8) | p[1]; }
+static uint16_t Probe_LE16(const uint8_t* p) { return p[0] | (p[1] << 8); }
+static uint32_t Probe_BE32(const uint8_t* p) { return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | (p[2] << 8) | p[3]; }
+
+// Signature, then the IHDR chunk which PNG requires to come first
+static bool Probe_PNG(const uint8_t* h, Image_Info& info)
+{
+  static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
+  if (memcmp(h, signature, 8) != 0 || Probe_BE32(h + 8) != 13 || memcmp(h + 12, "IHDR", 4) != 0)
+    return false;
+  uint32_t width = Probe_BE32(h + 16), height = Probe_BE32(h + 20);
+  uint8_t depth = h[24], colorType = h[25];
+  uint8_t channels = colorType == 0 ? 1 : colorType == 2 ? 3 : colorType == 3 ? 1 : colorType == 4 ? 2 : colorType == 6 ? 4 : 0;
+  if (!channels || !depth || depth > 16 || (depth & (depth - 1)) || width > 0xFFFF || height > 0xFFFF)
+    return false;
+  info.Format = IMAGE_FORMAT_PNG;
+  info.Width = width;
+  info.Height = height;
+  info.Bits = depth * channels;
+  info.Flags = h[28] ? IMAGE_INFO_INTERLACED : 0;
+  return true;
+}
+
+// Walk the marker segments up to the first start-of-frame
+static bool Probe_JPEG(SD_Reader& file, Image_Info& info)
+{
+  uint32_t position = 2;
+  uint8_t m[9];
+  while (position < IMAGE_PROBE_JPEG_LIMIT && SD_Reader_ReadAt(file, position, m, 4)) {
+    if (m[0] != 0xFF)
+      return false;
+    uint8_t marker = m[1];
+    if (marker == 0xFF) {                                   // Fill byte
+      position++;
+      continue;
+    }
+    if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) {
+      position += 2;                                        // No length
+      continue;
+    }
+    if (marker == 0xDA || marker == 0xD9)                   // Scan or end before any frame
+      return false;
+    uint16_t length = Probe_BE16(m + 2);
+    bool frame = marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC;
+    if (frame) {
+      if (!SD_Reader_ReadAt(file, position + 4, m, 6))
+        return false;
+      info.Format = IMAGE_FORMAT_JPEG;
+      info.Height = Probe_BE16(m + 1);
+      info.Width = Probe_BE16(m + 3);
+      info.Bits = m[0] * m[5];
+      info.Flags = marker == 0xC2 || marker == 0xC6 || marker == 0xCA || marker == 0xCE ? IMAGE_INFO_PROGRESSIVE : 0;
+      return true;
+    }
+    position += 2 + length;
+  }
+  return false;
+}
+
+/******************************************************************************
+function: Learn an image's format and size from its header
+parameter:
+    filePath : File on the card
+    info     : Filled in when the header is recognised
+return    : false if the file cannot be read or is not a known format
+******************************************************************************/
+bool Image_Probe(const char* filePath, Image_Info& info)
+{
+  SD_Reader file;
+  if (!SD_Reader_Open(file, filePath))
+    return false;
+
+  uint8_t h[33];
+  memset(&info, 0, sizeof(info));
+  memset(h, 0, sizeof(h));
+  bool ok = SD_Reader_Read(file, h, sizeof(h)) >= 8;
+  if (ok) {
+    if (h[0] == 0x89)
+      ok = Probe_PNG(h, info);
+    else if (h[0] == 0xFF && h[1] == 0xD8)
+      ok = Probe_JPEG(file, info);
+    else {
+      // Our formats all start with a 4-byte magic and little-endian width, height
+      static const struct { const char* Magic; uint8_t Format; uint8_t Bits; } own[] = {
+        { "BLT1", IMAGE_FORMAT_BLT, 16 }, { "B565", IMAGE_FORMAT_RGB565, 16 }, { "BLP8", IMAGE_FORMAT_INDEXED, 8 },
+        { "BLZ1", IMAGE_FORMAT_RLE, 16 }, { "BLA1", IMAGE_FORMAT_BLA, 16 },
+      };
+      ok = false;
+      for (const auto& f : own) {
+        if (memcmp(h, f.Magic, 4) == 0) {
+          info.Format = f.Format;
+          info.Bits = f.Bits;
+          info.Width = Probe_LE16(h + 4);
+          info.Height = Probe_LE16(h + 6);
+          ok = true;
+        }
+      }
+    }
+  }
+  // The name may override the global dither setting for this PNG
+  if (ok && info.Format == IMAGE_FORMAT_PNG) {
+    uint8_t rule = Pixel_Dither_Rule(filePath);
+    info.Flags |= rule == PIXEL_DITHER_ON ? IMAGE_INFO_DITHER : rule == PIXEL_DITHER_OFF ? IMAGE_INFO_NO_DITHER : 0;
+  }
+  info.File_Size = file.Size;
+  info.File_Time = (uint32_t)file.Handle.getLastWrite();
+  SD_Reader_Close(file);
+  return ok;
+}
+
+const char* Image_Unusable(const Image_Info& info)
+{
+  if (info.Format == IMAGE_FORMAT_UNKNOWN)
+    return "not a known image format";
+  if (!info.Width || !info.Height)
+    return "empty image";
+  switch (info.Format) {
+  case IMAGE_FORMAT_JPEG:
+    if (info.Flags & IMAGE_INFO_PROGRESSIVE)
+      return "progressive JPEG, convert with tools/blimage.py";
+    if (info.Bits != 8 && info.Bits != 24)
+      return "CMYK or 12-bit JPEG";
+    return nullptr;                                   // Scaled down to fit by the decoder
+  case IMAGE_FORMAT_PNG:
+    if (info.Flags & IMAGE_INFO_INTERLACED)
+      return "interlaced PNG";
+    break;
+  case IMAGE_FORMAT_BLT:
+    return nullptr;                                   // Any size, shown through the viewport
+  }
+  if (info.Width > MAX_IMAGE_WIDTH)
+    return "wider than the line buffer";
+  return nullptr;
+}
+
+const char* Image_Format_Name(uint8_t format)
+{
+  static const char* names[] = { "?", "png", "jpg", "blt", "565", "p8", "rle", "bla" };
+  return format < sizeof(names) / sizeof(names[0]) ? names[format] : "?";
+}
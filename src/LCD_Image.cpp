@@ -1,35 +1,237 @@
 #include "LCD_Image.h"
+#include <TJpg_Decoder.h>
+#include "Tiled_Image.h"
+#include "Raw_Image.h"
+#include "Anim_Player.h"
+#include "Mem_Budget.h"
+#include "Blit_Queue.h"
+#include "Ambient_Color.h"
+#include "Pixel_Convert.h"
   
 PNG png;
-File Image_file;
+static SD_Reader Image_file;
 
 uint16_t Image_CNT;   
 char SD_Image_Name[100][100] ;    
 char File_Image_Name[100][100] ;  
+Image_Info Image_Catalog[100];
+static char Catalog_Directory[100] = "";
+static char Catalog_Extension[100] = "";
 
 int16_t xpos = 0;
 int16_t ypos = 0;
+uint32_t Image_Output_Us = 0;
+Image_Stats Image_Last;
+static uint8_t Image_Transition = IMAGE_TRANSITION_NONE;
+static bool Image_Dither = true;         // Default for images without IMAGE_INFO_DITHER / _NO_DITHER
+static bool Line_Dither = false;         // Chosen for the PNG being decoded
+static bool Slide_Active = false;
+// Capture target: while set, decoded rows go to this portrait frame of
+// Capture_Width x Capture_Height instead of the panel
+static uint16_t* Capture_Frame = nullptr;
+static uint16_t Capture_Width = 0;
+static uint16_t Capture_Height = 0;
+static bool Capture_Rotated = false;
+// Stream target: while set, decoded blocks go to the sink unchanged (no
+// rotation, no clipping); JPEGs are decoded at Stream_Scale
+static const Image_Sink* Stream_Sink = nullptr;
+static bool Rows_Sampled = false;        // pngDraw feeds the ambient histogram itself
+static uint8_t Stream_Scale = 1;
+// PNGdec asks for a few KB at a time; the buffered reader turns that into
+// whole-block card reads and serves its seeks from memory where it can
 void * pngOpen(const char *filePath, int32_t *size) {
-  Image_file = SD.open(filePath);
-  *size = Image_file.size();
+  if (!SD_Reader_Open(Image_file, filePath)) return NULL;
+  *size = Image_file.Size;
   return &Image_file;
 }
 
 void pngClose(void *handle) {
-  File Image_file = *((File*)handle);
-  if (Image_file) Image_file.close();
+  SD_Reader_Close(*(SD_Reader*)handle);
 }
 
 int32_t pngRead(PNGFILE *page, uint8_t *buffer, int32_t length) {
-  if (!Image_file) return 0;
-  page = page; // Avoid warning
-  return Image_file.read(buffer, length);
+  return SD_Reader_Read(*(SD_Reader*)page->fHandle, buffer, length);
 }
 
 int32_t pngSeek(PNGFILE *page, int32_t position) {
-  if (!Image_file) return 0;
-  page = page; // Avoid warning
-  return Image_file.seek(position);
+  return SD_Reader_Seek(*(SD_Reader*)page->fHandle, position);
+}
+// Landscape images that would not fit across the portrait panel are shown
+// with the panel rotated, so the decoder keeps writing rows in file order
+uint8_t Image_Rotation(uint16_t width, uint16_t height)
+{
+  if (width > height && width > LCD_WIDTH)
+    return LANDSCAPE_ROTATION;
+  return LCD_ROTATE_0;
+}
+// JPEGs are decoded at the smallest of 1/1, 1/2, 1/4 and 1/8 that fits the
+// panel, so camera pictures are shown whole
+static uint8_t Jpeg_Scale(const Image_Info& info)
+{
+  for (uint8_t scale = 1; scale < 8; scale <<= 1) {
+    uint16_t w = (info.Width + scale - 1) / scale;
+    uint16_t h = (info.Height + scale - 1) / scale;
+    if (Image_Rotation(w, h) == LCD_ROTATE_0 ? w <= LCD_WIDTH && h <= LCD_HEIGHT : w <= LCD_HEIGHT && h <= LCD_WIDTH)
+      return scale;
+  }
+  return 8;
+}
+
+void Image_Output_Size(const Image_Info& info, uint16_t& width, uint16_t& height)
+{
+  uint8_t scale = info.Format == IMAGE_FORMAT_JPEG ? Jpeg_Scale(info) : 1;
+  width = (info.Width + scale - 1) / scale;
+  height = (info.Height + scale - 1) / scale;
+}
+
+void Image_Frame_Size(const Image_Info& info, uint16_t& width, uint16_t& height)
+{
+  uint16_t w, h;
+  Image_Output_Size(info, w, h);
+  if (Image_Rotation(w, h) != LCD_ROTATE_0) {
+    uint16_t t = w;
+    w = h;
+    h = t;
+  }
+  width = w < LCD_WIDTH ? w : LCD_WIDTH;
+  height = h < LCD_HEIGHT ? h : LCD_HEIGHT;
+}
+
+bool Image_Capturable(const Image_Info& info)
+{
+  return info.Format == IMAGE_FORMAT_PNG || info.Format == IMAGE_FORMAT_JPEG || info.Format == IMAGE_FORMAT_RGB565 ||
+         info.Format == IMAGE_FORMAT_INDEXED || info.Format == IMAGE_FORMAT_RLE;
+}
+// Copy a decoded block into the capture frame, clipped to it. Landscape
+// images are turned the way LANDSCAPE_ROTATION turns the panel (image row y
+// becomes frame column Capture_Width - 1 - y), so the frame is always portrait.
+static void Capture_Block(int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t* pixels)
+{
+  int16_t imageW = Capture_Rotated ? Capture_Height : Capture_Width;
+  int16_t imageH = Capture_Rotated ? Capture_Width : Capture_Height;
+  int16_t cw = w < imageW - x ? w : imageW - x;
+  int16_t ch = h < imageH - y ? h : imageH - y;
+  if (cw <= 0 || ch <= 0)
+    return;
+  for (int16_t r = 0; r < ch; r++) {
+    const uint16_t* src = pixels + r * w;
+    if (!Capture_Rotated) {
+      memcpy(Capture_Frame + (y + r) * Capture_Width + x, src, cw * sizeof(uint16_t));
+    } else {
+      uint16_t* dst = Capture_Frame + x * Capture_Width + (Capture_Width - 1 - (y + r));
+      for (int16_t c = 0; c < cw; c++, dst += Capture_Width)
+        *dst = src[c];
+    }
+  }
+}
+// Paint the panel area around an image of w x h at (x, y)
+static void Letterbox_Image(int16_t x, int16_t y, int16_t w, int16_t h)
+{
+  int16_t panelW = LCD_GetWidth();
+  int16_t panelH = LCD_GetHeight();
+  if (w > panelW) w = panelW;
+  if (h > panelH) h = panelH;
+  LCD_FillRect(0, 0, panelW, y, LETTERBOX_COLOR);                        // Top
+  LCD_FillRect(0, y + h, panelW, panelH - (y + h), LETTERBOX_COLOR);     // Bottom
+  LCD_FillRect(0, y, x, h, LETTERBOX_COLOR);                             // Left
+  LCD_FillRect(x + w, y, panelW - (x + w), h, LETTERBOX_COLOR);          // Right
+}
+// Slide-in transition: new panel row y goes to frame memory row y, then the
+// scroll start moves past it so the row appears at the bottom of the panel
+// and everything above moves up by one. Only the scroll register and the
+// new row are sent.
+static void Slide_Row(int16_t y, int16_t width)
+{
+  if (y < 0 || y >= LCD_HEIGHT)
+    return;
+  LCD_FillRect(0, y, xpos, 1, LETTERBOX_COLOR);
+  LCD_FillRect(xpos + width, y, LCD_WIDTH - (xpos + width), 1, LETTERBOX_COLOR);
+  LCD_ScrollTo(y + 1);
+}
+static void Slide_Margin(int16_t from, int16_t to)
+{
+  for (int16_t y = from; y < to; y++) {
+    LCD_FillRect(0, y, LCD_WIDTH, 1, LETTERBOX_COLOR);
+    LCD_ScrollTo(y + 1);
+  }
+}
+/******************************************************************************
+function: Output path shared by every image decoder
+          Image_Begin picks the rotation, centres the image and paints the
+          margins (or starts the slide transition), Image_Rows sends decoded
+          rows, Image_End finishes the transition. While Image_Capture
+          runs they fill its frame instead and leave the panel alone.
+parameter :
+    width, height :   Image size in pixels
+    y, rows       :   First image row and number of rows in pixels
+    pixels        :   rows * width pixels in panel byte order
+******************************************************************************/
+void Image_Begin(int16_t width, int16_t height)
+{
+  uint32_t t = micros();
+  if (Stream_Sink) {
+    Stream_Sink->Begin(width, height);
+    return;
+  }
+  Ambient_Begin(height);
+  if (Capture_Frame) {
+    Capture_Rotated = Image_Rotation(width, height) != LCD_ROTATE_0;
+    return;
+  }
+  LCD_SetRotation(Image_Rotation(width, height));
+  xpos = (LCD_GetWidth() - width) / 2;
+  ypos = (LCD_GetHeight() - height) / 2;
+  
+  // Ensure we don't have negative positions
+  if (xpos < 0) xpos = 0;
+  if (ypos < 0) ypos = 0;
+  
+  // Placed for both paths: an animation slides in its first frame only and
+  // queues the rest, which must not land where the last image was
+  Blit_Queue_Begin(xpos, ypos, width);
+  // Slide needs portrait frame memory rows, landscape images just cut in
+  Slide_Active = Image_Transition == IMAGE_TRANSITION_SLIDE && LCD_GetRotation() == LCD_ROTATE_0;
+  if (Slide_Active) {
+    LCD_ScrollArea(0, 0);
+    Slide_Margin(0, ypos);
+  } else {
+    Letterbox_Image(xpos, ypos, width, height);
+  }
+  Image_Output_Us += micros() - t;
+}
+
+void Image_Rows(int16_t y, int16_t rows, int16_t width, const uint16_t* pixels)
+{
+  uint32_t t = micros();
+  if (!Rows_Sampled)
+    Ambient_Block(0, y, width, rows, pixels);
+  if (Stream_Sink) {
+    Stream_Sink->Block(0, y, width, rows, pixels);
+  } else if (Capture_Frame) {
+    Capture_Block(0, y, width, rows, pixels);
+  } else if (!Slide_Active) {
+    Blit_Queue_Put(0, y, width, rows, pixels);                    // LCD_Blit clips against the panel
+  } else {
+    for (int16_t r = 0; r < rows; r++) {
+      LCD_Blit(xpos, ypos + y + r, width, 1, pixels + r * width);
+      Slide_Row(ypos + y + r, width);
+    }
+  }
+  Image_Output_Us += micros() - t;
+}
+
+void Image_End(int16_t height)
+{
+  uint32_t t = micros();
+  Ambient_End();
+  if (Slide_Active) {
+    Slide_Margin(ypos + height, LCD_HEIGHT);
+    LCD_ScrollOff();
+    Slide_Active = false;
+  } else if (!Capture_Frame && !Stream_Sink) {
+    Blit_Queue_Flush();
+  }
+  Image_Output_Us += micros() - t;
 }
 //=========================================v==========================================
 //                                      pngDraw
@@ -40,92 +242,383 @@ int32_t pngSeek(PNGFILE *page, int32_t position) {
 // Callback function to draw pixels to the display
 static uint16_t lineBuffer[MAX_IMAGE_WIDTH];
 int pngDraw(PNGDRAW *pDraw) {
-  png.getLineAsRGB565(pDraw, lineBuffer, PNG_RGB565_BIG_ENDIAN, 0xffffffff);
-  
   // Calculate how much of the line we can actually draw
   uint32_t size = pDraw->iWidth;
   if (size > MAX_IMAGE_WIDTH) {
     size = MAX_IMAGE_WIDTH; // Clip to buffer size
   }
   
-  // Swap byte order for all pixels
-  for (size_t i = 0; i < size; i++) {
-    lineBuffer[i] = (((lineBuffer[i] >> 8) & 0xFF) | ((lineBuffer[i] << 8) & 0xFF00));
+  // 8-bit colour converts straight to panel order, dithered if chosen; any
+  // other pixel type through PNGdec, then swapped
+  if (pDraw->iBpp == 8 && (pDraw->iPixelType == PNG_PIXEL_TRUECOLOR || pDraw->iPixelType == PNG_PIXEL_TRUECOLOR_ALPHA)) {
+    Pixel_Convert_RGB(pDraw->pPixels, pDraw->iPixelType == PNG_PIXEL_TRUECOLOR ? 3 : 4, lineBuffer, size, pDraw->y, Line_Dither);
+  } else if (pDraw->iBpp == 8 && pDraw->iPixelType == PNG_PIXEL_INDEXED) {
+    Pixel_Convert_Indexed(pDraw->pPixels, pDraw->pPalette, lineBuffer, size, pDraw->y, Line_Dither);
+  } else {
+    png.getLineAsRGB565(pDraw, lineBuffer, PNG_RGB565_BIG_ENDIAN, 0xffffffff);
+    for (size_t i = 0; i < size; i++) {
+      lineBuffer[i] = (((lineBuffer[i] >> 8) & 0xFF) | ((lineBuffer[i] << 8) & 0xFF00));
+    }
   }
   
-  // Only draw if within display bounds
-  int16_t displayY = ypos + pDraw->y;
-  if (displayY >= 0 && displayY < LCD_HEIGHT && xpos >= 0 && xpos < LCD_WIDTH) {
-    // Calculate visible width
-    int16_t visibleWidth = size;
-    if (xpos + size > LCD_WIDTH) {
-      visibleWidth = LCD_WIDTH - xpos;
-    }
-    
-    if (visibleWidth > 0) {
-      LCD_addWindow(xpos, displayY, xpos + visibleWidth, displayY + 1, lineBuffer);
-    }
+  // Every AMBIENT_STEP-th pixel of a sampled row for the ambient colour
+  if (Ambient_Row(pDraw->y)) {
+    for (size_t i = 0; i < size; i += AMBIENT_STEP)
+      Ambient_Add((lineBuffer[i] >> 8) | (lineBuffer[i] << 8));
   }
   
+  Image_Rows(pDraw->y, 1, size, lineBuffer);
+  
   return 1; // Return 1 to continue drawing
 }
 /////////////////////////////////////////////////////////////////
 
+// TJpgDec hands over decoded MCU blocks, left to right and top to bottom
+static bool jpegDraw(int16_t x, int16_t y, uint16_t w, uint16_t h, uint16_t* bitmap)
+{
+  uint32_t t = micros();
+  Ambient_Block(x, y, w, h, bitmap);
+  if (Stream_Sink)
+    Stream_Sink->Block(x, y, w, h, bitmap);
+  else if (Capture_Frame)
+    Capture_Block(x, y, w, h, bitmap);
+  else
+    Blit_Queue_Put(x, y, w, h, bitmap);                         // Batched into MCU-row strips
+  Image_Output_Us += micros() - t;
+  return true;
+}
 //////////////////////////////////////////////////////////////////////////////////////
 
+static void Image_Path(char* path, size_t size, const char* directory, const char* fileName)
+{
+  snprintf(path, size, strcmp(directory, "/") == 0 ? "%s%s" : "%s/%s", directory, fileName);
+}
+
+// List the matching files, then probe each header and keep only the ones
+// that can be shown, with their format and size in Image_Catalog
 void Search_Image(const char* directory, const char* fileExtension) {        
-  Image_CNT = Folder_retrieval(directory,fileExtension,SD_Image_Name,100);
+  uint16_t found = Folder_retrieval(directory,fileExtension,SD_Image_Name,100);
+  Image_CNT = 0;
+  for (uint16_t i = 0; i < found; i++) {
+    char path[200];
+    Image_Info info;
+    Image_Path(path, sizeof(path), directory, SD_Image_Name[i]);
+    const char* reason = Image_Probe(path, info) ? Image_Unusable(info) : "unreadable or unknown header";
+    if (reason) {
+      printf("Skipped %s: %s\r\n", path, reason);
+      continue;
+    }
+    if (Image_CNT != i)
+      strcpy(SD_Image_Name[Image_CNT], SD_Image_Name[i]);
+    Image_Catalog[Image_CNT++] = info;
+  }
+  strncpy(Catalog_Directory, directory, sizeof(Catalog_Directory) - 1);
+  strncpy(Catalog_Extension, fileExtension, sizeof(Catalog_Extension) - 1);
   if(Image_CNT) {  
     for (int i = 0; i < Image_CNT; i++) {
       strcpy(File_Image_Name[i], SD_Image_Name[i]);
       remove_file_extension(File_Image_Name[i]); 
     }                  
   }                                                             
+  Mem_Pool_Define("image_names", sizeof(SD_Image_Name) + sizeof(File_Image_Name),
+                  Image_CNT * (sizeof(SD_Image_Name[0]) + sizeof(File_Image_Name[0])));
 }
-void Show_Image(const char * filePath)
+// PNG through PNGdec, line by line
+static bool Show_PNG(const char * filePath, const Image_Info& info)
 {
-  printf("Currently display picture %s\r\n",filePath);
   int16_t ret = png.open(filePath, pngOpen, pngClose, pngRead, pngSeek, pngDraw);                 
-  if (ret == PNG_SUCCESS) {                                                                          
-    printf("image specs: (%d x %d), %d bpp, pixel type: %d\r\n", png.getWidth(), png.getHeight(), png.getBpp(), png.getPixelType()); 
-    
-    uint32_t dt = millis();
-    
-    // Center the image on the display
-    // If image is larger than display, it will be clipped
-    int16_t imageWidth = png.getWidth();
-    int16_t imageHeight = png.getHeight();
-    
-    xpos = (LCD_WIDTH - imageWidth) / 2;
-    ypos = (LCD_HEIGHT - imageHeight) / 2;
-    
-    // Ensure we don't have negative positions
-    if (xpos < 0) xpos = 0;
-    if (ypos < 0) ypos = 0;
-    
-    if (imageWidth > MAX_IMAGE_WIDTH) {                                                 
-      printf("Warning: Image width (%d) exceeds buffer size (%d), image will be clipped\r\n", imageWidth, MAX_IMAGE_WIDTH);                          
+  if (ret != PNG_SUCCESS) {
+    // PNGdec does not call pngClose when the header is bad; the reader may be open
+    SD_Reader_Close(Image_file);
+    return false;
+  }
+  printf("image specs: (%d x %d), %d bpp, pixel type: %d\r\n", png.getWidth(), png.getHeight(), png.getBpp(), png.getPixelType()); 
+  
+  // Center the image on the display
+  // If image is larger than display, it will be clipped
+  int16_t imageWidth = png.getWidth();
+  int16_t imageHeight = png.getHeight();
+  
+  if (imageWidth > MAX_IMAGE_WIDTH) {                                                 
+    printf("Image width (%d) exceeds line buffer (%d), skipped\r\n", imageWidth, MAX_IMAGE_WIDTH);                          
+    png.close();
+    return false;
+  }
+  
+  Line_Dither = info.Flags & IMAGE_INFO_DITHER ? true : info.Flags & IMAGE_INFO_NO_DITHER ? false : Image_Dither;
+  Image_Begin(imageWidth, imageHeight);
+  Rows_Sampled = true;
+  ret = png.decode(NULL, 0);                                                             
+  Rows_Sampled = false;
+  png.close();                                                                        
+  Image_End(imageHeight);
+  return ret == PNG_SUCCESS;
+}
+
+// Baseline JPEG through TJpgDec, which reads the file itself so its card
+// traffic does not show in SD_Reader_Totals
+static bool Show_JPEG(const char * filePath, const Image_Info& info)
+{
+  uint8_t scale = Stream_Sink ? Stream_Scale : Jpeg_Scale(info);
+  uint16_t width = (info.Width + scale - 1) / scale;
+  uint16_t height = (info.Height + scale - 1) / scale;
+  TJpgDec.setJpgScale(scale);
+  TJpgDec.setSwapBytes(true);                                 // Panel byte order
+  TJpgDec.setCallback(jpegDraw);
+
+  // Blocks arrive an MCU row at a time, the slide needs whole panel rows
+  uint8_t transition = Image_Transition;
+  Image_Transition = IMAGE_TRANSITION_NONE;
+  Image_Begin(width, height);
+  JRESULT ret = TJpgDec.drawFsJpg(0, 0, filePath, SD);
+  Image_End(height);
+  Image_Transition = transition;
+  return ret == JDR_OK;
+}
+// Run the decoder for the probed format and log what it cost
+static bool Image_Decode(const char * filePath, const Image_Info& info)
+{
+  SD_Reader_ResetStats();
+  Image_Output_Us = 0;
+  uint32_t start = micros();
+  Ambient_Clear();                       // Nothing still sampling from a decode that failed halfway
+  if (!Stream_Sink)
+    Ambient_Last.Valid = false;          // Formats that do not go through Image_Begin leave no colour
+  
+  bool shown;
+  switch (info.Format) {
+  case IMAGE_FORMAT_BLT:
+    shown = Show_Tiled(filePath);
+    break;
+  case IMAGE_FORMAT_BLA:
+    shown = Anim_Play(filePath, ANIM_SLIDE_MS);
+    break;
+  case IMAGE_FORMAT_JPEG:
+    shown = Show_JPEG(filePath, info);
+    break;
+  case IMAGE_FORMAT_RGB565:
+  case IMAGE_FORMAT_INDEXED:
+  case IMAGE_FORMAT_RLE:
+    shown = Show_Raw(filePath);
+    break;
+  default:
+    shown = Show_PNG(filePath, info);
+    break;
+  }
+  if (!shown)
+    return false;
+  
+  // Decode time is everything that was not spent sending rows to the panel
+  Image_Last.Format = Image_Format_Name(info.Format);
+  Image_Last.Total_Us = micros() - start;
+  Image_Last.Output_Us = Image_Output_Us;
+  Image_Last.Read_Bytes = SD_Reader_Totals.Bytes;
+  Image_Last.Card_Reads = SD_Reader_Totals.Reads;
+  Image_Last.Reads_Counted = info.Format != IMAGE_FORMAT_JPEG;
+  printf("%s: %lu ms (decode %lu ms, %s %lu ms), ", Image_Last.Format,
+         (unsigned long)(Image_Last.Total_Us / 1000), (unsigned long)((Image_Last.Total_Us - Image_Last.Output_Us) / 1000),
+         Stream_Sink ? "stream" : Capture_Frame ? "frame" : "panel", (unsigned long)(Image_Last.Output_Us / 1000));
+  if (Image_Last.Reads_Counted)
+    printf("%lu bytes in %lu card reads (%lu from buffer)\r\n", (unsigned long)Image_Last.Read_Bytes,
+           (unsigned long)Image_Last.Card_Reads, (unsigned long)SD_Reader_Totals.Hits);
+  else
+    printf("card reads not counted (TJpgDec reads the file itself)\r\n");
+  return true;
+}
+
+void Show_Image(const char * filePath, const Image_Info* known)
+{
+  printf("Currently display picture %s\r\n",filePath);
+  Image_Info info;
+  if (known)
+    info = *known;
+  else if (!Image_Probe(filePath, info)) {
+    printf("%s: not a known image format\r\n", filePath);
+    return;
+  }
+  const char* reason = Image_Unusable(info);
+  if (reason) {
+    printf("Skipped %s: %s\r\n", filePath, reason);
+    return;
+  }
+  uint16_t width, height;
+  Image_Output_Size(info, width, height);
+  printf("layout: %s %dx%d, %d bpp, shown %dx%d, rotation %d\r\n", Image_Format_Name(info.Format),
+         info.Width, info.Height, info.Bits, width, height, Image_Rotation(width, height));
+  Image_Decode(filePath, info);
+}
+
+/******************************************************************************
+function: Decode an image into memory instead of onto the panel
+parameter :
+    filePath :   File on the card
+    info     :   Its probed header, Image_Capturable must be true
+    frame    :   Image_Frame_Size pixels, filled in panel byte order
+note      :   The frame is portrait and clipped to the panel; landscape
+              images are turned as the panel would be, so the frame can
+              later be drawn with LCD_ROTATE_0.
+******************************************************************************/
+bool Image_Capture(const char * filePath, const Image_Info& info, uint16_t* frame)
+{
+  if (!frame || !Image_Capturable(info))
+    return false;
+  Image_Frame_Size(info, Capture_Width, Capture_Height);
+  Capture_Frame = frame;
+  bool ok = Image_Decode(filePath, info);
+  Capture_Frame = nullptr;
+  return ok;
+}
+
+/******************************************************************************
+function: Decode an image and hand every block to a sink
+parameter :
+    filePath :   File on the card
+    info     :   Its probed header, Image_Capturable must be true
+    sink     :   Told the decoded size, then given blocks in panel byte order
+                 as the decoder produces them (rows for PNG and raw, MCUs
+                 left to right and top to bottom for JPEG)
+    scale    :   JPEG scale, 1, 2, 4 or 8; other formats are full size
+note      :   Nothing is buffered here, so a sink can reduce an image of any
+              size in a small amount of memory.
+******************************************************************************/
+bool Image_Stream(const char * filePath, const Image_Info& info, const Image_Sink& sink, uint8_t scale)
+{
+  if (!Image_Capturable(info))
+    return false;
+  Stream_Sink = &sink;
+  Stream_Scale = scale;
+  bool ok = Image_Decode(filePath, info);
+  Stream_Sink = nullptr;
+  return ok;
+}
+
+// Show a frame filled by Image_Capture, with the current transition
+void Image_Show_Frame(const uint16_t* frame, uint16_t width, uint16_t height)
+{
+  Image_Output_Us = 0;
+  Image_Begin(width, height);
+  Image_Rows(0, height, width, frame);
+  Image_End(height);
+}
+
+// Decode-only pass for the benchmark: the decoder's output goes nowhere
+static void Null_Begin(int16_t width, int16_t height) {}
+static void Null_Block(int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t* pixels) {}
+static const Image_Sink Null_Sink = { Null_Begin, Null_Block };
+
+/******************************************************************************
+function: Show every catalog image once and print per-format averages
+parameter :
+    directory     :   Folder to scan
+    fileExtension :   '|' separated extensions, e.g. ".png|.565|.rle"
+note      :   Put the same pictures on the card in each format to compare
+              decode time, card bytes and slide-change latency per format.
+              JPEG card traffic bypasses SD_Reader and prints as
+              bytes=uncounted reads=uncounted.
+              Formats that can be streamed are also decoded once with no
+              output (decode_only_ms) and shown once with the blit queue
+              off (unqueued_ms). The blit queue sends synchronously and
+              decode and panel transfer share the CPU and the SPI bus, so
+              latency_ms is expected near their sum (sum_ms) rather than
+              the larger of the two (bound_ms).
+******************************************************************************/
+void Image_Benchmark(const char* directory, const char* fileExtension)
+{
+  struct Totals { const char* Format; uint32_t Count; uint64_t Total_Us; uint64_t Output_Us; uint64_t Bytes; uint32_t Reads; uint32_t Max_Us;
+                  uint32_t Streamed; uint64_t Decode_Us; uint64_t Unqueued_Us; bool Reads_Counted; };
+  Totals totals[IMAGE_BENCH_FORMATS];
+  uint8_t formats = 0;
+
+  Search_Image(directory, fileExtension);
+  for (uint16_t i = 0; i < Image_CNT; i++) {
+    char path[200];
+    Image_Path(path, sizeof(path), directory, SD_Image_Name[i]);
+    const Image_Info& info = Image_Catalog[i];
+    uint32_t decodeUs = 0, unqueuedUs = 0;
+    bool streamed = Image_Capturable(info) && Image_Stream(path, info, Null_Sink, info.Format == IMAGE_FORMAT_JPEG ? Jpeg_Scale(info) : 1);
+    if (streamed) {
+      decodeUs = Image_Last.Total_Us;
+      Blit_Queue_Enable(false);
+      Show_Image(path, &info);
+      Blit_Queue_Enable(true);
+      unqueuedUs = Image_Last.Total_Us;
+    }
+    Image_Last.Format = nullptr;
+    Show_Image(path, &info);
+    if (!Image_Last.Format)
+      continue;
+
+    uint8_t f = 0;
+    while (f < formats && strcmp(totals[f].Format, Image_Last.Format) != 0) f++;
+    if (f == formats) {
+      if (formats == IMAGE_BENCH_FORMATS) continue;
+      totals[formats++] = { Image_Last.Format, 0, 0, 0, 0, 0, 0, 0, 0, 0, Image_Last.Reads_Counted };
     }
-    
-    ret = png.decode(NULL, 0);                                                             
-    png.close();                                                                        
-    printf("%d ms\r\n",millis()-dt);              
-  }  
+    if (streamed) {
+      totals[f].Streamed++;
+      totals[f].Decode_Us += decodeUs;
+      totals[f].Unqueued_Us += unqueuedUs;
+    }
+    totals[f].Count++;
+    totals[f].Total_Us += Image_Last.Total_Us;
+    totals[f].Output_Us += Image_Last.Output_Us;
+    totals[f].Bytes += Image_Last.Read_Bytes;
+    totals[f].Reads += Image_Last.Card_Reads;
+    if (Image_Last.Total_Us > totals[f].Max_Us) totals[f].Max_Us = Image_Last.Total_Us;
+  }
+
+  for (uint8_t f = 0; f < formats; f++) {
+    const Totals& t = totals[f];
+    printf("bench format=%s n=%lu latency_ms=%lu max_ms=%lu decode_ms=%lu panel_ms=%lu ", t.Format,
+           (unsigned long)t.Count, (unsigned long)(t.Total_Us / t.Count / 1000), (unsigned long)(t.Max_Us / 1000),
+           (unsigned long)((t.Total_Us - t.Output_Us) / t.Count / 1000), (unsigned long)(t.Output_Us / t.Count / 1000));
+    if (t.Reads_Counted)
+      printf("bytes=%lu reads=%lu\r\n", (unsigned long)(t.Bytes / t.Count), (unsigned long)(t.Reads / t.Count));
+    else
+      printf("bytes=uncounted reads=uncounted\r\n");
+    if (t.Streamed) {
+      uint32_t decode = t.Decode_Us / t.Streamed / 1000, panel = t.Output_Us / t.Count / 1000;
+      printf("bench format=%s decode_only_ms=%lu unqueued_ms=%lu sum_ms=%lu bound_ms=%lu\r\n", t.Format,
+             (unsigned long)decode, (unsigned long)(t.Unqueued_Us / t.Streamed / 1000), (unsigned long)(decode + panel),
+             (unsigned long)(decode > panel ? decode : panel));
+    }
+  }
+}
+
+void Set_Image_Transition(uint8_t Transition)
+{
+  Image_Transition = Transition;
+}
+
+// Ordered dither for 8-bit PNGs that do not choose for themselves; returns the previous setting
+bool Set_Image_Dither(bool Enabled)
+{
+  bool previous = Image_Dither;
+  Image_Dither = Enabled;
+  return previous;
+}
+
+// Path and probed header of catalog entry ID, nullptr if there are no images
+const Image_Info* Image_Select(const char* directory, const char* fileExtension, uint16_t ID, char* path, size_t size)
+{
+  // Probing every header again for each slide would cost a file open per
+  // image, so the catalog is only rebuilt for a different folder or filter
+  if (!Image_CNT || strcmp(directory, Catalog_Directory) != 0 || strcmp(fileExtension, Catalog_Extension) != 0)
+    Search_Image(directory,fileExtension);
+  if (!Image_CNT)
+    return nullptr;
+  if (ID >= Image_CNT) ID = 0;
+  Image_Path(path, size, directory, SD_Image_Name[ID]);
+  return &Image_Catalog[ID];
 }
 
 void Display_Image(const char* directory, const char* fileExtension, uint16_t ID)
 {
-  Search_Image(directory,fileExtension);
-  if(Image_CNT) {
-    String FilePath;
-    if (String(directory) == "/") {                               // Handle the case when the directory is the root
-      FilePath = String(directory) + SD_Image_Name[ID];
-    } else {
-      FilePath = String(directory) + "/" + SD_Image_Name[ID];
-    }
-    const char* filePathCStr = FilePath.c_str();          // Convert String to c_str() for Show_Image function
-    printf("Show  : %s \r\n", filePathCStr);              // Print file path for debugging
-    Show_Image(filePathCStr);                             // Show the image using the file path
+  char path[200];
+  const Image_Info* info = Image_Select(directory, fileExtension, ID, path, sizeof(path));
+  if(info) {
+    printf("Show  : %s \r\n", path);                      // Print file path for debugging
+    Show_Image(path, info);                               // Layout is known before the decoder opens
   }
   else
     printf("No files with extension '%s' found in directory: %s\r\n", fileExtension, directory);     
@@ -0,0 +1,386 @@
+#include "LED_Strip.h"
+#include "Mem_Budget.h"
+
+#include <string.h>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include "driver/rmt_tx.h"
+#include "driver/rmt_encoder.h"
+#else
+#include <stdio.h>
+#include <chrono>
+#endif
+
+LED_Stats LED_Last;
+
+static uint16_t LED_Pixels = 0;
+static uint8_t LED_Brightness = 255;
+static bool LED_Dither = true;
+static uint16_t LED_Buffer[LED_STRIP_MAX_PIXELS * 3];     // R G B in 8.8, drawn by effects
+static uint8_t LED_Wire[2][LED_STRIP_MAX_PIXELS * 3];     // G R B, scaled, owned by the RMT while queued
+static uint8_t LED_Residual[LED_STRIP_MAX_PIXELS * 3];   // Dither remainder per channel, 1/256 steps
+static uint32_t LED_Queued = 0;                           // Frames handed to the output
+static volatile uint32_t LED_Done = 0;                    // Frames fully sent
+
+// Gamma 2.2 in 8.8 fixed point, built by the compiler: x^2.2 = x^2 * x^(1/5),
+// the fifth root by Newton's method. Full scale is 255.0 rather than 256 so
+// that adding a dither remainder can never carry past 255. The extra entry
+// repeats full scale for values a fraction above 255.0.
+struct LED_GammaTable {
+  uint16_t Level[257];
+};
+
+static constexpr LED_GammaTable LED_MakeGamma()
+{
+  LED_GammaTable table = {};
+  for (int i = 0; i < 257; i++) {
+    double x = (i < 255 ? i : 255) / 255.0, root = 1.0;
+    for (int n = 0; n < 40 && x > 0; n++)
+      root = (4 * root + x / (root * root * root * root)) / 5;
+    table.Level[i] = (uint16_t)(x * x * root * 0xFF00 + 0.5);
+  }
+  return table;
+}
+
+static constexpr LED_GammaTable LED_Gamma = LED_MakeGamma();
+static_assert(LED_Gamma.Level[255] == 0xFF00 && LED_Gamma.Level[256] == 0xFF00 && LED_Gamma.Level[128] == 14330,
+              "gamma table");
+
+#ifdef ARDUINO
+
+#define LED_RMT_HZ 10000000     // 0.1 us ticks
+
+static rmt_channel_handle_t LED_Channel = nullptr;
+
+// Strip encoder: the GRB bytes through a bytes encoder, then one low
+// symbol for the latch gap, so queued frames never run into each other.
+static struct {
+  rmt_encoder_t Base;
+  rmt_encoder_handle_t Bytes;
+  rmt_encoder_handle_t Copy;
+  int State;
+  rmt_symbol_word_t Reset;
+} LED_Encoder;
+
+static size_t LED_Encode(rmt_encoder_t* encoder, rmt_channel_handle_t channel, const void* data, size_t size, rmt_encode_state_t* retState)
+{
+  rmt_encode_state_t session = RMT_ENCODING_RESET;
+  int state = RMT_ENCODING_RESET;
+  size_t symbols = 0;
+
+  if (LED_Encoder.State == 0) {
+    symbols += LED_Encoder.Bytes->encode(LED_Encoder.Bytes, channel, data, size, &session);
+    if (session & RMT_ENCODING_COMPLETE)
+      LED_Encoder.State = 1;
+    if (session & RMT_ENCODING_MEM_FULL) {
+      *retState = (rmt_encode_state_t)(state | RMT_ENCODING_MEM_FULL);
+      return symbols;
+    }
+  }
+  symbols += LED_Encoder.Copy->encode(LED_Encoder.Copy, channel, &LED_Encoder.Reset, sizeof(LED_Encoder.Reset), &session);
+  if (session & RMT_ENCODING_COMPLETE) {
+    LED_Encoder.State = 0;
+    state |= RMT_ENCODING_COMPLETE;
+  }
+  if (session & RMT_ENCODING_MEM_FULL)
+    state |= RMT_ENCODING_MEM_FULL;
+  *retState = (rmt_encode_state_t)state;
+  return symbols;
+}
+
+static esp_err_t LED_EncoderReset(rmt_encoder_t* encoder)
+{
+  rmt_encoder_reset(LED_Encoder.Bytes);
+  rmt_encoder_reset(LED_Encoder.Copy);
+  LED_Encoder.State = 0;
+  return ESP_OK;
+}
+
+static esp_err_t LED_EncoderDel(rmt_encoder_t* encoder)
+{
+  rmt_del_encoder(LED_Encoder.Bytes);
+  rmt_del_encoder(LED_Encoder.Copy);
+  return ESP_OK;
+}
+
+static bool IRAM_ATTR LED_SentISR(rmt_channel_handle_t channel, const rmt_tx_done_event_data_t* event, void* ctx)
+{
+  LED_Done = LED_Done + 1;
+  return false;
+}
+
+static uint32_t LED_Micros()
+{
+  return micros();
+}
+
+static bool LED_Output(uint16_t pin)
+{
+  rmt_tx_channel_config_t channel = {};
+  channel.gpio_num = (gpio_num_t)pin;
+  channel.clk_src = RMT_CLK_SRC_DEFAULT;
+  channel.resolution_hz = LED_RMT_HZ;
+  channel.mem_block_symbols = 48;
+  channel.trans_queue_depth = 2;                   // One frame on the wire, one waiting
+  if (rmt_new_tx_channel(&channel, &LED_Channel) != ESP_OK)
+    return false;
+
+  // WS2812: 0 = 0.3 us high / 0.9 us low, 1 = 0.9 us high / 0.3 us low
+  rmt_bytes_encoder_config_t bytes = {};
+  bytes.bit0.level0 = 1; bytes.bit0.duration0 = 3; bytes.bit0.level1 = 0; bytes.bit0.duration1 = 9;
+  bytes.bit1.level0 = 1; bytes.bit1.duration0 = 9; bytes.bit1.level1 = 0; bytes.bit1.duration1 = 3;
+  bytes.flags.msb_first = 1;
+  rmt_copy_encoder_config_t copy = {};
+  if (rmt_new_bytes_encoder(&bytes, &LED_Encoder.Bytes) != ESP_OK || rmt_new_copy_encoder(&copy, &LED_Encoder.Copy) != ESP_OK)
+    return false;
+  uint16_t half = LED_STRIP_RESET_US * (LED_RMT_HZ / 1000000) / 2;
+  LED_Encoder.Reset.level0 = 0; LED_Encoder.Reset.duration0 = half;
+  LED_Encoder.Reset.level1 = 0; LED_Encoder.Reset.duration1 = half;
+  LED_Encoder.Base.encode = LED_Encode;
+  LED_Encoder.Base.reset = LED_EncoderReset;
+  LED_Encoder.Base.del = LED_EncoderDel;
+  LED_Encoder.State = 0;
+
+  rmt_tx_event_callbacks_t callbacks = {};
+  callbacks.on_trans_done = LED_SentISR;
+  rmt_tx_register_event_callbacks(LED_Channel, &callbacks, nullptr);
+  return rmt_enable(LED_Channel) == ESP_OK;
+}
+
+static bool LED_Send(const uint8_t* wire, uint32_t size)
+{
+  rmt_transmit_config_t config = {};
+  config.loop_count = 0;
+  return rmt_transmit(LED_Channel, &LED_Encoder.Base, wire, size, &config) == ESP_OK;
+}
+
+static void LED_WaitFree()
+{
+  vTaskDelay(1);
+}
+
+#else
+
+static FILE* LED_RecordFile = nullptr;
+
+static uint32_t LED_Micros()
+{
+  using namespace std::chrono;
+  static const steady_clock::time_point start = steady_clock::now();
+  return (uint32_t)duration_cast<microseconds>(steady_clock::now() - start).count();
+}
+
+static bool LED_Output(uint16_t pin)
+{
+  return true;
+}
+
+// The stand-in "sends" immediately, so LED_Show never has to wait
+static bool LED_Send(const uint8_t* wire, uint32_t size)
+{
+  if (LED_RecordFile) {
+    uint32_t now = LED_Micros();
+    fwrite(&now, sizeof(now), 1, LED_RecordFile);
+    fwrite(wire, 1, size, LED_RecordFile);
+    fflush(LED_RecordFile);
+  }
+  LED_Done = LED_Done + 1;
+  return true;
+}
+
+static void LED_WaitFree()
+{
+}
+
+bool LED_Record(const char* filePath)
+{
+  if (LED_RecordFile)
+    fclose(LED_RecordFile);
+  LED_RecordFile = nullptr;
+  if (!filePath)
+    return true;
+  LED_RecordFile = fopen(filePath, "wb");
+  if (!LED_RecordFile)
+    return false;
+  fwrite("LEDR", 1, 4, LED_RecordFile);
+  fwrite(&LED_Pixels, sizeof(LED_Pixels), 1, LED_RecordFile);
+  return true;
+}
+
+#endif
+
+bool LED_Begin(uint8_t pin, uint16_t count)
+{
+  LED_Pixels = count < LED_STRIP_MAX_PIXELS ? count : LED_STRIP_MAX_PIXELS;
+  memset(LED_Buffer, 0, sizeof(LED_Buffer));
+  memset(LED_Residual, 0, sizeof(LED_Residual));
+  memset(&LED_Last, 0, sizeof(LED_Last));
+  if (!LED_Output(pin)) {
+    printf("LED strip output on GPIO %d failed\r\n", pin);
+    return false;
+  }
+  Mem_Pool_Define("led_strip", sizeof(LED_Buffer) + sizeof(LED_Wire) + sizeof(LED_Residual), LED_Pixels * 3 * 5);
+  printf("LED strip: %d pixels on GPIO %d\r\n", LED_Pixels, pin);
+  return true;
+}
+
+uint16_t LED_Count()
+{
+  return LED_Pixels;
+}
+
+uint16_t* LED_Frame()
+{
+  return LED_Buffer;
+}
+
+void LED_SetBrightness(uint8_t brightness)
+{
+  LED_Brightness = brightness;
+}
+
+void LED_SetDither(bool enabled)
+{
+  LED_Dither = enabled;
+  if (!enabled)
+    memset(LED_Residual, 0, sizeof(LED_Residual));
+}
+
+void LED_SetPixel(uint16_t index, uint16_t r, uint16_t g, uint16_t b)
+{
+  if (index >= LED_Pixels)
+    return;
+  uint16_t* p = LED_Buffer + index * 3;
+  p[0] = r; p[1] = g; p[2] = b;
+}
+
+void LED_Fill(uint16_t r, uint16_t g, uint16_t b)
+{
+  for (uint16_t i = 0; i < LED_Pixels; i++)
+    LED_SetPixel(i, r, g, b);
+}
+
+bool LED_Busy()
+{
+  return LED_Queued != LED_Done;
+}
+
+// Light output of an 8.8 value, in 8.8: the gamma table, interpolated
+// between entries for the fraction
+uint16_t LED_Light(uint16_t value)
+{
+  const uint16_t* entry = LED_Gamma.Level + (value >> 8);
+  return entry[0] + (((uint32_t)(entry[1] - entry[0]) * (value & 0xFF)) >> 8);
+}
+
+// One channel: gamma, brightness, then the dither remainder from last frame
+static inline uint8_t LED_Level(uint16_t value, uint32_t scale, uint8_t* residual)
+{
+  uint32_t level = (LED_Light(value) * scale) >> 8;
+  if (LED_Dither) {
+    level += *residual;
+    *residual = level & 0xFF;
+  } else {
+    level += 0x80;
+  }
+  return level >> 8;
+}
+
+bool LED_Show()
+{
+  if (!LED_Pixels)
+    return false;
+  uint32_t start = LED_Micros();
+
+  // The buffer about to be filled went out two frames ago; wait only if
+  // that frame and the one after it are both still queued.
+  if (LED_Queued - LED_Done >= 2) {
+    LED_Last.Waits++;
+    while (LED_Queued - LED_Done >= 2)
+      LED_WaitFree();
+  }
+
+  uint8_t* const frame = LED_Wire[LED_Queued & 1];
+  const uint32_t scale = LED_Brightness + 1;
+  const uint16_t* p = LED_Buffer;
+  uint8_t* wire = frame;
+  uint8_t* residual = LED_Residual;
+  for (uint16_t i = 0; i < LED_Pixels; i++, p += 3, wire += 3, residual += 3) {
+    wire[0] = LED_Level(p[1], scale, residual);
+    wire[1] = LED_Level(p[0], scale, residual + 1);
+    wire[2] = LED_Level(p[2], scale, residual + 2);
+  }
+
+  bool ok = LED_Send(frame, LED_Pixels * 3);
+  if (ok) {
+    LED_Queued++;
+    LED_Last.Frames++;
+  }
+
+  LED_Last.Show_Us = LED_Micros() - start;
+  if (LED_Last.Show_Us > LED_Last.Max_Show_Us)
+    LED_Last.Max_Show_Us = LED_Last.Show_Us;
+  return ok;
+}
+
+static uint8_t LED_Triangle(uint32_t t, uint32_t period)
+{
+  t %= period;
+  uint32_t half = period / 2;
+  return (t < half ? t : period - t) * 255 / half;
+}
+
+static void LED_Wheel(uint8_t hue, uint16_t* rgb)
+{
+  uint8_t segment = hue / 85, pos = (hue % 85) * 3;
+  uint16_t up = pos << 8, down = (255 - pos) << 8;
+  if (segment == 0)      { rgb[0] = down; rgb[1] = up;   rgb[2] = 0;    }
+  else if (segment == 1) { rgb[0] = 0;    rgb[1] = down; rgb[2] = up;   }
+  else                   { rgb[0] = up;   rgb[1] = 0;    rgb[2] = down; }
+}
+
+// Effects are a pure function of nowMs, so a recording replays exactly
+void LED_Render(uint8_t effect, uint16_t r, uint16_t g, uint16_t b, uint32_t nowMs)
+{
+  const uint16_t n = LED_Pixels;
+  uint16_t* p = LED_Buffer;
+
+  switch (effect) {
+  case LED_EFFECT_BREATHE: {
+    uint16_t level = 48 + LED_Triangle(nowMs, 2000) * 207 / 255 + 1;
+    LED_Fill((r * level) >> 8, (g * level) >> 8, (b * level) >> 8);
+    break;
+  }
+  case LED_EFFECT_CHASE: {
+    // 16 pixel tail, head moves 60 pixels per second
+    const uint16_t tail = 16;
+    uint16_t head = (uint64_t)nowMs * 60 / 1000 % (n + tail);
+    for (uint16_t i = 0; i < n; i++, p += 3) {
+      uint16_t behind = head - i;
+      uint16_t level = i <= head && behind < tail ? 256 - behind * 256 / tail : 0;
+      p[0] = (r * level) >> 8; p[1] = (g * level) >> 8; p[2] = (b * level) >> 8;
+    }
+    break;
+  }
+  case LED_EFFECT_WAVE: {
+    // 32 pixel wavelength, 40 pixels per second
+    uint32_t shift = (uint64_t)nowMs * 40 / 1000 % 32;
+    for (uint16_t i = 0; i < n; i++, p += 3) {
+      uint16_t level = 16 + LED_Triangle((i + shift) * 8, 256) * 240 / 255;
+      p[0] = (r * level) >> 8; p[1] = (g * level) >> 8; p[2] = (b * level) >> 8;
+    }
+    break;
+  }
+  case LED_EFFECT_RAINBOW: {
+    // One full rainbow along the strip, rotating every 4 s
+    uint8_t shift = nowMs % 4000 * 256 / 4000;
+    for (uint16_t i = 0; i < n; i++, p += 3)
+      LED_Wheel((uint8_t)(i * 256 / (n ? n : 1) + shift), p);
+    break;
+  }
+  default:
+    LED_Fill(r, g, b);
+    break;
+  }
+}
@@ -0,0 +1,130 @@
+#include "Latency_Trace.h"
+
+#include <stdio.h>
+#include <string.h>
+
+Latency_Stats Latency_Totals;
+
+static const char* const Latency_Names[LATENCY_STAGES] = { "pickup", "led", "screen", "settled" };
+// Stages a stage waits for, so a mark that races a new command is not credited to it
+static const uint8_t Latency_Needs[LATENCY_STAGES] = {
+  0, 1 << LATENCY_PICKUP, 1 << LATENCY_LED, 1 << LATENCY_LED,
+};
+
+// Written from the BLE task, taken over by the loop
+static volatile uint32_t Latency_Arrival = 0;
+static volatile bool Latency_New = false;
+
+static uint32_t Latency_Start = 0;
+static uint8_t Latency_Done = 0;            // Stages recorded for the traced command
+static bool Latency_Open = false;
+
+// A color write arrived; called from the BLE callback
+void Latency_Command(uint32_t nowUs)
+{
+  Latency_Totals.Commands++;
+  if (Latency_New)
+    Latency_Totals.Superseded++;               // The loop never saw the previous one
+  Latency_Arrival = nowUs;
+  Latency_New = true;
+}
+
+static uint8_t Latency_Bucket(uint32_t us)
+{
+  uint8_t bucket = us < 2 ? 0 : 31 - __builtin_clz(us);
+  return bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS - 1;
+}
+
+/******************************************************************************
+function: Record that the traced command reached a stage
+parameter:
+    stage : LATENCY_PICKUP .. LATENCY_SETTLED
+    nowUs : micros() when it got there
+******************************************************************************/
+void Latency_Mark(uint8_t stage, uint32_t nowUs)
+{
+  if (Latency_New) {
+    Latency_New = false;
+    if (Latency_Open && Latency_Done != (1 << LATENCY_STAGES) - 1)
+      Latency_Totals.Superseded++;
+    Latency_Start = Latency_Arrival;
+    Latency_Done = 0;
+    Latency_Open = true;
+  }
+  uint8_t bit = 1 << stage;
+  if (!Latency_Open || (Latency_Done & bit) || (Latency_Done & Latency_Needs[stage]) != Latency_Needs[stage])
+    return;
+  Latency_Done |= bit;
+
+  uint32_t us = nowUs - Latency_Start;
+  Latency_Stage& s = Latency_Totals.Stages[stage];
+  s.Counts[Latency_Bucket(us)]++;
+  s.Samples++;
+  if (us > s.Max_Us)
+    s.Max_Us = us;
+}
+
+// Latency below which percent of the samples fall, 0 with no samples
+uint32_t Latency_Percentile(const Latency_Stage& stage, uint8_t percent)
+{
+  if (!stage.Samples)
+    return 0;
+  uint32_t rank = ((uint64_t)stage.Samples * percent + 99) / 100;
+  if (rank == 0)
+    rank = 1;
+  uint32_t before = 0;
+  for (uint8_t b = 0; b < LATENCY_BUCKETS; b++) {
+    uint32_t count = stage.Counts[b];
+    if (before + count < rank) {
+      before += count;
+      continue;
+    }
+    uint32_t lo = b ? 1u << b : 0;
+    uint32_t hi = b < LATENCY_BUCKETS - 1 ? 1u << (b + 1) : stage.Max_Us;
+    if (hi < lo)
+      hi = lo;
+    uint32_t us = lo + (uint64_t)(hi - lo) * (rank - before) / count;
+    return us < stage.Max_Us ? us : stage.Max_Us;
+  }
+  return stage.Max_Us;
+}
+
+/******************************************************************************
+function: Describe every stage, one line each, and the trace counters
+parameter:
+    text    : Output
+    size    : Room in text; LATENCY_TEXT_MAX fits the usual spread, more is cut
+    prefix  : Put before each line ("BENCH " on the console)
+    newline : Line end
+return    : Length written
+******************************************************************************/
+size_t Latency_Format(char* text, size_t size, const char* prefix, const char* newline)
+{
+  size_t used = 0;
+  text[0] = '\0';
+  for (uint8_t i = 0; i < LATENCY_STAGES && used < size; i++) {
+    const Latency_Stage& s = Latency_Totals.Stages[i];
+    used += snprintf(text + used, size - used, "%slat_%s n=%lu p50_us=%lu p99_us=%lu max_us=%lu log2_us=", prefix,
+                     Latency_Names[i], (unsigned long)s.Samples, (unsigned long)Latency_Percentile(s, 50),
+                     (unsigned long)Latency_Percentile(s, 99), (unsigned long)s.Max_Us);
+    const char* separator = "";
+    for (uint8_t b = 0; b < LATENCY_BUCKETS && used < size; b++) {
+      if (!s.Counts[b])
+        continue;
+      used += snprintf(text + used, size - used, "%s%u:%lu", separator, b, (unsigned long)s.Counts[b]);
+      separator = ",";
+    }
+    if (used < size)
+      used += snprintf(text + used, size - used, "%s", newline);
+  }
+  if (used < size)
+    used += snprintf(text + used, size - used, "%slat commands=%lu superseded=%lu%s", prefix,
+                     (unsigned long)Latency_Totals.Commands, (unsigned long)Latency_Totals.Superseded, newline);
+  return used < size ? used : size - 1;
+}
+
+// Start the histograms over; the command in flight is still traced
+void Latency_Reset()
+{
+  memset(&Latency_Totals, 0, sizeof(Latency_Totals));
+}
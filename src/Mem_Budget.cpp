@@ -0,0 +1,132 @@
+#include "Mem_Budget.h"
+
+#include <string.h>
+
+#ifdef ARDUINO
+#include "esp_heap_caps.h"
+#endif
+
+static Mem_Pool Mem_Pools[MEM_MAX_POOLS];
+static uint8_t Mem_Pool_Total = 0;
+
+static Mem_Pool* Mem_Pool_Get(const char* name)
+{
+  for (uint8_t i = 0; i < Mem_Pool_Total; i++)
+    if (strcmp(Mem_Pools[i].Name, name) == 0)
+      return &Mem_Pools[i];
+  if (Mem_Pool_Total == MEM_MAX_POOLS)
+    return nullptr;
+  Mem_Pool* pool = &Mem_Pools[Mem_Pool_Total++];
+  pool->Name = name;
+  pool->Capacity = pool->Used = pool->Peak = 0;
+  return pool;
+}
+
+void Mem_Pool_Define(const char* name, uint32_t capacity, uint32_t used)
+{
+  Mem_Pool* pool = Mem_Pool_Get(name);
+  if (!pool)
+    return;
+  pool->Capacity = capacity;
+  Mem_Pool_Set(name, used);
+}
+
+void Mem_Pool_Use(const char* name, int32_t bytes)
+{
+  Mem_Pool* pool = Mem_Pool_Get(name);
+  if (!pool)
+    return;
+  if (bytes < 0 && (uint32_t)-bytes > pool->Used)
+    pool->Used = 0;
+  else
+    pool->Used += bytes;
+  if (pool->Used > pool->Peak)
+    pool->Peak = pool->Used;
+}
+
+void Mem_Pool_Set(const char* name, uint32_t used, uint32_t peak)
+{
+  Mem_Pool* pool = Mem_Pool_Get(name);
+  if (!pool)
+    return;
+  pool->Used = used;
+  if (peak > pool->Peak)
+    pool->Peak = peak;
+  if (used > pool->Peak)
+    pool->Peak = used;
+}
+
+const Mem_Pool* Mem_Pool_Find(const char* name)
+{
+  for (uint8_t i = 0; i < Mem_Pool_Total; i++)
+    if (strcmp(Mem_Pools[i].Name, name) == 0)
+      return &Mem_Pools[i];
+  return nullptr;
+}
+
+uint8_t Mem_Pool_Count()
+{
+  return Mem_Pool_Total;
+}
+
+const Mem_Pool* Mem_Pool_At(uint8_t index)
+{
+  return index < Mem_Pool_Total ? &Mem_Pools[index] : nullptr;
+}
+
+#ifdef ARDUINO
+
+Mem_Heap Mem_Heap_Last;
+
+struct Mem_Task {
+  TaskHandle_t Handle;
+  const char* Name;
+  uint32_t Min_Free;          // Stack bytes never touched
+};
+static Mem_Task Mem_Tasks[MEM_MAX_TASKS];
+static uint8_t Mem_Task_Total = 0;
+
+void Mem_Watch_Task(TaskHandle_t task, const char* name)
+{
+  if (!task)
+    task = xTaskGetCurrentTaskHandle();
+  for (uint8_t i = 0; i < Mem_Task_Total; i++)
+    if (Mem_Tasks[i].Handle == task)
+      return;
+  if (Mem_Task_Total == MEM_MAX_TASKS)
+    return;
+  Mem_Tasks[Mem_Task_Total++] = { task, name, 0 };
+}
+
+void Mem_Sample()
+{
+  Mem_Heap& h = Mem_Heap_Last;
+  h.Size = heap_caps_get_total_size(MALLOC_CAP_8BIT);
+  h.Free = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+  h.Min_Free = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+  h.Largest = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+  if (!h.Min_Largest || h.Largest < h.Min_Largest)
+    h.Min_Largest = h.Largest;
+
+  // The high-water mark is in bytes on ESP-IDF
+  for (uint8_t i = 0; i < Mem_Task_Total; i++)
+    Mem_Tasks[i].Min_Free = uxTaskGetStackHighWaterMark(Mem_Tasks[i].Handle);
+}
+
+void Mem_Report()
+{
+  Mem_Sample();
+  const Mem_Heap& h = Mem_Heap_Last;
+  printf("mem heap size=%lu free=%lu min_free=%lu largest=%lu min_largest=%lu\r\n",
+         (unsigned long)h.Size, (unsigned long)h.Free, (unsigned long)h.Min_Free,
+         (unsigned long)h.Largest, (unsigned long)h.Min_Largest);
+  for (uint8_t i = 0; i < Mem_Pool_Total; i++) {
+    const Mem_Pool& p = Mem_Pools[i];
+    printf("mem pool=%s used=%lu peak=%lu capacity=%lu\r\n", p.Name,
+           (unsigned long)p.Used, (unsigned long)p.Peak, (unsigned long)p.Capacity);
+  }
+  for (uint8_t i = 0; i < Mem_Task_Total; i++)
+    printf("mem stack task=%s min_free=%lu\r\n", Mem_Tasks[i].Name, (unsigned long)Mem_Tasks[i].Min_Free);
+}
+
+#endif
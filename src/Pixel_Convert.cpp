@@ -0,0 +1,126 @@
+#include "Pixel_Convert.h"
+
+#include <ctype.h>
+#include <string.h>
+
+// Byte-swapped RGB565 contribution of each channel value, indexed by value
+// plus threshold, so the extra entries at the top saturate
+struct Pixel_Tables {
+  uint16_t Red[256 + 7];
+  uint16_t Green[256 + 3];
+  uint16_t Blue[256 + 7];
+};
+
+static constexpr uint16_t Pixel_Swap(uint16_t p)
+{
+  return (uint16_t)(p >> 8 | p << 8);
+}
+
+// Truncating tables take the top bits, like getLineAsRGB565. Dithering
+// tables round against the panel's expansion of a level back to 8 bits
+// (q * 255 / 31): index v + t gives floor((v + t + 0.5) * 31 / 255), so
+// the thresholds, which average half a step, centre each tile on v and
+// black and white stay solid.
+static constexpr Pixel_Tables Pixel_MakeTables(bool dither)
+{
+  Pixel_Tables tables = {};
+  for (int i = 0; i < 256 + 7; i++) {
+    int q = dither ? (i * 62 + 31) / 510 : i >> 3;
+    q = q < 31 ? q : 31;
+    tables.Red[i] = Pixel_Swap(q << 11);
+    tables.Blue[i] = Pixel_Swap(q);
+  }
+  for (int i = 0; i < 256 + 3; i++) {
+    int q = dither ? (i * 126 + 63) / 510 : i >> 2;
+    q = q < 63 ? q : 63;
+    tables.Green[i] = Pixel_Swap(q << 5);
+  }
+  return tables;
+}
+
+static constexpr Pixel_Tables Pixel_Truncate = Pixel_MakeTables(false);
+static constexpr Pixel_Tables Pixel_Dither = Pixel_MakeTables(true);
+static_assert(Pixel_Truncate.Red[255] == 0x00F8 && Pixel_Truncate.Green[255] == 0xE007 && Pixel_Truncate.Blue[8] == 0x0100,
+              "pixel tables");
+static_assert(Pixel_Dither.Red[7] == 0 && Pixel_Dither.Red[255] == 0x00F8 && Pixel_Dither.Green[3] == 0 &&
+              Pixel_Dither.Green[255] == 0xE007, "dither tables");
+
+// Bayer matrix scaled to the bits each channel drops; row 4 is no dither
+static const uint8_t Pixel_Threshold_5[PIXEL_BAYER_SIZE + 1][PIXEL_BAYER_SIZE] = {
+  { 0, 4, 1, 5 }, { 6, 2, 7, 3 }, { 1, 5, 0, 4 }, { 7, 3, 6, 2 }, { 0, 0, 0, 0 },
+};
+static const uint8_t Pixel_Threshold_6[PIXEL_BAYER_SIZE + 1][PIXEL_BAYER_SIZE] = {
+  { 0, 2, 0, 2 }, { 3, 1, 3, 1 }, { 0, 2, 0, 2 }, { 3, 1, 3, 1 }, { 0, 0, 0, 0 },
+};
+
+// Forced inline: at -Os the compiler keeps it a call, which costs more than the pixel
+static inline __attribute__((always_inline)) uint16_t Pixel_Convert(const Pixel_Tables& table, const uint8_t* c,
+                                                                    uint8_t t5, uint8_t t6)
+{
+  return table.Red[c[0] + t5] | table.Green[c[1] + t6] | table.Blue[c[2] + t5];
+}
+
+/******************************************************************************
+function: Convert one line of 8-bit R, G, B samples to panel-order RGB565
+parameter:
+    src    : First pixel; any channels after blue (alpha) are skipped
+    stride : Bytes per pixel, 3 or 4
+    dst    : width pixels out
+    y      : Row in the image, picks the matrix row
+    dither : Ordered dither, or plain truncation
+******************************************************************************/
+void Pixel_Convert_RGB(const uint8_t* src, uint8_t stride, uint16_t* dst, uint16_t width, uint16_t y, bool dither)
+{
+  const uint8_t* t5 = Pixel_Threshold_5[dither ? y % PIXEL_BAYER_SIZE : PIXEL_BAYER_SIZE];
+  const uint8_t* t6 = Pixel_Threshold_6[dither ? y % PIXEL_BAYER_SIZE : PIXEL_BAYER_SIZE];
+  const Pixel_Tables& table = dither ? Pixel_Dither : Pixel_Truncate;
+  uint16_t x = 0;
+  for (; x + 4 <= width; x += 4, src += 4 * stride) {
+    dst[x] = Pixel_Convert(table, src, t5[0], t6[0]);
+    dst[x + 1] = Pixel_Convert(table, src + stride, t5[1], t6[1]);
+    dst[x + 2] = Pixel_Convert(table, src + 2 * stride, t5[2], t6[2]);
+    dst[x + 3] = Pixel_Convert(table, src + 3 * stride, t5[3], t6[3]);
+  }
+  for (; x < width; x++, src += stride)
+    dst[x] = Pixel_Convert(table, src, t5[x % PIXEL_BAYER_SIZE], t6[x % PIXEL_BAYER_SIZE]);
+}
+
+// One line of 8-bit palette indices, the palette as R, G, B triplets
+void Pixel_Convert_Indexed(const uint8_t* src, const uint8_t* palette, uint16_t* dst, uint16_t width, uint16_t y, bool dither)
+{
+  const uint8_t* t5 = Pixel_Threshold_5[dither ? y % PIXEL_BAYER_SIZE : PIXEL_BAYER_SIZE];
+  const uint8_t* t6 = Pixel_Threshold_6[dither ? y % PIXEL_BAYER_SIZE : PIXEL_BAYER_SIZE];
+  const Pixel_Tables& table = dither ? Pixel_Dither : Pixel_Truncate;
+  for (uint16_t x = 0; x < width; x++)
+    dst[x] = Pixel_Convert(table, palette + src[x] * 3, t5[x % PIXEL_BAYER_SIZE], t6[x % PIXEL_BAYER_SIZE]);
+}
+
+/******************************************************************************
+function: Whether a file's name asks for dither
+parameter:
+    filePath : Path or bare name; the rule is the suffix before the extension
+return    : PIXEL_DITHER_ON, PIXEL_DITHER_OFF or PIXEL_DITHER_DEFAULT
+******************************************************************************/
+uint8_t Pixel_Dither_Rule(const char* filePath)
+{
+  static const struct { const char* Suffix; uint8_t Rule; } rules[] = {
+    { ".dither", PIXEL_DITHER_ON }, { ".nodither", PIXEL_DITHER_OFF },
+  };
+  const char* name = strrchr(filePath, '/');
+  name = name ? name + 1 : filePath;
+  const char* extension = strrchr(name, '.');
+  if (!extension)
+    return PIXEL_DITHER_DEFAULT;
+  for (const auto& rule : rules) {
+    size_t length = strlen(rule.Suffix);
+    if ((size_t)(extension - name) <= length)
+      continue;
+    const char* suffix = extension - length;
+    size_t i = 0;
+    while (i < length && tolower((uint8_t)suffix[i]) == rule.Suffix[i])
+      i++;
+    if (i == length)
+      return rule.Rule;
+  }
+  return PIXEL_DITHER_DEFAULT;
+}
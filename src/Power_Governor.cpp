@@ -0,0 +1,104 @@
+#include "Power_Governor.h"
+
+#include <string.h>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include "Display_ST7789.h"
+#endif
+
+void Power_Reset(Power_State& state, uint32_t nowMs)
+{
+  memset(&state, 0, sizeof(state));
+  state.Last_Ms = nowMs;
+  state.Last.Cpu_Mhz = POWER_MHZ_BUSY;
+  state.Last.Backlight = POWER_BACKLIGHT_FULL;
+}
+
+static uint8_t Power_Backlight(uint32_t sinceInputMs)
+{
+  if (sinceInputMs >= POWER_NIGHT_AFTER_MS)
+    return POWER_BACKLIGHT_NIGHT;
+  if (sinceInputMs >= POWER_DIM_AFTER_MS)
+    return POWER_BACKLIGHT_DIM;
+  return POWER_BACKLIGHT_FULL;
+}
+
+Power_Decision Power_Decide(Power_State& state, const Power_Input& in)
+{
+  // Charge the time since the last call to what was decided then
+  uint32_t elapsed = in.Now_Ms - state.Last_Ms;
+  if (state.Last.Cpu_Mhz == POWER_MHZ_BUSY)
+    state.Stats.Busy_Ms += elapsed;
+  else
+    state.Stats.Idle_Ms += elapsed;
+  state.Last_Ms = in.Now_Ms;
+
+  const uint8_t heavy = POWER_WORK_DECODE | POWER_WORK_BLEND | POWER_WORK_UI;
+  bool busy = (in.Work & heavy) || in.Ble_Pending || in.Next_Work_Ms <= POWER_RAMP_MS;
+  if (busy)
+    state.Busy_Until_Ms = in.Now_Ms + POWER_HOLD_MS;
+
+  Power_Decision d;
+  d.Cpu_Mhz = busy || (int32_t)(state.Busy_Until_Ms - in.Now_Ms) > 0 ? POWER_MHZ_BUSY : POWER_MHZ_IDLE;
+  d.Backlight = Power_Backlight(in.Now_Ms - in.Last_Input_Ms);
+  d.Wait_Ms = POWER_FRAME_MS;
+
+  if (!in.Work && !busy) {
+    uint32_t gap = in.Next_Work_Ms == POWER_NO_WORK ? POWER_NO_WORK : in.Next_Work_Ms - POWER_RAMP_MS;
+    d.Wait_Ms = gap < POWER_POLL_MS ? gap : POWER_POLL_MS;
+  }
+
+  if (d.Cpu_Mhz != state.Last.Cpu_Mhz)
+    state.Stats.Clock_Changes++;
+  state.Last = d;
+  return d;
+}
+
+#ifdef ARDUINO
+
+Power_State Power_Governor;
+
+static uint32_t Power_Report_Ms = 0;
+
+void Power_Begin()
+{
+  Power_Reset(Power_Governor, millis());
+  Power_Report_Ms = millis();
+}
+
+static void Power_Report()
+{
+  const Power_Stats& s = Power_Governor.Stats;
+  uint32_t total = s.Busy_Ms + s.Idle_Ms;
+  if (!total)
+    return;
+  printf("power busy=%lu%% idle=%lu%% clock_changes=%lu mhz=%lu backlight=%d%%\r\n",
+         (unsigned long)(s.Busy_Ms * 100 / total), (unsigned long)(s.Idle_Ms * 100 / total),
+         (unsigned long)s.Clock_Changes, (unsigned long)getCpuFrequencyMhz(), Power_Governor.Last.Backlight);
+}
+
+/******************************************************************************
+function: Apply the governor's decision and wait for the next loop
+parameter:
+    in : what is running and queued right now
+******************************************************************************/
+void Power_Run(const Power_Input& in)
+{
+  uint8_t backlight = Power_Governor.Last.Backlight;
+  Power_Decision d = Power_Decide(Power_Governor, in);
+
+  if (getCpuFrequencyMhz() != d.Cpu_Mhz)
+    setCpuFrequencyMhz(d.Cpu_Mhz);
+  if (d.Backlight != backlight)
+    Set_Backlight(d.Backlight);
+
+  if (in.Now_Ms - Power_Report_Ms >= POWER_REPORT_MS) {
+    Power_Report_Ms = in.Now_Ms;
+    Power_Report();
+  }
+
+  delay(d.Wait_Ms);
+}
+
+#endif
@@ -0,0 +1,123 @@
+#include "Raw_Image.h"
+#include "Frame_Codec.h"
+#include "LCD_Image.h"
+
+// Strip buffers. An indexed strip is read into Raw_In.Index and expanded
+// through Raw_Palette into Raw_Pixels, a compressed strip is read into
+// Raw_In.Packed and decoded into Raw_Pixels, and a raw strip is read
+// straight into Raw_Pixels, so no path holds more than one strip in RAM.
+static uint16_t Raw_Palette[RAW_PALETTE_SIZE];
+static union {
+  uint8_t Index[RAW_STRIP_ROWS * MAX_IMAGE_WIDTH];
+  uint8_t Packed[RLE_MAX_BYTES(RAW_STRIP_ROWS * MAX_IMAGE_WIDTH)];
+} Raw_In;
+static uint16_t Raw_Pixels[RAW_STRIP_ROWS * MAX_IMAGE_WIDTH];
+static uint32_t Raw_Strip_Offset[RAW_MAX_STRIPS + 1];
+
+enum Raw_Format { RAW_RGB565, RAW_INDEXED, RAW_RLE };
+
+static bool Raw_Read(SD_Reader& file, void* buffer, uint32_t length)
+{
+  return (uint32_t)SD_Reader_Read(file, buffer, length) == length;
+}
+
+// Expand palette indices to panel pixels, four at a time
+static void Raw_Expand(const uint8_t* index, uint16_t* out, uint32_t count)
+{
+  uint32_t i = 0;
+  for (; i + 4 <= count; i += 4) {
+    out[i]     = Raw_Palette[index[i]];
+    out[i + 1] = Raw_Palette[index[i + 1]];
+    out[i + 2] = Raw_Palette[index[i + 2]];
+    out[i + 3] = Raw_Palette[index[i + 3]];
+  }
+  for (; i < count; i++)
+    out[i] = Raw_Palette[index[i]];
+}
+
+// Read whatever follows the header for the format, true if it is usable
+static bool Raw_Prepare(SD_Reader& file, Raw_Format format, const Raw_Header& header, uint16_t* stripRows)
+{
+  *stripRows = RAW_STRIP_ROWS;
+  if (format == RAW_INDEXED)
+    return Raw_Read(file, Raw_Palette, sizeof(Raw_Palette));
+  if (format == RAW_RLE) {
+    Raw_Rle_Info info;
+    if (!Raw_Read(file, &info, sizeof(info)) ||
+        info.Strip_Rows == 0 || info.Strip_Rows > RAW_STRIP_ROWS || info.Strips > RAW_MAX_STRIPS ||
+        (uint32_t)info.Strips * info.Strip_Rows < header.Height)
+      return false;
+    *stripRows = info.Strip_Rows;
+    return Raw_Read(file, Raw_Strip_Offset, (info.Strips + 1) * sizeof(uint32_t));
+  }
+  return true;
+}
+
+// False if the file cannot be shown, or is cut short: the rows read so far
+// stay on the panel but the image does not count as shown
+bool Show_Raw(const char* filePath)
+{
+  SD_Reader file;
+  if (!SD_Reader_Open(file, filePath)) {
+    printf("Raw: cannot open %s\r\n", filePath);
+    return false;
+  }
+
+  Raw_Header header;
+  Raw_Format format;
+  if (!Raw_Read(file, &header, sizeof(header))) {
+    SD_Reader_Close(file);
+    return false;
+  }
+  if (memcmp(header.Magic, RAW_MAGIC_RGB565, 4) == 0)       format = RAW_RGB565;
+  else if (memcmp(header.Magic, RAW_MAGIC_INDEXED, 4) == 0) format = RAW_INDEXED;
+  else if (memcmp(header.Magic, RAW_MAGIC_RLE, 4) == 0)     format = RAW_RLE;
+  else {
+    printf("Raw: %s is not a raw, indexed or compressed image\r\n", filePath);
+    SD_Reader_Close(file);
+    return false;
+  }
+  if (header.Width == 0 || header.Width > MAX_IMAGE_WIDTH) {
+    printf("Image width (%d) exceeds line buffer (%d), skipped\r\n", header.Width, MAX_IMAGE_WIDTH);
+    SD_Reader_Close(file);
+    return false;
+  }
+  uint16_t stripRows;
+  if (!Raw_Prepare(file, format, header, &stripRows)) {
+    printf("Raw: %s has a bad header\r\n", filePath);
+    SD_Reader_Close(file);
+    return false;
+  }
+  printf("image specs: (%d x %d), %s\r\n", header.Width, header.Height,
+         format == RAW_INDEXED ? "8-bit indexed" : format == RAW_RLE ? "RLE RGB565" : "RGB565");
+
+  Image_Begin(header.Width, header.Height);
+  bool complete = true;
+  uint16_t strip = 0;
+  for (uint16_t y = 0; y < header.Height; y += stripRows, strip++) {
+    uint16_t rows = header.Height - y < stripRows ? header.Height - y : stripRows;
+    uint32_t count = (uint32_t)rows * header.Width;
+    bool ok;
+    if (format == RAW_INDEXED) {
+      ok = Raw_Read(file, Raw_In.Index, count);
+      Raw_Expand(Raw_In.Index, Raw_Pixels, count);
+    } else if (format == RAW_RLE) {
+      uint32_t packed = Raw_Strip_Offset[strip + 1] - Raw_Strip_Offset[strip];
+      ok = packed <= sizeof(Raw_In.Packed) &&
+           SD_Reader_Seek(file, Raw_Strip_Offset[strip]) &&
+           Raw_Read(file, Raw_In.Packed, packed) &&
+           RLE_Decode(Raw_In.Packed, packed, Raw_Pixels, count);
+    } else {
+      ok = Raw_Read(file, Raw_Pixels, count * sizeof(uint16_t));
+    }
+    if (!ok) {
+      printf("Raw: %s is truncated or corrupt at row %d\r\n", filePath, y);
+      complete = false;
+      break;
+    }
+    Image_Rows(y, rows, header.Width, Raw_Pixels);
+  }
+  Image_End(header.Height);
+  SD_Reader_Close(file);
+  return complete;
+}
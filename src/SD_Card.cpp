@@ -1,11 +1,69 @@
 #include "SD_Card.h"
+#include <dirent.h>
+#include "SPI_Clock.h"
 
 uint16_t SDCard_Size;
 uint16_t Flash_Size;
 
+uint32_t SD_SPI_Hz = 0;                 // Clock the card is mounted at, 0 = not mounted
+
+// Mount the card at hz unless it already is; never formats
+static bool SD_Mount(uint32_t hz)
+{
+  if (SD_SPI_Hz == hz)
+    return true;
+  SD.end();
+  SD_SPI_Hz = SD.begin(SD_CS, SPI, hz, SD_MOUNT, 5, false) ? hz : 0;
+  return SD_SPI_Hz != 0;
+}
+
+static void SD_SetClock(uint32_t hz)
+{
+  if (!SD_Mount(hz))
+    printf("SD card: remount at %lu kHz failed\r\n", (unsigned long)(hz / 1000));
+}
+
+/******************************************************************************
+function: Clock calibration probe, the card's first blocks read at hz
+parameter:
+    hz    : Clock under test; the card is remounted if it runs at another
+    check : Checksum of the MBR and of the first SD_PROBE_SECTORS sectors of
+            the first partition, blocks that stay put while files change
+******************************************************************************/
+static bool SD_Probe(uint32_t hz, uint32_t* check)
+{
+  if (!SD_Mount(hz) || SD.cardType() == CARD_NONE)
+    return false;
+  uint8_t sector[512];
+  if (!SD.readRAW(sector, 0)) {
+    SD_SPI_Hz = 0;                       // Remount next time
+    return false;
+  }
+  uint32_t hash = SPI_Clock_Hash(SPI_CLOCK_HASH_SEED, sector, sizeof(sector));
+  uint32_t first = sector[0x1C6] | sector[0x1C7] << 8 | sector[0x1C8] << 16 | (uint32_t)sector[0x1C9] << 24;
+  if (sector[510] != 0x55 || sector[511] != 0xAA || first + SD_PROBE_SECTORS > SD.numSectors())
+    first = 1;                           // No partition table: the sectors after the boot sector
+  for (uint32_t i = 0; i < SD_PROBE_SECTORS; i++) {
+    if (!SD.readRAW(sector, first + i)) {
+      SD_SPI_Hz = 0;
+      return false;
+    }
+    hash = SPI_Clock_Hash(hash, sector, sizeof(sector));
+  }
+  *check = hash;
+  return true;
+}
+
 void SD_Init() {
-  // SD         
-  if (SD.begin(SD_CS, SPI, 80000000, "/sd", 5, true)) {
+  // SD, at the fastest clock that reads the card back; a card unreadable at
+  // every clock takes the old path, which formats a blank card
+  bool mounted = SPI_Clock_Calibrate(SPI_CLOCK_SD, "sd", SD_Probe, SD_SetClock, SD_SPI_DEFAULT);
+  if (!mounted) {
+    SD.end();
+    mounted = SD.begin(SD_CS, SPI, SD_SPI_DEFAULT, SD_MOUNT, 5, true);
+    SD_SPI_Hz = mounted ? SD_SPI_DEFAULT : 0;
+  }
+  if (mounted) {
     printf("SD card initialization successful!\r\n");
   } else {
     printf("SD card initialization failed!\r\n");
@@ -34,66 +92,111 @@ void SD_Init() {
     printf("Free space: %llu\n", totalBytes - usedBytes);
   }
 }
+/******************************************************************************
+function: Walk a directory through the VFS iterator, without opening files
+parameter:
+    directory     : Folder on the card, "/" for the root
+    fileExtension : '|' separated extensions to keep, "" for every file
+    visit, ctx    : Called with each matching file name
+return   : Files visited, or -1 if the directory cannot be opened
+note     : readdir hands back the name and type straight from the FAT
+           directory entry, so rejected entries and subdirectories cost no
+           file open, and nothing is allocated per entry.
+******************************************************************************/
+int32_t SD_Enumerate(const char* directory, const char* fileExtension, SD_Visitor visit, void* ctx)
+{
+  char path[SD_PATH_MAX];
+  snprintf(path, sizeof(path), strcmp(directory, "/") == 0 ? "%s" : "%s%s", SD_MOUNT, directory);
+  DIR* dir = opendir(path);
+  if (!dir)
+    return -1;
+  int32_t count = 0;
+  while (struct dirent* entry = readdir(dir)) {
+    if (entry->d_type == DT_DIR || (*fileExtension && !Match_Extension(entry->d_name, fileExtension)))
+      continue;
+    count++;
+    if (!visit(entry->d_name, ctx))
+      break;
+  }
+  closedir(dir);
+  return count;
+}
+
+struct Name_Search {
+  const char* Name;
+  bool        Found;
+};
+
+static bool Name_Match(const char* name, void* ctx)
+{
+  Name_Search* search = (Name_Search*)ctx;
+  search->Found = strcmp(name, search->Name) == 0;
+  return !search->Found;
+}
+
 bool File_Search(const char* directory, const char* fileName)    
 {
-  File Path = SD.open(directory);
-  if (!Path) {
+  Name_Search search = { fileName, false };
+  if (SD_Enumerate(directory, "", Name_Match, &search) < 0) {
     printf("Path: <%s> does not exist\r\n",directory);
     return false;
   }
-  File file = Path.openNextFile();
-  while (file) {
-    if (strcmp(file.name(), fileName) == 0) {                           
-      if (strcmp(directory, "/") == 0)
-        printf("File '%s%s' found in root directory.\r\n",directory,fileName);  
-      else
-        printf("File '%s/%s' found in root directory.\r\n",directory,fileName); 
-      Path.close();                                                     
-      return true;                                                     
-    }
-    file = Path.openNextFile();                                        
-  }
   if (strcmp(directory, "/") == 0)
-    printf("File '%s%s' not found in root directory.\r\n",directory,fileName);           
+    printf("File '%s%s' %s in root directory.\r\n",directory,fileName,search.Found ? "found" : "not found");
   else
-    printf("File '%s/%s' not found in root directory.\r\n",directory,fileName);          
-  Path.close();                                                         
-  return false;                                                         
+    printf("File '%s/%s' %s in root directory.\r\n",directory,fileName,search.Found ? "found" : "not found");
+  return search.Found;                                                         
 }
+
+struct Name_List {
+  char (*Names)[100];
+  uint16_t Count;
+  uint16_t Max;
+};
+
+static bool Name_Add(const char* name, void* ctx)
+{
+  Name_List* list = (Name_List*)ctx;
+  strncpy(list->Names[list->Count], name, sizeof(list->Names[0]) - 1);
+  list->Names[list->Count][sizeof(list->Names[0]) - 1] = '\0';
+  return ++list->Count < list->Max;
+}
+
 uint16_t Folder_retrieval(const char* directory, const char* fileExtension, char File_Name[][100],uint16_t maxFiles)    
 {
-  File Path = SD.open(directory);
-  if (!Path) {
+  if (!maxFiles)
+    return 0;
+  Name_List list = { File_Name, 0, maxFiles };
+  uint32_t start = micros();
+  if (SD_Enumerate(directory, fileExtension, Name_Add, &list) < 0) {
     printf("Path: <%s> does not exist\r\n",directory);
-    return false;
-  }
-  
-  uint16_t fileCount = 0;
-  char filePath[100];
-  File file = Path.openNextFile();
-  while (file && fileCount < maxFiles) {
-    if (!file.isDirectory() && strstr(file.name(), fileExtension)) {
-      strncpy(File_Name[fileCount], file.name(), sizeof(File_Name[fileCount])); 
-      if (strcmp(directory, "/") == 0) {                                      
-        snprintf(filePath, 100, "%s%s", directory, file.name());   
-      } else {                                                            
-        snprintf(filePath, 100, "%s/%s", directory, file.name());
-      }
-      printf("File found: %s\r\n", filePath);
-      fileCount++;
-    }
-    file = Path.openNextFile();                                      
+    return 0;
   }
-  Path.close();                                                         
-  if (fileCount > 0) {
-    printf(" %d <%s> files were retrieved\r\n",fileCount,fileExtension);
-    return fileCount;                                                 
+  if (list.Count > 0) {
+    printf(" %d <%s> files were retrieved in %lu ms\r\n",list.Count,fileExtension,(unsigned long)((micros() - start) / 1000));
+    return list.Count;                                                 
   } else {
     printf("No files with extension '%s' found in directory: %s\r\n", fileExtension, directory);
     return 0;                                                         
   }
 }
 
+// True if fileName ends with one of the '|' separated extensions, ignoring case
+bool Match_Extension(const char* fileName, const char* extensions)
+{
+  size_t nameLen = strlen(fileName);
+  const char* ext = extensions;
+  while (*ext) {
+    const char* end = strchr(ext, '|');
+    size_t extLen = end ? (size_t)(end - ext) : strlen(ext);
+    if (extLen && extLen <= nameLen && strncasecmp(fileName + nameLen - extLen, ext, extLen) == 0)
+      return true;
+    if (!end) break;
+    ext = end + 1;
+  }
+  return false;
+}
+
 void remove_file_extension(char *file_name) {
   char *last_dot = strrchr(file_name, '.');
   if (last_dot != NULL) {
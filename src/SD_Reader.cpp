@@ -0,0 +1,147 @@
+#include "SD_Reader.h"
+#include "Mem_Budget.h"
+#include "SPI_Clock.h"
+
+SD_Reader_Stats SD_Reader_Totals;
+
+bool SD_Reader_Open(SD_Reader& reader, const char* filePath)
+{
+  reader.Data = nullptr;
+  reader.Handle = SD.open(filePath);
+  if (!reader.Handle)
+    return false;
+  reader.Data = (uint8_t*)malloc(2 * SD_READER_BLOCK);
+  if (!reader.Data) {
+    printf("SD reader: no memory for %s\r\n", filePath);
+    reader.Handle.close();
+    return false;
+  }
+  Mem_Pool_Use("sd_reader", 2 * SD_READER_BLOCK);
+  reader.Size = reader.Handle.size();
+  reader.Position = 0;
+  reader.Card_Position = 0;
+  reader.Length[0] = reader.Length[1] = 0;
+  reader.Start[0] = reader.Start[1] = 0;
+  reader.Recent = 0;
+  return true;
+}
+
+void SD_Reader_Close(SD_Reader& reader)
+{
+  if (reader.Handle) reader.Handle.close();
+  if (reader.Data)
+    Mem_Pool_Use("sd_reader", -2 * SD_READER_BLOCK);
+  free(reader.Data);
+  reader.Data = nullptr;
+}
+
+void SD_Reader_ResetStats()
+{
+  memset(&SD_Reader_Totals, 0, sizeof(SD_Reader_Totals));
+}
+
+// One card transfer, seeking first only if the card is somewhere else
+static uint32_t SD_Reader_Fetch(SD_Reader& reader, uint32_t position, uint8_t* buffer, uint32_t length)
+{
+  if (reader.Card_Position != position) {
+    SD_Reader_Totals.Seeks++;
+    if (!reader.Handle.seek(position)) {
+      SPI_Clock_Error(SPI_CLOCK_SD);
+      return 0;
+    }
+  }
+  uint32_t got = reader.Handle.read(buffer, length);
+  SD_Reader_Totals.Reads++;
+  SD_Reader_Totals.Bytes += got;
+  reader.Card_Position = position + got;
+  // Short of the end of the file, a short read is the card failing
+  if (got < length && position + got < reader.Size)
+    SPI_Clock_Error(SPI_CLOCK_SD);
+  else
+    SPI_Clock_Good(SPI_CLOCK_SD);
+  return got;
+}
+
+// Load the block holding position, both blocks when streaming forwards
+static bool SD_Reader_Load(SD_Reader& reader, uint32_t position)
+{
+  uint32_t start = position & ~(uint32_t)(SD_READER_BLOCK - 1);
+  uint8_t last = reader.Recent;
+  bool sequential = reader.Length[last] && start == reader.Start[last] + reader.Length[last];
+
+  if (sequential) {
+    uint32_t got = SD_Reader_Fetch(reader, start, reader.Data, 2 * SD_READER_BLOCK);
+    reader.Start[0] = start;
+    reader.Length[0] = got < SD_READER_BLOCK ? got : SD_READER_BLOCK;
+    reader.Start[1] = start + SD_READER_BLOCK;
+    reader.Length[1] = got > SD_READER_BLOCK ? got - SD_READER_BLOCK : 0;
+    reader.Recent = 0;
+    return got > position - start;
+  }
+
+  uint8_t slot = last ^ 1;
+  uint32_t got = SD_Reader_Fetch(reader, start, reader.Data + slot * SD_READER_BLOCK, SD_READER_BLOCK);
+  reader.Start[slot] = start;
+  reader.Length[slot] = got;
+  reader.Recent = slot;
+  return got > position - start;
+}
+
+bool SD_Reader_Seek(SD_Reader& reader, uint32_t position)
+{
+  if (!reader.Handle || position > reader.Size)
+    return false;
+  reader.Position = position;
+  return true;
+}
+
+int32_t SD_Reader_Read(SD_Reader& reader, void* buffer, uint32_t length)
+{
+  if (!reader.Handle)
+    return 0;
+  if (length > reader.Size - reader.Position)
+    length = reader.Size - reader.Position;
+
+  uint8_t* out = (uint8_t*)buffer;
+  uint32_t done = 0;
+  bool card = false;
+  while (done < length) {
+    // Serve what the buffers hold
+    bool served = false;
+    for (uint8_t slot = 0; slot < 2; slot++) {
+      uint32_t offset = reader.Position - reader.Start[slot];
+      if (reader.Position >= reader.Start[slot] && offset < reader.Length[slot]) {
+        uint32_t n = reader.Length[slot] - offset;
+        if (n > length - done) n = length - done;
+        memcpy(out + done, reader.Data + slot * SD_READER_BLOCK + offset, n);
+        reader.Position += n;
+        done += n;
+        reader.Recent = slot;
+        served = true;
+        break;
+      }
+    }
+    if (served)
+      continue;
+
+    card = true;
+    uint32_t rest = length - done;
+    if (rest >= SD_READER_BLOCK) {
+      uint32_t got = SD_Reader_Fetch(reader, reader.Position, out + done, rest);
+      reader.Position += got;
+      done += got;
+      if (got < rest)
+        break;
+    } else if (!SD_Reader_Load(reader, reader.Position)) {
+      break;
+    }
+  }
+  if (!card && done)
+    SD_Reader_Totals.Hits++;
+  return done;
+}
+
+bool SD_Reader_ReadAt(SD_Reader& reader, uint32_t position, void* buffer, uint32_t length)
+{
+  return SD_Reader_Seek(reader, position) && (uint32_t)SD_Reader_Read(reader, buffer, length) == length;
+}
@@ -0,0 +1,139 @@
+#include "SPI_Clock.h"
+
+#include <Preferences.h>
+
+SPI_Clock_Device SPI_Clock[SPI_CLOCK_DEVICES];
+
+static const uint32_t SPI_Clock_Steps[SPI_CLOCK_STEPS] = SPI_CLOCK_LADDER;
+
+// What NVS keeps per device, under the device name
+struct SPI_Clock_Record {
+  uint32_t Hz;
+  uint32_t Reference;
+};
+
+static Preferences SPI_Clock_Prefs;
+
+static bool SPI_Clock_Open()
+{
+  static bool open = false;
+  if (!open)
+    open = SPI_Clock_Prefs.begin(SPI_CLOCK_NAMESPACE, false);
+  return open;
+}
+
+static bool SPI_Clock_Load(const char* name, SPI_Clock_Record& record)
+{
+  return SPI_Clock_Open() && SPI_Clock_Prefs.getBytesLength(name) == sizeof(record) &&
+         SPI_Clock_Prefs.getBytes(name, &record, sizeof(record)) == sizeof(record);
+}
+
+static void SPI_Clock_Save(const SPI_Clock_Device& device)
+{
+  SPI_Clock_Record record = { device.Hz, device.Reference };
+  if (!SPI_Clock_Open() || SPI_Clock_Prefs.putBytes(device.Name, &record, sizeof(record)) != sizeof(record))
+    printf("SPI clock %s: could not store the clock\r\n", device.Name);
+}
+
+// FNV-1a over a block, chained through hash
+uint32_t SPI_Clock_Hash(uint32_t hash, const uint8_t* data, uint32_t length)
+{
+  while (length--) {
+    hash ^= *data++;
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+// SPI_CLOCK_PASSES probes in a row at hz that all read reference
+static bool SPI_Clock_Stable(SPI_Clock_Probe probe, uint32_t hz, uint32_t reference)
+{
+  for (uint8_t pass = 0; pass < SPI_CLOCK_PASSES; pass++) {
+    uint32_t check;
+    if (!probe(hz, &check) || check != reference)
+      return false;
+  }
+  return true;
+}
+
+/******************************************************************************
+function: Find the fastest clock a device reads back reliably
+parameter:
+    device    : SPI_CLOCK_SD, SPI_CLOCK_LCD
+    name      : NVS key and log name
+    probe     : Moves the known block at a clock
+    apply     : Switches the device to a clock; called with the result
+    defaultHz : Kept if the device cannot be read back
+return    : Whether the clock was verified; apply is not called otherwise
+******************************************************************************/
+bool SPI_Clock_Calibrate(uint8_t device, const char* name, SPI_Clock_Probe probe, SPI_Clock_Apply apply, uint32_t defaultHz)
+{
+  SPI_Clock_Device& d = SPI_Clock[device];
+  uint32_t start = millis();
+  d.Name = name;
+  d.Apply = apply;
+  d.Hz = defaultHz;
+  d.Errors = 0;
+  d.Verified = false;
+  d.Pending = false;
+
+  // The stored clock, if it still reads the stored block
+  SPI_Clock_Record stored;
+  if (SPI_Clock_Load(name, stored) && SPI_Clock_Stable(probe, stored.Hz, stored.Reference)) {
+    d.Hz = stored.Hz;
+    d.Reference = stored.Reference;
+    d.Verified = true;
+  }
+
+  // Otherwise the reference from the bottom rung, then down from the top
+  if (!d.Verified && probe(SPI_Clock_Steps[SPI_CLOCK_STEPS - 1], &d.Reference)) {
+    uint8_t step = 0;
+    while (step < SPI_CLOCK_STEPS - 1 && !SPI_Clock_Stable(probe, SPI_Clock_Steps[step], d.Reference))
+      step++;
+    d.Hz = SPI_Clock_Steps[step];
+    d.Verified = true;
+    SPI_Clock_Save(d);
+  }
+
+  d.Calibrate_Ms = millis() - start;
+  if (!d.Verified) {
+    printf("SPI clock %s: no read-back, keeping %lu kHz (%lu ms)\r\n", name, (unsigned long)(d.Hz / 1000),
+           (unsigned long)d.Calibrate_Ms);
+    return false;
+  }
+  apply(d.Hz);
+  printf("SPI clock %s: %lu kHz verified in %lu ms\r\n", name, (unsigned long)(d.Hz / 1000),
+         (unsigned long)d.Calibrate_Ms);
+  return true;
+}
+
+// A transfer failed; after SPI_CLOCK_ERRORS in a row the device drops one rung
+void SPI_Clock_Error(uint8_t device)
+{
+  SPI_Clock_Device& d = SPI_Clock[device];
+  if (!d.Apply || ++d.Errors < SPI_CLOCK_ERRORS)
+    return;
+  d.Errors = 0;
+  uint8_t step = 0;
+  while (step < SPI_CLOCK_STEPS && SPI_Clock_Steps[step] >= d.Hz)
+    step++;
+  if (step == SPI_CLOCK_STEPS)
+    return;                                                    // Already at the bottom
+  printf("SPI clock %s: errors at %lu kHz, falling back to %lu kHz\r\n", d.Name, (unsigned long)(d.Hz / 1000),
+         (unsigned long)(SPI_Clock_Steps[step] / 1000));
+  d.Hz = SPI_Clock_Steps[step];
+  d.Pending = true;
+  if (d.Verified)
+    SPI_Clock_Save(d);                                         // Next boot starts from the rung that held
+}
+
+// Switch devices that stepped down; call where no transfer is in flight
+void SPI_Clock_Poll()
+{
+  for (SPI_Clock_Device& d : SPI_Clock) {
+    if (d.Pending) {
+      d.Pending = false;
+      d.Apply(d.Hz);
+    }
+  }
+}
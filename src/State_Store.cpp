@@ -0,0 +1,91 @@
+#include "State_Store.h"
+
+#include <string.h>
+
+#ifdef ARDUINO
+#include <Preferences.h>
+#endif
+
+/******************************************************************************
+function: Load the saved snapshot and start the write interval
+parameter:
+    store    : State to set up
+    kv       : Where snapshots are kept
+    nowMs    : millis(); the first write comes at least Interval_Ms later
+    restored : The saved snapshot, valid only if true is returned
+******************************************************************************/
+bool State_Begin(State_Store& store, const State_KV* kv, uint32_t nowMs, State_Snapshot& restored)
+{
+  memset(&store, 0, sizeof(store));
+  store.KV = kv;
+  store.Interval_Ms = STATE_WRITE_MS;
+  store.Last_Write_Ms = nowMs;
+
+  bool ok = kv->Load(&restored, sizeof(restored)) && restored.Version == STATE_VERSION;
+  if (ok)
+    store.Saved = restored;
+  store.Pending = store.Saved;
+  return ok;
+}
+
+void State_Update(State_Store& store, const State_Snapshot& state)
+{
+  store.Pending = state;
+  store.Pending.Version = STATE_VERSION;
+  store.Dirty = memcmp(&store.Pending, &store.Saved, sizeof(store.Saved)) != 0;
+}
+
+// Write the pending snapshot if it changed and the interval has passed
+bool State_Run(State_Store& store, uint32_t nowMs)
+{
+  if (!store.Dirty || nowMs - store.Last_Write_Ms < store.Interval_Ms)
+    return false;
+  // A failed write also waits out the interval, so a bad flash is not hammered
+  store.Last_Write_Ms = nowMs;
+  if (!store.KV->Save(&store.Pending, sizeof(store.Pending))) {
+    store.Failures++;
+    return false;
+  }
+  store.Saved = store.Pending;
+  store.Dirty = false;
+  store.Writes++;
+  return true;
+}
+
+// FNV-1a
+uint32_t State_Hash(const char* text)
+{
+  uint32_t hash = 2166136261u;
+  while (*text) {
+    hash ^= (uint8_t)*text++;
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+#ifdef ARDUINO
+
+static Preferences State_Prefs;
+
+static bool State_Nvs_Open()
+{
+  static bool open = false;
+  if (!open)
+    open = State_Prefs.begin(STATE_NAMESPACE, false);
+  return open;
+}
+
+static bool State_Nvs_Load(void* data, size_t size)
+{
+  return State_Nvs_Open() && State_Prefs.getBytesLength(STATE_KEY) == size &&
+         State_Prefs.getBytes(STATE_KEY, data, size) == size;
+}
+
+static bool State_Nvs_Save(const void* data, size_t size)
+{
+  return State_Nvs_Open() && State_Prefs.putBytes(STATE_KEY, data, size) == size;
+}
+
+const State_KV State_Nvs = { State_Nvs_Load, State_Nvs_Save };
+
+#endif
@@ -0,0 +1,303 @@
+#include "Thumb_Cache.h"
+#include "State_Store.h"
+#include "Mem_Budget.h"
+
+extern uint16_t Image_CNT;
+extern char SD_Image_Name[][100];
+
+static Thumb_Entry Thumb_Index[THUMB_MAX];
+static uint8_t Thumb_Slot[THUMB_MAX];                 // Per catalog entry: slot, THUMB_MISSING or THUMB_FAILED
+static uint16_t Thumb_Pixels[THUMB_SIZE * THUMB_SIZE];
+static char Thumb_Directory[100] = "";
+static char Thumb_Extension[100] = "";
+static bool Thumb_Ready = false;
+Thumb_Stats Thumb_Totals;
+
+// Box filter of the image being built: one sum per channel and thumbnail
+// pixel, and how many decoded columns and rows fall into each
+struct Thumb_Cell {
+  uint32_t Red;
+  uint32_t Green;
+  uint32_t Blue;
+};
+static Thumb_Cell* Thumb_Sums = nullptr;
+static uint16_t Thumb_Width = 0;
+static uint16_t Thumb_Height = 0;
+static int16_t Source_Width = 0;
+static int16_t Source_Height = 0;
+static uint16_t Thumb_Columns[THUMB_SIZE];
+static uint16_t Thumb_Rows[THUMB_SIZE];
+
+// At most THUMB_SIZE on the long side, never larger than the image
+void Thumb_Size(uint16_t width, uint16_t height, uint16_t& thumbWidth, uint16_t& thumbHeight)
+{
+  if (width >= height) {
+    thumbWidth = width < THUMB_SIZE ? width : THUMB_SIZE;
+    thumbHeight = (uint32_t)height * thumbWidth / width;
+  } else {
+    thumbHeight = height < THUMB_SIZE ? height : THUMB_SIZE;
+    thumbWidth = (uint32_t)width * thumbHeight / height;
+  }
+  if (!thumbWidth) thumbWidth = 1;
+  if (!thumbHeight) thumbHeight = 1;
+}
+
+// Largest JPEG scale whose output still covers the thumbnail
+static uint8_t Thumb_Scale(const Image_Info& info)
+{
+  if (info.Format != IMAGE_FORMAT_JPEG)
+    return 1;
+  uint8_t scale = 8;
+  while (scale > 1 && ((info.Width + scale - 1) / scale < Thumb_Width || (info.Height + scale - 1) / scale < Thumb_Height))
+    scale >>= 1;
+  return scale;
+}
+
+static void Thumb_Image_Begin(int16_t width, int16_t height)
+{
+  Source_Width = width;
+  Source_Height = height;
+  memset(Thumb_Columns, 0, sizeof(Thumb_Columns));
+  memset(Thumb_Rows, 0, sizeof(Thumb_Rows));
+  for (int32_t x = 0; x < width; x++)
+    Thumb_Columns[x * Thumb_Width / width]++;
+  for (int32_t y = 0; y < height; y++)
+    Thumb_Rows[y * Thumb_Height / height]++;
+}
+
+// Add a decoded block to the sums of the thumbnail pixels it covers
+static void Thumb_Block(int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t* pixels)
+{
+  if (!Thumb_Sums)
+    return;
+  int16_t cw = w < Source_Width - x ? w : Source_Width - x;
+  for (int16_t r = 0; r < h && y + r < Source_Height; r++) {
+    Thumb_Cell* row = Thumb_Sums + (int32_t)(y + r) * Thumb_Height / Source_Height * Thumb_Width;
+    const uint16_t* src = pixels + r * w;
+    for (int16_t c = 0; c < cw; c++) {
+      uint16_t p = (src[c] >> 8) | (src[c] << 8);                  // From panel byte order
+      Thumb_Cell& cell = row[(int32_t)(x + c) * Thumb_Width / Source_Width];
+      cell.Red += p >> 11;
+      cell.Green += (p >> 5) & 0x3F;
+      cell.Blue += p & 0x1F;
+    }
+  }
+}
+
+static const Image_Sink Thumb_Sink = { Thumb_Image_Begin, Thumb_Block };
+
+// Averages of the sums, in panel byte order
+static void Thumb_Pack()
+{
+  for (uint16_t ty = 0; ty < Thumb_Height; ty++) {
+    for (uint16_t tx = 0; tx < Thumb_Width; tx++) {
+      const Thumb_Cell& cell = Thumb_Sums[ty * Thumb_Width + tx];
+      uint32_t n = (uint32_t)Thumb_Columns[tx] * Thumb_Rows[ty];
+      uint16_t p = 0;
+      if (n)
+        p = ((cell.Red + n / 2) / n << 11) | ((cell.Green + n / 2) / n << 5) | ((cell.Blue + n / 2) / n);
+      Thumb_Pixels[ty * Thumb_Width + tx] = (p >> 8) | (p << 8);
+    }
+  }
+}
+
+static bool Thumb_Current(const Thumb_Entry& entry, uint32_t nameHash, const Image_Info& info)
+{
+  return entry.Name_Hash == nameHash && entry.File_Size == info.File_Size && entry.File_Time == info.File_Time &&
+         entry.Width && entry.Height;
+}
+
+// The slot this name had before, or one no catalog file claims
+static int16_t Thumb_Free_Slot(uint32_t nameHash)
+{
+  for (uint8_t e = 0; e < THUMB_MAX; e++)
+    if (Thumb_Index[e].Name_Hash == nameHash)
+      return e;
+  for (uint8_t e = 0; e < THUMB_MAX; e++) {
+    bool claimed = false;
+    for (uint16_t i = 0; i < Image_CNT && Thumb_Index[e].Name_Hash && !claimed; i++)
+      claimed = State_Hash(SD_Image_Name[i]) == Thumb_Index[e].Name_Hash;
+    if (!claimed)
+      return e;
+  }
+  return -1;
+}
+
+// Pixels into the slot, then the whole index
+static bool Thumb_Write(uint8_t slot, const Thumb_Entry& entry)
+{
+  if (!SD.exists(THUMB_DIRECTORY))
+    SD.mkdir(THUMB_DIRECTORY);
+  File file = SD.open(THUMB_PIXELS_FILE, SD.exists(THUMB_PIXELS_FILE) ? "r+" : FILE_WRITE);
+  if (!file)
+    return false;
+  uint32_t bytes = (uint32_t)entry.Width * entry.Height * sizeof(uint16_t);
+  bool ok = file.seek((uint32_t)slot * THUMB_SLOT_BYTES) && file.write((const uint8_t*)Thumb_Pixels, bytes) == bytes;
+  file.close();
+  if (!ok)
+    return false;
+
+  Thumb_Index[slot] = entry;
+  Thumb_Header header;
+  memcpy(header.Magic, THUMB_MAGIC, sizeof(header.Magic));
+  header.Version = THUMB_VERSION;
+  header.Size = THUMB_SIZE;
+  header.Count = THUMB_MAX;
+  file = SD.open(THUMB_INDEX_FILE, FILE_WRITE);
+  if (!file)
+    return false;
+  ok = file.write((const uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+       file.write((const uint8_t*)Thumb_Index, sizeof(Thumb_Index)) == sizeof(Thumb_Index);
+  file.close();
+  return ok;
+}
+
+/******************************************************************************
+function: Read the thumbnail index and match it against the catalog
+parameter:
+    directory     : Folder the catalog was built from
+    fileExtension : Its '|' separated extensions
+note     : Call after Search_Image. A missing or foreign index counts as
+           empty, so every thumbnail is built again.
+******************************************************************************/
+void Thumb_Begin(const char* directory, const char* fileExtension)
+{
+  strncpy(Thumb_Directory, directory, sizeof(Thumb_Directory) - 1);
+  strncpy(Thumb_Extension, fileExtension, sizeof(Thumb_Extension) - 1);
+  memset(Thumb_Index, 0, sizeof(Thumb_Index));
+  memset(&Thumb_Totals, 0, sizeof(Thumb_Totals));
+
+  File file = SD.open(THUMB_INDEX_FILE, FILE_READ);
+  if (file) {
+    Thumb_Header header;
+    bool ok = file.read((uint8_t*)&header, sizeof(header)) == sizeof(header) &&
+              memcmp(header.Magic, THUMB_MAGIC, sizeof(header.Magic)) == 0 && header.Version == THUMB_VERSION &&
+              header.Size == THUMB_SIZE && header.Count == THUMB_MAX &&
+              file.read((uint8_t*)Thumb_Index, sizeof(Thumb_Index)) == sizeof(Thumb_Index);
+    file.close();
+    if (!ok)
+      memset(Thumb_Index, 0, sizeof(Thumb_Index));
+  }
+
+  for (uint16_t i = 0; i < Image_CNT; i++) {
+    Thumb_Slot[i] = Image_Capturable(Image_Catalog[i]) ? THUMB_MISSING : THUMB_FAILED;
+    if (Thumb_Slot[i] == THUMB_FAILED)
+      continue;
+    uint32_t nameHash = State_Hash(SD_Image_Name[i]);
+    for (uint8_t e = 0; e < THUMB_MAX; e++) {
+      if (Thumb_Current(Thumb_Index[e], nameHash, Image_Catalog[i])) {
+        Thumb_Slot[i] = e;
+        Thumb_Totals.Cached++;
+        break;
+      }
+    }
+  }
+  Thumb_Ready = true;
+  Mem_Pool_Define("thumbs", sizeof(Thumb_Index) + sizeof(Thumb_Slot) + sizeof(Thumb_Pixels),
+                  sizeof(Thumb_Index) + sizeof(Thumb_Slot) + sizeof(Thumb_Pixels));
+  Mem_Pool_Define("thumb_build", THUMB_SIZE * THUMB_SIZE * sizeof(Thumb_Cell));
+  printf("thumbs: %u of %u cached\r\n", Thumb_Totals.Cached, Image_CNT);
+}
+
+bool Thumb_Pending()
+{
+  if (!Thumb_Ready)
+    return false;
+  for (uint16_t i = 0; i < Image_CNT; i++)
+    if (Thumb_Slot[i] == THUMB_MISSING)
+      return true;
+  return false;
+}
+
+// Decode one image through the box filter and store the result
+static bool Thumb_Build(uint16_t index)
+{
+  char path[200];
+  const Image_Info* info = Image_Select(Thumb_Directory, Thumb_Extension, index, path, sizeof(path));
+  if (!info)
+    return false;
+  Thumb_Size(info->Width, info->Height, Thumb_Width, Thumb_Height);
+  uint32_t bytes = (uint32_t)Thumb_Width * Thumb_Height * sizeof(Thumb_Cell);
+  Thumb_Sums = (Thumb_Cell*)calloc(Thumb_Width * Thumb_Height, sizeof(Thumb_Cell));
+  if (!Thumb_Sums) {
+    printf("thumb %s: no memory (%lu bytes)\r\n", path, (unsigned long)bytes);
+    return false;
+  }
+  Mem_Pool_Use("thumb_build", bytes);
+
+  uint32_t nameHash = State_Hash(SD_Image_Name[index]);
+  bool ok = Image_Stream(path, *info, Thumb_Sink, Thumb_Scale(*info));
+  if (ok) {
+    Thumb_Pack();
+    int16_t slot = Thumb_Free_Slot(nameHash);
+    Thumb_Entry entry = { nameHash, info->File_Size, info->File_Time, Thumb_Width, Thumb_Height };
+    ok = slot >= 0 && Thumb_Write(slot, entry);
+    if (ok)
+      Thumb_Slot[index] = slot;
+  }
+  free(Thumb_Sums);
+  Thumb_Sums = nullptr;
+  Mem_Pool_Use("thumb_build", -(int32_t)bytes);
+  return ok;
+}
+
+/******************************************************************************
+function: Build the next missing thumbnail
+parameter:
+    first : Catalog entry to start looking from, e.g. the first one on screen
+return    : The entry built (or given up on), -1 if none was missing
+note     : One decode per call, so the loop stays responsive between them.
+******************************************************************************/
+int16_t Thumb_Run(uint16_t first)
+{
+  if (!Thumb_Ready || !Image_CNT)
+    return -1;
+  for (uint16_t k = 0; k < Image_CNT; k++) {
+    uint16_t i = (first + k) % Image_CNT;
+    if (Thumb_Slot[i] != THUMB_MISSING)
+      continue;
+    uint32_t start = millis();
+    if (Thumb_Build(i)) {
+      Thumb_Totals.Built++;
+    } else {
+      Thumb_Slot[i] = THUMB_FAILED;                     // Not retried until the next Thumb_Begin
+      Thumb_Totals.Failed++;
+    }
+    uint32_t elapsed = millis() - start;
+    Thumb_Totals.Build_Ms += elapsed;
+    printf("thumb %s: %s in %lu ms\r\n", SD_Image_Name[i], Thumb_Slot[i] == THUMB_FAILED ? "failed" : "built",
+           (unsigned long)elapsed);
+    if (!Thumb_Pending())
+      printf("thumbs: %u built, %u failed, %lu ms\r\n", Thumb_Totals.Built, Thumb_Totals.Failed,
+             (unsigned long)Thumb_Totals.Build_Ms);
+    return i;
+  }
+  return -1;
+}
+
+/******************************************************************************
+function: Read the thumbnails of a run of catalog entries
+parameter:
+    first, count : Catalog entries, clipped to the catalog
+    draw         : Called for each entry in order; the pixels are only valid
+                   during the call
+return    : Thumbnails read
+******************************************************************************/
+uint16_t Thumb_Load(uint16_t first, uint16_t count, Thumb_Draw draw)
+{
+  uint16_t loaded = 0;
+  File file = SD.open(THUMB_PIXELS_FILE, FILE_READ);
+  for (uint16_t i = first; i < first + count && i < Image_CNT; i++) {
+    uint8_t slot = Thumb_Slot[i];
+    const Thumb_Entry& entry = Thumb_Index[slot < THUMB_MAX ? slot : 0];
+    uint32_t bytes = (uint32_t)entry.Width * entry.Height * sizeof(uint16_t);
+    bool ok = file && slot < THUMB_MAX && file.seek((uint32_t)slot * THUMB_SLOT_BYTES) &&
+              file.read((uint8_t*)Thumb_Pixels, bytes) == bytes;
+    if (ok)
+      loaded++;
+    draw(i, ok ? Thumb_Pixels : nullptr, entry.Width, entry.Height);
+  }
+  if (file)
+    file.close();
+  return loaded;
+}
@@ -0,0 +1,303 @@
+#include "Tiled_Image.h"
+#include "LCD_Image.h"
+#include "Mem_Budget.h"
+
+static SD_Reader Tiled_File;
+static Tiled_Header Tiled_Hdr;
+
+// Small LRU of decoded tiles. Tiled_Draw walks each strip one tile column
+// at a time, so a strip touches at most two tiles per column and a tile row
+// that fits in the cache is read from the card only once.
+struct Tiled_Slot {
+  int32_t  Tile;
+  uint32_t Used;
+};
+static uint16_t* Tiled_Cache = nullptr;
+static Tiled_Slot Tiled_Slots[TILED_CACHE_TILES];
+static uint32_t Tiled_Clock = 0;
+static uint16_t Tiled_Strip[TILED_STRIP_ROWS * LCD_HEIGHT];
+
+static const uint16_t Tiled_Background = (LETTERBOX_COLOR >> 8) | (LETTERBOX_COLOR << 8);
+
+bool Tiled_Open(const char* filePath)
+{
+  Tiled_Close();
+  if (!SD_Reader_Open(Tiled_File, filePath)) {
+    printf("Tiled: cannot open %s\r\n", filePath);
+    return false;
+  }
+  if (!SD_Reader_ReadAt(Tiled_File, 0, &Tiled_Hdr, sizeof(Tiled_Hdr)) ||
+      memcmp(Tiled_Hdr.Magic, TILED_MAGIC, 4) != 0 ||
+      Tiled_Hdr.Codec != TILED_CODEC_RAW ||
+      Tiled_Hdr.Tile_W == 0 || Tiled_Hdr.Tile_W > TILED_MAX_TILE ||
+      Tiled_Hdr.Tile_H == 0 || Tiled_Hdr.Tile_H > TILED_MAX_TILE) {
+    printf("Tiled: %s is not a supported tiled image\r\n", filePath);
+    SD_Reader_Close(Tiled_File);
+    return false;
+  }
+
+  uint32_t tilePixels = (uint32_t)Tiled_Hdr.Tile_W * Tiled_Hdr.Tile_H;
+  Tiled_Cache = (uint16_t*)malloc(TILED_CACHE_TILES * tilePixels * sizeof(uint16_t));
+  if (!Tiled_Cache) {
+    printf("Tiled: no memory for the tile cache\r\n");
+    SD_Reader_Close(Tiled_File);
+    return false;
+  }
+  Mem_Pool_Use("tile_cache", TILED_CACHE_TILES * tilePixels * sizeof(uint16_t));
+  for (int i = 0; i < TILED_CACHE_TILES; i++) {
+    Tiled_Slots[i].Tile = -1;
+    Tiled_Slots[i].Used = 0;
+  }
+  Tiled_Clock = 0;
+  return true;
+}
+
+void Tiled_Close()
+{
+  SD_Reader_Close(Tiled_File);
+  if (Tiled_Cache)
+    Mem_Pool_Use("tile_cache", -(int32_t)(TILED_CACHE_TILES * Tiled_Hdr.Tile_W * Tiled_Hdr.Tile_H * sizeof(uint16_t)));
+  free(Tiled_Cache);
+  Tiled_Cache = nullptr;
+}
+
+uint16_t Tiled_Width()
+{
+  return Tiled_Hdr.Width;
+}
+
+uint16_t Tiled_Height()
+{
+  return Tiled_Hdr.Height;
+}
+
+// Return a tile from the cache, reading it from the card on a miss.
+// Tiles that cannot be read come back as background so drawing carries on.
+static const uint16_t* Tiled_GetTile(int32_t tile)
+{
+  uint32_t tilePixels = (uint32_t)Tiled_Hdr.Tile_W * Tiled_Hdr.Tile_H;
+  int victim = 0;
+  for (int i = 0; i < TILED_CACHE_TILES; i++) {
+    if (Tiled_Slots[i].Tile == tile) {
+      Tiled_Slots[i].Used = ++Tiled_Clock;
+      return Tiled_Cache + i * tilePixels;
+    }
+    if (Tiled_Slots[i].Used < Tiled_Slots[victim].Used)
+      victim = i;
+  }
+
+  uint16_t* pixels = Tiled_Cache + victim * tilePixels;
+  uint32_t span[2];
+  bool ok = SD_Reader_ReadAt(Tiled_File, sizeof(Tiled_Header) + tile * sizeof(uint32_t), span, sizeof(span)) &&
+            span[1] - span[0] == tilePixels * sizeof(uint16_t) &&
+            SD_Reader_ReadAt(Tiled_File, span[0], pixels, tilePixels * sizeof(uint16_t));
+  if (!ok) {
+    for (uint32_t i = 0; i < tilePixels; i++)
+      pixels[i] = Tiled_Background;
+  }
+  Tiled_Slots[victim].Tile = tile;
+  Tiled_Slots[victim].Used = ++Tiled_Clock;
+  return pixels;
+}
+
+// Whole image centred on the panel, shrunk if needed but never enlarged
+Tiled_View Tiled_FitView()
+{
+  uint32_t panelW = LCD_GetWidth();
+  uint32_t panelH = LCD_GetHeight();
+  uint32_t stepX = (((uint32_t)Tiled_Hdr.Width << 16) + panelW - 1) / panelW;
+  uint32_t stepY = (((uint32_t)Tiled_Hdr.Height << 16) + panelH - 1) / panelH;
+  Tiled_View view;
+  view.Step = stepX > stepY ? stepX : stepY;
+  if (view.Step < 0x10000) view.Step = 0x10000;
+  view.X = ((int32_t)Tiled_Hdr.Width - (int32_t)((panelW * view.Step) >> 16)) / 2;
+  view.Y = ((int32_t)Tiled_Hdr.Height - (int32_t)((panelH * view.Step) >> 16)) / 2;
+  return view;
+}
+
+// Compose panel rows y..y+rows-1 (rows <= TILED_STRIP_ROWS) of a view into out
+static void Tiled_RenderRows(const Tiled_View& view, int16_t y, int16_t rows, int16_t panelW, uint16_t* out)
+{
+  const int32_t tileW = Tiled_Hdr.Tile_W;
+  const int32_t tileH = Tiled_Hdr.Tile_H;
+  const int64_t originX = (int64_t)view.X << 16;
+  const int64_t originY = (int64_t)view.Y << 16;
+
+  int32_t rowTile[TILED_STRIP_ROWS];
+  int32_t rowOffset[TILED_STRIP_ROWS];
+
+  // Source tile row and line within it for every strip row, -1 if outside
+  for (int16_t r = 0; r < rows; r++) {
+    int32_t sy = (int32_t)((originY + (int64_t)(y + r) * view.Step) >> 16);
+    if (sy < 0 || sy >= Tiled_Hdr.Height) {
+      rowTile[r] = -1;
+      continue;
+    }
+    rowTile[r] = (sy / tileH) * Tiled_Hdr.Cols;
+    rowOffset[r] = (sy % tileH) * tileW;
+  }
+
+  // Walk the strip one source tile column at a time
+  int16_t x = 0;
+  while (x < panelW) {
+    int32_t sx = (int32_t)((originX + (int64_t)x * view.Step) >> 16);
+    if (sx < 0 || sx >= Tiled_Hdr.Width) {
+      for (int16_t r = 0; r < rows; r++)
+        out[r * panelW + x] = Tiled_Background;
+      x++;
+      continue;
+    }
+    int32_t tx = sx / tileW;
+    int32_t tileX0 = tx * tileW;
+    int32_t tileX1 = tileX0 + tileW;
+    if (tileX1 > Tiled_Hdr.Width) tileX1 = Tiled_Hdr.Width;
+
+    int16_t runEnd = x;
+    while (runEnd < panelW) {
+      int32_t s = (int32_t)((originX + (int64_t)runEnd * view.Step) >> 16);
+      if (s >= tileX1) break;
+      runEnd++;
+    }
+
+    for (int16_t r = 0; r < rows; r++) {
+      uint16_t* dst = out + r * panelW;
+      if (rowTile[r] < 0) {
+        for (int16_t i = x; i < runEnd; i++)
+          dst[i] = Tiled_Background;
+        continue;
+      }
+      const uint16_t* line = Tiled_GetTile(rowTile[r] + tx) + rowOffset[r];
+      for (int16_t i = x; i < runEnd; i++)
+        dst[i] = line[((int32_t)((originX + (int64_t)i * view.Step) >> 16)) - tileX0];
+    }
+    x = runEnd;
+  }
+}
+
+/******************************************************************************
+function: Draw a view of the open tiled image over the whole panel
+parameter :
+    view :   Source window, see Tiled_View. Areas outside the image are
+             painted with LETTERBOX_COLOR.
+note     :   Sampling is nearest neighbour. Only tiles under the view are
+             read, each panel strip is composed in RAM and sent with one blit.
+******************************************************************************/
+void Tiled_Draw(const Tiled_View& view)
+{
+  if (!Tiled_Cache) return;
+  const int16_t panelW = LCD_GetWidth();
+  const int16_t panelH = LCD_GetHeight();
+  for (int16_t y = 0; y < panelH; y += TILED_STRIP_ROWS) {
+    int16_t rows = panelH - y < TILED_STRIP_ROWS ? panelH - y : TILED_STRIP_ROWS;
+    Tiled_RenderRows(view, y, rows, panelW, Tiled_Strip);
+    LCD_Blit(0, y, panelW, rows, Tiled_Strip);
+  }
+}
+
+// Pan and zoom linearly between two views over durationMs
+void Tiled_KenBurns(const Tiled_View& from, const Tiled_View& to, uint32_t durationMs)
+{
+  uint32_t start = millis();
+  uint32_t frames = 0;
+  for (;;) {
+    uint32_t elapsed = millis() - start;
+    if (elapsed > durationMs) elapsed = durationMs;
+    int64_t t = durationMs ? ((int64_t)elapsed << 16) / durationMs : 0x10000;
+
+    Tiled_View view;
+    view.X = from.X + (int32_t)(((int64_t)(to.X - from.X) * t) >> 16);
+    view.Y = from.Y + (int32_t)(((int64_t)(to.Y - from.Y) * t) >> 16);
+    view.Step = from.Step + (int32_t)(((int64_t)((int32_t)to.Step - (int32_t)from.Step) * t) >> 16);
+    Tiled_Draw(view);
+    frames++;
+    if (elapsed >= durationMs) break;
+  }
+  printf("Ken Burns: %lu frames in %lu ms\r\n", (unsigned long)frames, (unsigned long)(millis() - start));
+}
+
+// Row source for LCD_ScrollUp: panel row of the view offset by the scroll
+struct Tiled_ScrollCtx {
+  Tiled_View View;
+  int32_t    Scrolled;
+};
+static void Tiled_ScrollRow(uint16_t screenRow, uint16_t* pixels, void* ctx)
+{
+  Tiled_ScrollCtx* sc = (Tiled_ScrollCtx*)ctx;
+  Tiled_RenderRows(sc->View, sc->Scrolled + screenRow, 1, LCD_WIDTH, pixels);
+}
+
+/******************************************************************************
+function: Scroll a tall image from top to bottom with the panel's hardware
+          vertical scroll
+parameter :
+    view       :   Starting view, usually width-fitted and at the top
+    pixelsPerS :   Scroll speed in panel rows per second
+note      :   Each step moves the scroll start register and streams only the
+              rows that came into view. Portrait (LCD_ROTATE_0) only.
+******************************************************************************/
+void Tiled_ScrollDown(const Tiled_View& view, uint16_t pixelsPerS)
+{
+  // Panel rows left below the view's top, in the view's own scale
+  int32_t imageRows = (int32_t)((((int64_t)Tiled_Hdr.Height - view.Y) << 16) / view.Step);
+  int32_t total = imageRows - LCD_HEIGHT;
+  if (total <= 0 || pixelsPerS == 0 || LCD_GetRotation() != LCD_ROTATE_0)
+    return;
+
+  Tiled_ScrollCtx ctx = { view, 0 };
+  LCD_ScrollArea(0, 0);
+  uint32_t start = millis();
+  while (ctx.Scrolled < total) {
+    int32_t due = (int32_t)((uint64_t)(millis() - start) * pixelsPerS / 1000);
+    if (due > total) due = total;
+    int32_t lines = due - ctx.Scrolled;
+    if (lines <= 0) {
+      delay(1);
+      continue;
+    }
+    if (lines > TILED_STRIP_ROWS) lines = TILED_STRIP_ROWS;
+    // LCD_ScrollUp asks for the exposed screen rows after the move
+    ctx.Scrolled += lines;
+    LCD_ScrollUp(lines, Tiled_ScrollRow, &ctx);
+  }
+
+  // Hand the panel back unscrolled with the final view in place
+  Tiled_View last = view;
+  last.Y += (int32_t)(((int64_t)total * view.Step) >> 16);
+  LCD_ScrollOff();
+  Tiled_Draw(last);
+  printf("Scrolled %ld rows in %lu ms\r\n", (long)total, (unsigned long)(millis() - start));
+}
+
+bool Show_Tiled(const char* filePath)
+{
+  if (!Tiled_Open(filePath))
+    return false;
+  printf("tiled image: (%d x %d), %d x %d tiles of %d x %d\r\n", Tiled_Hdr.Width, Tiled_Hdr.Height,
+         Tiled_Hdr.Cols, Tiled_Hdr.Rows, Tiled_Hdr.Tile_W, Tiled_Hdr.Tile_H);
+
+  LCD_SetRotation(Image_Rotation(Tiled_Hdr.Width, Tiled_Hdr.Height));
+  Tiled_View fit = Tiled_FitView();
+  Tiled_Draw(fit);
+
+  // Much taller than the panel: fit the width and scroll down through it
+  if (TILED_SCROLL_PX_PER_S && LCD_GetRotation() == LCD_ROTATE_0 &&
+      (uint32_t)Tiled_Hdr.Height * LCD_WIDTH > (uint32_t)Tiled_Hdr.Width * LCD_HEIGHT * 3 / 2) {
+    Tiled_View top;
+    top.Step = (((uint32_t)Tiled_Hdr.Width << 16) + LCD_WIDTH - 1) / LCD_WIDTH;
+    if (top.Step < 0x10000) top.Step = 0x10000;
+    top.X = ((int32_t)Tiled_Hdr.Width - (int32_t)((LCD_WIDTH * top.Step) >> 16)) / 2;
+    top.Y = 0;
+    Tiled_Draw(top);
+    Tiled_ScrollDown(top, TILED_SCROLL_PX_PER_S);
+  }
+  // Larger than the panel: drift into the centre at twice the fit zoom
+  else if (TILED_KEN_BURNS_MS && fit.Step > 0x10000) {
+    Tiled_View close = fit;
+    close.Step = fit.Step / 2 > 0x10000 ? fit.Step / 2 : 0x10000;
+    close.X = ((int32_t)Tiled_Hdr.Width - (int32_t)((LCD_GetWidth() * close.Step) >> 16)) / 2;
+    close.Y = ((int32_t)Tiled_Hdr.Height - (int32_t)((LCD_GetHeight() * close.Step) >> 16)) / 2;
+    Tiled_KenBurns(fit, close, TILED_KEN_BURNS_MS);
+  }
+  Tiled_Close();
+  return true;
+}
@@ -3,18 +3,29 @@
 #include <BLEServer.h>
 #include <BLEUtils.h>
 #include <lvgl.h>
-#include <Adafruit_NeoPixel.h>
 #include <SPI.h>
 #include "PhotoViewer.h"
+#include "LED_Strip.h"
+#include "Power_Governor.h"
+#include "Mem_Budget.h"
+#include "BLE_Link.h"
+#include "State_Store.h"
+#include "Ambient_Color.h"
+#include "Bench_Console.h"
+#include "Dashboard.h"
+#include "SPI_Clock.h"
+#include "Latency_Trace.h"
 
 // Pin definitions for Waveshare ESP32-C6-LCD-1.47
-#define RGB_LED_PIN 8      // RGB LED pin
-#define RGB_LED_COUNT 1    // Single RGB LED on board
+#define RGB_LED_PIN 8      // RGB LED pin, also drives the fixture strip
+#define RGB_LED_COUNT 300  // Fixture strip length (a bare board lights only its one LED)
 #define BUTTON_PIN 0       // Side button (BOOT button)
 
 // BLE UUIDs
 #define SERVICE_UUID        "12345678-1234-1234-1234-123456789012"
 #define CHARACTERISTIC_UUID "87654321-4321-4321-4321-210987654321"
+#define TELEMETRY_UUID      "87654321-4321-4321-4321-210987654322" // Negotiated link parameters, read as text
+#define LATENCY_UUID        "87654321-4321-4321-4321-210987654323" // Command-to-photon histograms as text; a write resets them
 
 // Color variables
 float currentRed = 0.0;
@@ -25,9 +36,18 @@ float targetGreen = 0.0;
 float targetBlue = 0.0;
 bool bleConnected = false;
 bool bleColorReceived = false;
+volatile bool bleCommandPending = false; // Set by BLE writes until the loop has applied them
+unsigned long lastInputTime = 0;         // Last button press or BLE activity, for the backlight
 unsigned long lastColorChange = 0;
 const unsigned long COLOR_CHANGE_INTERVAL = 3000; // Change target color every 3 seconds
 const float FADE_SPEED = 0.5; // Speed of color transition (lower = slower)
+uint8_t ledEffect = LED_EFFECT_SOLID; // Strip effect drawn around the current color
+uint8_t bleRed = 0, bleGreen = 0, bleBlue = 0; // Last color written by a central
+bool colorHeld = false;                  // Restored BLE color, kept until a central sends another
+bool ambilight = true;                   // In photo mode the LED takes its color from the slide
+
+// Warm resume: mode, slide and BLE color, written to NVS at most once a minute
+State_Store stateStore;
 
 // Photo viewer variables
 bool photoMode = false;
@@ -35,12 +55,21 @@ unsigned long lastPhotoChange = 0;
 const unsigned long PHOTO_CHANGE_INTERVAL = 3000; // Change photo every 3 seconds
 bool photoFading = false;
 const int FADE_DURATION = 500; // Fade animation duration in ms
+bool galleryMode = false;      // Thumbnail grid instead of the slideshow
+unsigned long lastThumbBuild = 0;
+const unsigned long THUMB_BUILD_INTERVAL = 250; // Gap between background thumbnail builds outside the gallery
+
+// Memory report interval
+unsigned long lastMemoryReport = 0;
 
 // Button variables
 bool lastButtonState = HIGH;
 bool buttonState = HIGH;
 unsigned long lastDebounceTime = 0;
 const unsigned long DEBOUNCE_DELAY = 50; // 50ms debounce delay
+unsigned long buttonPressTime = 0;
+bool longPressHandled = false;
+const unsigned long LONG_PRESS_TIME = 700; // Held this long: gallery in and out
 
 // Display pins for Waveshare ESP32-C6-LCD-1.47
 #define TFT_MOSI 6
@@ -72,49 +101,98 @@ lv_obj_t* labelB = nullptr;
 lv_obj_t* labelStatus = nullptr;
 lv_obj_t* labelMode = nullptr;
 
+// The same screen from the scanline compositor, which only sends what changed
+bool scanlineUI = true;                  // false draws the LED screen with LVGL, for comparison
+int8_t dashBox = -1, dashR = -1, dashG = -1, dashB = -1, dashStatus = -1, dashMode = -1;
+
+// Photo mode: the photo as an LVGL image, with a HUD strip over its bottom edge
+#define HUD_HEIGHT 18
+lv_obj_t* photoImage = nullptr;
+lv_obj_t* hudStrip = nullptr;
+lv_obj_t* hudSwatch = nullptr;
+lv_obj_t* hudLabel = nullptr;
+
 // Hardware objects
-Adafruit_NeoPixel rgbLED(RGB_LED_COUNT, RGB_LED_PIN, NEO_GRB + NEO_KHZ800);
 BLEServer* pServer = nullptr;
 BLECharacteristic* pCharacteristic = nullptr;
+BLECharacteristic* pTelemetry = nullptr;
+BLECharacteristic* pLatency = nullptr;
 
-// BLE Server Callbacks
+// BLE Server Callbacks; the connection manager tracks each central and
+// restarts advertising while there is room for another
 class ServerCallbacks: public BLEServerCallbacks {
-  void onConnect(BLEServer* pServer) {
+  void onConnect(BLEServer* pServer, esp_ble_gatts_cb_param_t* param) {
+    BLE_Link_Connected(param, millis());
     bleConnected = true;
-    Serial.println("BLE Client connected");
+    lastInputTime = millis();
+    Serial.printf("BLE Client connected (%d of %d)\n", BLE_Link_Count(), BLE_LINK_MAX);
+  }
+  
+  void onDisconnect(BLEServer* pServer, esp_ble_gatts_cb_param_t* param) {
+    BLE_Link_Disconnected(param);
+    bleConnected = BLE_Link_Count() > 0;
+    Serial.printf("BLE Client disconnected (%d left)\n", BLE_Link_Count());
   }
   
-  void onDisconnect(BLEServer* pServer) {
-    bleConnected = false;
-    Serial.println("BLE Client disconnected");
-    // Restart advertising
-    BLEDevice::startAdvertising();
+  void onMtuChanged(BLEServer* pServer, esp_ble_gatts_cb_param_t* param) {
+    BLE_Link_Mtu(param);
   }
 };
 
+// A color command from a central (or the bench loop-back): R, G, B bytes
+bool applyColorCommand(const uint8_t* data, size_t length) {
+  if (length < 3) {
+    return false;
+  }
+  targetRed = data[0];
+  targetGreen = data[1];
+  targetBlue = data[2];
+  bleRed = data[0];
+  bleGreen = data[1];
+  bleBlue = data[2];
+  bleColorReceived = true;
+  colorHeld = false;
+  bleCommandPending = true;
+  lastInputTime = millis();
+  return true;
+}
+
 // BLE Characteristic Callbacks
 class CharacteristicCallbacks: public BLECharacteristicCallbacks {
-  void onWrite(BLECharacteristic* pCharacteristic) {
+  void onWrite(BLECharacteristic* pCharacteristic, esp_ble_gatts_cb_param_t* param) {
+    Latency_Command(micros());                    // Before anything else, the trace starts at arrival
     String value = pCharacteristic->getValue();
+    BLE_Link_Write(param->write.conn_id, millis()); // Keeps this link on the fast interval
     
-    if (value.length() >= 3) {
-      targetRed = (uint8_t)value[0];
-      targetGreen = (uint8_t)value[1];
-      targetBlue = (uint8_t)value[2];
-      bleColorReceived = true;
-      
+    if (applyColorCommand((const uint8_t*)value.c_str(), value.length())) {
       Serial.printf("BLE Color received: R=%d, G=%d, B=%d\n", 
                     (uint8_t)targetRed, (uint8_t)targetGreen, (uint8_t)targetBlue);
     }
   }
 };
 
+// Latency histograms over BLE: a read returns them as text, any write starts them over
+class LatencyCallbacks: public BLECharacteristicCallbacks {
+  void onRead(BLECharacteristic* pCharacteristic, esp_ble_gatts_cb_param_t* param) {
+    char text[LATENCY_TEXT_MAX];
+    Latency_Format(text, sizeof(text), "", "\n");
+    pCharacteristic->setValue(text);
+  }
+  
+  void onWrite(BLECharacteristic* pCharacteristic, esp_ble_gatts_cb_param_t* param) {
+    Latency_Reset();
+  }
+};
+
 // ST7789 SPI display flush callback
 void my_disp_flush(lv_disp_drv_t *disp, const lv_area_t *area, lv_color_t *color_p) {
   uint32_t w = (area->x2 - area->x1 + 1);
   uint32_t h = (area->y2 - area->y1 + 1);
   
-  SPI.beginTransaction(SPISettings(80000000, MSBFIRST, SPI_MODE0));
+  // LVGL always renders portrait, undo any per-photo panel rotation
+  LCD_SetRotation(LCD_ROTATE_0);
+  
+  SPI.beginTransaction(SPISettings(LCD_SPI_Hz, MSBFIRST, SPI_MODE0));
   digitalWrite(TFT_CS, LOW);
   
   // Set column address with offset
@@ -147,6 +225,12 @@ void my_disp_flush(lv_disp_drv_t *disp, const lv_area_t *area, lv_color_t *color
   digitalWrite(TFT_CS, HIGH);
   SPI.endTransaction();
   
+  // The scanline dashboard repaints whatever LVGL drew over it
+  Dash_Damage(area->x1, area->y1, area->x2, area->y2);
+  // The refresh that drew a new color is on the panel once its last area is
+  if (lv_disp_flush_is_last(disp)) {
+    Latency_Mark(LATENCY_SCREEN, micros());
+  }
   lv_disp_flush_ready(disp);
 }
 
@@ -172,7 +256,7 @@ void initDisplay() {
   delay(50);
   
   // ST7789 initialization sequence
-  SPI.beginTransaction(SPISettings(80000000, MSBFIRST, SPI_MODE0));
+  SPI.beginTransaction(SPISettings(LCD_SPI_Hz, MSBFIRST, SPI_MODE0));
   digitalWrite(TFT_CS, LOW);
   
   // Sleep out
@@ -209,47 +293,20 @@ void initDisplay() {
   delay(100);
   
   // Clear display to black
-  SPI.beginTransaction(SPISettings(80000000, MSBFIRST, SPI_MODE0));
-  digitalWrite(TFT_CS, LOW);
-  
-  // Set full screen window with offset
-  digitalWrite(TFT_DC, LOW);
-  SPI.write(0x2A);
-  digitalWrite(TFT_DC, HIGH);
-  SPI.write(TFT_OFFSET_X >> 8);
-  SPI.write(TFT_OFFSET_X & 0xFF);
-  SPI.write((171 + TFT_OFFSET_X) >> 8);
-  SPI.write((171 + TFT_OFFSET_X) & 0xFF);
-  
-  digitalWrite(TFT_DC, LOW);
-  SPI.write(0x2B);
-  digitalWrite(TFT_DC, HIGH);
-  SPI.write(TFT_OFFSET_Y >> 8);
-  SPI.write(TFT_OFFSET_Y & 0xFF);
-  SPI.write((319 + TFT_OFFSET_Y) >> 8);
-  SPI.write((319 + TFT_OFFSET_Y) & 0xFF);
-  
-  // Fill with black
-  digitalWrite(TFT_DC, LOW);
-  SPI.write(0x2C);
-  digitalWrite(TFT_DC, HIGH);
-  
-  for(uint32_t i = 0; i < (172 * 320); i++) {
-    SPI.write16(0x0000);
-  }
-  
-  digitalWrite(TFT_CS, HIGH);
-  SPI.endTransaction();
+  uint32_t clearStart = millis();
+  LCD_Clear(0x0000);
+  Serial.printf("Display cleared in %lu ms\n", millis() - clearStart);
   
   delay(10);
 }
 
+// The fade in 8.8 fixed point, so the strip's dither smooths the steps between whole levels too
 void setLEDColor() {
-  uint8_t r = (uint8_t)currentRed;
-  uint8_t g = (uint8_t)currentGreen;
-  uint8_t b = (uint8_t)currentBlue;
-  rgbLED.setPixelColor(0, rgbLED.Color(r, g, b));
-  rgbLED.show();
+  uint16_t r = (uint16_t)(currentRed * 256.0f + 0.5f);
+  uint16_t g = (uint16_t)(currentGreen * 256.0f + 0.5f);
+  uint16_t b = (uint16_t)(currentBlue * 256.0f + 0.5f);
+  LED_Render(ledEffect, r, g, b, millis());
+  LED_Show();
 }
 
 void updateDisplay() {
@@ -257,6 +314,25 @@ void updateDisplay() {
   uint8_t g = (uint8_t)currentGreen;
   uint8_t b = (uint8_t)currentBlue;
   
+  if (Dash_Active()) {
+    char text[DASH_TEXT_CHARS];
+    uint16_t white = Dash_Color(255, 255, 255);
+    Dash_Rect_Fill(dashBox, Dash_Color(r, g, b));
+    snprintf(text, sizeof(text), "R: %3d", r);
+    Dash_Text_Set(dashR, text, white);
+    snprintf(text, sizeof(text), "G: %3d", g);
+    Dash_Text_Set(dashG, text, white);
+    snprintf(text, sizeof(text), "B: %3d", b);
+    Dash_Text_Set(dashB, text, white);
+    Dash_Text_Set(dashStatus, bleConnected ? "BLE: Connected" : "BLE: Waiting...",
+                  bleConnected ? Dash_Color(0, 255, 0) : Dash_Color(255, 255, 0));
+    Dash_Text_Set(dashMode, bleColorReceived && bleConnected ? "Mode: Controlled" : "Mode: Random",
+                  Dash_Color(0, 255, 255));
+    Dash_Flush();
+    Latency_Mark(LATENCY_SCREEN, micros());
+    return;
+  }
+  
   // Update color box
   if (colorBox) {
     lv_obj_set_style_bg_color(colorBox, lv_color_make(r, g, b), 0);
@@ -294,10 +370,49 @@ void updateDisplay() {
   }
 }
 
+// HUD values are only set when they change, so an idle HUD costs no panel traffic
+void updateHUD() {
+  if (!hudStrip || lv_obj_has_flag(hudStrip, LV_OBJ_FLAG_HIDDEN)) {
+    return;
+  }
+  
+  lv_color_t color = lv_color_make((uint8_t)currentRed, (uint8_t)currentGreen, (uint8_t)currentBlue);
+  if (lv_obj_get_style_bg_color(hudSwatch, 0).full != color.full) {
+    lv_obj_set_style_bg_color(hudSwatch, color, 0);
+  }
+  
+  char text[32];
+  snprintf(text, sizeof(text), "BLE %s  %d/%d", bleConnected ? "on" : "off",
+           PhotoViewer::currentImageIndex + 1, Image_CNT);
+  if (strcmp(text, lv_label_get_text(hudLabel)) != 0) {
+    lv_label_set_text(hudLabel, text);
+  }
+}
+
+// Show the HUD over photos LVGL holds. Tiled and animated slides are drawn
+// straight to the panel, where redrawing the strip would paint over them,
+// so for those it is hidden without a repaint.
+void placeHUD() {
+  if (!hudStrip) {
+    return;
+  }
+  
+  if (PhotoViewer::layered) {
+    lv_obj_clear_flag(hudStrip, LV_OBJ_FLAG_HIDDEN);
+    updateHUD();
+    lv_obj_invalidate(hudStrip); // The slide was drawn over it
+  } else {
+    lv_disp_enable_invalidation(lv_disp_get_default(), false);
+    lv_obj_add_flag(hudStrip, LV_OBJ_FLAG_HIDDEN);
+    lv_disp_enable_invalidation(lv_disp_get_default(), true);
+  }
+}
+
 // Animation callback for photo fade-in after fade-out completes
 void fadeInNewPhoto(lv_anim_t* a) {
-  // Load next photo (direct to display, no LVGL container)
   PhotoViewer::showNextImage();
+  placeHUD();
+  applyAmbient();
   photoFading = false;
 }
 
@@ -306,13 +421,36 @@ void fadePhotoTransition() {
   
   photoFading = true;
   
-  // Direct rendering - just show next image
+  // Next image slides in over the current one, then the HUD is redrawn over it
+  Set_Image_Transition(IMAGE_TRANSITION_SLIDE);
   PhotoViewer::showNextImage();
+  Set_Image_Transition(IMAGE_TRANSITION_NONE);
+  placeHUD();
+  applyAmbient();
   
   photoFading = false;
 }
 
+// LED control screen as a compositor scene, laid out like the LVGL one
+void createDashboard() {
+  const lv_font_t* font = &lv_font_montserrat_14;
+  lv_refr_now(NULL);                     // LVGL paints the cleared screen first, not over the scene
+  colorBox = labelR = labelG = labelB = labelStatus = labelMode = nullptr;
+  Dash_Begin(Dash_Color(0, 0, 0));
+  dashBox = Dash_Rect((SCREEN_WIDTH - 100) / 2, 50, 100, 100, Dash_Color(0, 0, 0), Dash_Color(255, 255, 255), 2);
+  dashR = Dash_Text(20, 170, font);
+  dashG = Dash_Text(20, 195, font);
+  dashB = Dash_Text(20, 220, font);
+  dashStatus = Dash_Text(10, SCREEN_HEIGHT - 30 - font->line_height, font);
+  dashMode = Dash_Text(10, SCREEN_HEIGHT - 10 - font->line_height, font);
+}
+
 void createUI() {
+  if (scanlineUI) {
+    createDashboard();
+    return;
+  }
+  
   // Create color preview box
   colorBox = lv_obj_create(lv_scr_act());
   lv_obj_set_size(colorBox, 100, 100);
@@ -348,12 +486,78 @@ void createUI() {
   lv_obj_set_style_text_color(labelMode, lv_color_make(0, 255, 255), 0);
 }
 
+void createPhotoUI() {
+  lv_obj_set_style_bg_color(lv_scr_act(), lv_color_black(), 0);
+  
+  photoImage = lv_img_create(lv_scr_act());
+  lv_obj_center(photoImage);
+  lv_obj_add_flag(photoImage, LV_OBJ_FLAG_HIDDEN);
+  
+  // Translucent strip: when it changes LVGL redraws only this area, reading
+  // the photo under it from the image cache
+  hudStrip = lv_obj_create(lv_scr_act());
+  lv_obj_remove_style_all(hudStrip);
+  lv_obj_set_size(hudStrip, SCREEN_WIDTH, HUD_HEIGHT);
+  lv_obj_align(hudStrip, LV_ALIGN_BOTTOM_MID, 0, 0);
+  lv_obj_set_style_bg_color(hudStrip, lv_color_black(), 0);
+  lv_obj_set_style_bg_opa(hudStrip, LV_OPA_50, 0);
+  lv_obj_clear_flag(hudStrip, LV_OBJ_FLAG_SCROLLABLE);
+  
+  // LED color swatch and status text
+  hudSwatch = lv_obj_create(hudStrip);
+  lv_obj_remove_style_all(hudSwatch);
+  lv_obj_set_size(hudSwatch, 12, 12);
+  lv_obj_align(hudSwatch, LV_ALIGN_LEFT_MID, 4, 0);
+  lv_obj_set_style_bg_opa(hudSwatch, LV_OPA_COVER, 0);
+  
+  hudLabel = lv_label_create(hudStrip);
+  lv_label_set_text(hudLabel, "");
+  lv_obj_align(hudLabel, LV_ALIGN_LEFT_MID, 22, 0);
+  lv_obj_set_style_text_color(hudLabel, lv_color_white(), 0);
+  lv_obj_add_flag(hudStrip, LV_OBJ_FLAG_HIDDEN);
+  
+  PhotoViewer::attach(photoImage);
+  
+  // Paint the cleared screen now, the first slide goes to the panel before LVGL's next refresh
+  lv_refr_now(NULL);
+}
+
+// After lv_obj_clean: forget the photo objects and give the decoded photos' memory back
+void deletePhotoUI() {
+  photoImage = nullptr;
+  hudStrip = nullptr;
+  hudSwatch = nullptr;
+  hudLabel = nullptr;
+  PhotoViewer::attach(nullptr);
+  Image_Cache_Clear();
+}
+
 void generateRandomColor() {
   targetRed = random(0, 256);
   targetGreen = random(0, 256);
   targetBlue = random(0, 256);
 }
 
+// A central's color (live or restored) wins, then the slide's ambient color, then random cycling
+bool randomColors() {
+  if (colorHeld || (bleColorReceived && bleConnected)) {
+    return false;
+  }
+  return !(photoMode && ambilight && Ambient_Last.Valid);
+}
+
+// Fade the LED toward the color sampled while the slide was decoded
+void applyAmbient() {
+  if (!ambilight || colorHeld || (bleColorReceived && bleConnected) || !Ambient_Last.Valid) {
+    return;
+  }
+  targetRed = Ambient_Last.Red;
+  targetGreen = Ambient_Last.Green;
+  targetBlue = Ambient_Last.Blue;
+  printf("ambient %02x%02x%02x (%s)\r\n", Ambient_Last.Red, Ambient_Last.Green, Ambient_Last.Blue,
+         Ambient_Last.Share ? "dominant" : "average");
+}
+
 void togglePhotoMode() {
   photoMode = !photoMode;
   
@@ -362,20 +566,28 @@ void togglePhotoMode() {
   
   if (photoMode) {
     // Switching to photo mode - clear screen and show first photo
+    Dash_End();
     lv_obj_clean(lv_scr_act());
+    createPhotoUI();
     
     if (PhotoViewer::hasImages() && PhotoViewer::showFirstImage()) {
+      placeHUD();
+      applyAmbient();
       Serial.println("Photo slideshow activated!");
       lastPhotoChange = millis();
     } else {
       Serial.println("No photos available, reverting to LED mode");
       photoMode = false;
+      lv_obj_clean(lv_scr_act());
+      deletePhotoUI();
       createUI();
       updateDisplay();
     }
   } else {
     // Switching to LED control mode - clear screen and rebuild UI
+    LCD_SetRotation(LCD_ROTATE_0);
     lv_obj_clean(lv_scr_act());
+    deletePhotoUI();
     lv_obj_set_style_bg_color(lv_scr_act(), lv_color_black(), 0);
     
     createUI();
@@ -384,6 +596,52 @@ void togglePhotoMode() {
   }
 }
 
+// Grid of thumbnails over the slideshow, drawn straight to the panel; the
+// photo and HUD are hidden without a repaint so LVGL leaves the grid alone
+void openGallery() {
+  galleryMode = true;
+  lv_disp_enable_invalidation(lv_disp_get_default(), false);
+  if (photoImage) {
+    lv_obj_add_flag(photoImage, LV_OBJ_FLAG_HIDDEN);
+  }
+  if (hudStrip) {
+    lv_obj_add_flag(hudStrip, LV_OBJ_FLAG_HIDDEN);
+  }
+  lv_disp_enable_invalidation(lv_disp_get_default(), true);
+  Gallery_Show(PhotoViewer::currentImageIndex);
+  Serial.println("Gallery opened");
+}
+
+// Back to the slideshow, from the selected photo
+void closeGallery() {
+  galleryMode = false;
+  PhotoViewer::showImageAt(Gallery_Selected());
+  placeHUD();
+  applyAmbient();
+  lastPhotoChange = millis();
+  Serial.println("Gallery closed");
+}
+
+// Short press: next thumbnail in the gallery, otherwise switch modes
+void shortPress() {
+  if (galleryMode) {
+    Gallery_Select((Gallery_Selected() + 1) % Image_CNT);
+  } else {
+    togglePhotoMode();
+  }
+}
+
+// Long press: open the gallery from the slideshow, or the selected photo from it
+void longPress() {
+  if (galleryMode) {
+    closeGallery();
+  } else if (photoMode) {
+    openGallery();
+  } else {
+    togglePhotoMode();
+  }
+}
+
 void checkButton() {
   int reading = digitalRead(BUTTON_PIN);
   
@@ -398,13 +656,22 @@ void checkButton() {
     if (reading != buttonState) {
       buttonState = reading;
       
-      // Button was pressed (LOW on ESP32-C6 boot button)
+      // Button was pressed (LOW on ESP32-C6 boot button); a short press acts on release
       if (buttonState == LOW) {
-        togglePhotoMode();
+        lastInputTime = millis();
+        buttonPressTime = millis();
+        longPressHandled = false;
+      } else if (!longPressHandled) {
+        shortPress();
       }
     }
   }
   
+  if (buttonState == LOW && !longPressHandled && millis() - buttonPressTime >= LONG_PRESS_TIME) {
+    longPressHandled = true;
+    longPress();
+  }
+  
   lastButtonState = reading;
 }
 
@@ -429,6 +696,194 @@ void fadeToTarget() {
   }
 }
 
+// Time until a periodic task is next due, for the power governor
+uint32_t timeUntilDue(unsigned long last, unsigned long interval, unsigned long now) {
+  unsigned long elapsed = now - last;
+  return elapsed >= interval ? 0 : interval - elapsed;
+}
+
+void runPowerGovernor() {
+  Power_Input power = {};
+  power.Now_Ms = millis();
+  power.Last_Input_Ms = lastInputTime;
+  power.Ble_Pending = bleCommandPending;
+  
+  bool ledMoving = currentRed != targetRed || currentGreen != targetGreen || currentBlue != targetBlue;
+  if (ledMoving || ledEffect != LED_EFFECT_SOLID || LED_Busy()) {
+    power.Work |= POWER_WORK_LED;
+  }
+  // LED control screen and the photo HUD swatch follow the fade; a pressed button is about to redraw
+  if ((ledMoving && (!photoMode || (PhotoViewer::layered && !galleryMode))) || digitalRead(BUTTON_PIN) == LOW || buttonState == LOW) {
+    power.Work |= POWER_WORK_UI;
+  }
+  
+  // Thumbnails still to build
+  if (Thumb_Pending()) {
+    power.Work |= POWER_WORK_DECODE;
+  }
+  
+  // Scheduled work: the next slide (a decode) and the next random color
+  power.Next_Work_Ms = POWER_NO_WORK;
+  if (photoMode && !galleryMode) {
+    power.Next_Work_Ms = timeUntilDue(lastPhotoChange, PHOTO_CHANGE_INTERVAL, power.Now_Ms);
+  }
+  if (randomColors()) {
+    uint32_t colorDue = timeUntilDue(lastColorChange, COLOR_CHANGE_INTERVAL, power.Now_Ms);
+    if (colorDue < power.Next_Work_Ms) {
+      power.Next_Work_Ms = colorDue;
+    }
+  }
+  
+  Power_Run(power);
+}
+
+// What a power cycle should come back to
+State_Snapshot currentState() {
+  State_Snapshot state = {};
+  state.Flags = (photoMode ? STATE_PHOTO_MODE : 0) | (bleColorReceived || colorHeld ? STATE_BLE_COLOR : 0);
+  state.Led_Effect = ledEffect;
+  state.Red = bleRed;
+  state.Green = bleGreen;
+  state.Blue = bleBlue;
+  if (PhotoViewer::hasImages()) {
+    state.Image_Index = PhotoViewer::currentImageIndex;
+    state.Image_Hash = State_Hash(SD_Image_Name[PhotoViewer::currentImageIndex]);
+  }
+  return state;
+}
+
+// Boot profile, time since reset at each step
+void bootMark(const char* step) {
+  printf("boot %lu ms: %s\r\n", millis(), step);
+}
+
+// Print heap, stack and pool use; the LVGL heap is copied in from LVGL's own monitor
+void reportMemory() {
+  lv_mem_monitor_t lvgl;
+  lv_mem_monitor(&lvgl);
+  Mem_Pool_Set("lvgl_heap", lvgl.total_size - lvgl.free_size, lvgl.max_used);
+  Mem_Report();
+}
+
+// Bench: full-screen LVGL redraws, of the LED screen or of the photo from its cached frame
+void benchLvgl(uint16_t runs) {
+  Bench_Stats stats;
+  Bench_Reset(stats);
+  for (uint16_t i = 0; i < runs; i++) {
+    uint32_t start = micros();
+    lv_obj_invalidate(lv_scr_act());
+    lv_refr_now(NULL);
+    Bench_Add(stats, micros() - start);
+  }
+  Bench_Report(photoMode ? "lvgl_photo" : "lvgl_led", stats);
+}
+
+// Bench: color commands through the same path as a BLE write, then one loop
+// pass of the LED and screen stages; the color in use is put back afterwards
+void benchBle(uint16_t runs) {
+  float red = targetRed, green = targetGreen, blue = targetBlue;
+  uint8_t savedRed = bleRed, savedGreen = bleGreen, savedBlue = bleBlue;
+  bool received = bleColorReceived, held = colorHeld;
+  Bench_Stats led, screen;
+  Bench_Reset(led);
+  Bench_Reset(screen);
+  for (uint16_t i = 0; i < runs; i++) {
+    uint8_t command[3] = { (uint8_t)(i * 37), (uint8_t)(255 - i * 37), (uint8_t)(i * 91) };
+    uint32_t start = micros();
+    applyColorCommand(command, sizeof(command));
+    fadeToTarget();
+    setLEDColor();
+    bleCommandPending = false;
+    Bench_Add(led, micros() - start);
+    if (!photoMode) {
+      updateDisplay();
+    } else if (!galleryMode) {
+      updateHUD();
+    }
+    lv_refr_now(NULL);
+    Bench_Add(screen, micros() - start);
+  }
+  Bench_Report("ble_led", led);
+  Bench_Report("ble_screen", screen);
+  targetRed = red;
+  targetGreen = green;
+  targetBlue = blue;
+  bleRed = savedRed;
+  bleGreen = savedGreen;
+  bleBlue = savedBlue;
+  bleColorReceived = received;
+  colorHeld = held;
+}
+
+// Bench: the command-to-photon histograms gathered since the last report, then started over
+void benchLatency(uint16_t runs) {
+  char text[LATENCY_TEXT_MAX];
+  Latency_Format(text, sizeof(text), "BENCH ", "\r\n");
+  printf("%s", text);
+  Latency_Reset();
+}
+
+// Bench: LED screen color changes, through the scanline compositor and then
+// through LVGL, each timed from the new color to the panel showing it
+void benchDashboard(uint16_t runs) {
+  if (photoMode) {
+    printf("bench: dashboard needs LED mode\r\n");
+    return;
+  }
+  float red = currentRed, green = currentGreen, blue = currentBlue;
+  bool scanline = scanlineUI;
+  for (uint8_t pass = 0; pass < 2; pass++) {
+    scanlineUI = pass == 0;
+    Dash_End();
+    lv_obj_clean(lv_scr_act());
+    createUI();
+    updateDisplay();
+    lv_refr_now(NULL);
+    Dash_Flush();
+    
+    Dash_Stats before = Dash_Totals;
+    Bench_Stats stats;
+    Bench_Reset(stats);
+    for (uint16_t i = 0; i < runs; i++) {
+      currentRed = (uint8_t)(i * 37);
+      currentGreen = (uint8_t)(255 - i * 37);
+      currentBlue = (uint8_t)(i * 91);
+      uint32_t start = micros();
+      updateDisplay();
+      lv_refr_now(NULL);
+      Bench_Add(stats, micros() - start);
+    }
+    Bench_Report(scanlineUI ? "dash_scanline" : "dash_lvgl", stats);
+    if (scanlineUI) {
+      printf("BENCH dash_scanline_px n=%u mean_px=%lu strips=%lu\r\n", runs,
+             (unsigned long)((Dash_Totals.Pixels - before.Pixels) / (runs ? runs : 1)),
+             (unsigned long)(Dash_Totals.Strips - before.Strips));
+    }
+  }
+  currentRed = red;
+  currentGreen = green;
+  currentBlue = blue;
+  scanlineUI = scanline;
+  Dash_End();
+  lv_obj_clean(lv_scr_act());
+  createUI();
+  updateDisplay();
+}
+
+// After a bench command: redraw what the workloads painted over
+void benchRestore() {
+  if (galleryMode) {
+    Gallery_Show(Gallery_Selected());
+  } else if (photoMode) {
+    PhotoViewer::showImageAt(PhotoViewer::currentImageIndex);
+    placeHUD();
+    lastPhotoChange = millis();
+  } else {
+    LCD_SetRotation(LCD_ROTATE_0);
+    lv_obj_invalidate(lv_scr_act());
+  }
+}
+
 void setup() {
   Serial.begin(115200);
   Serial.println("Waveshare ESP32-C6-LCD-1.47 BLE LED Controller");
@@ -436,19 +891,50 @@ void setup() {
   // Initialize button with internal pull-up
   pinMode(BUTTON_PIN, INPUT_PULLUP);
   
-  // Initialize RGB LED
-  rgbLED.begin();
-  rgbLED.setBrightness(50); // Set brightness to 50/255
-  rgbLED.show();
+  Power_Begin();
+  
+  // Initialize RGB LED strip
+  LED_Begin(RGB_LED_PIN, RGB_LED_COUNT);
+  LED_SetBrightness(50); // Set brightness to 50/255
+  LED_Show();
+  
+  // Restore the last state before anything slow, so the color is back at once
+  State_Snapshot restored;
+  bool warm = State_Begin(stateStore, &State_Nvs, millis(), restored);
+  if (warm) {
+    ledEffect = restored.Led_Effect <= LED_EFFECT_RAINBOW ? restored.Led_Effect : LED_EFFECT_SOLID;
+    if (restored.Flags & STATE_BLE_COLOR) {
+      bleRed = restored.Red;
+      bleGreen = restored.Green;
+      bleBlue = restored.Blue;
+      currentRed = targetRed = bleRed;
+      currentGreen = targetGreen = bleGreen;
+      currentBlue = targetBlue = bleBlue;
+      colorHeld = true;
+      setLEDColor();
+    }
+    Serial.printf("Restored %s mode, image %u\n", (restored.Flags & STATE_PHOTO_MODE) ? "photo" : "LED",
+                  restored.Image_Index + 1);
+  }
+  bootMark(warm ? "state restored" : "no saved state");
   
   // Initialize display hardware
   initDisplay();
   
+  // Panel write clock, checked by reading a pattern back; the card stays off MISO meanwhile
+  pinMode(SD_CS, OUTPUT);
+  digitalWrite(SD_CS, HIGH);
+  SPI_Clock_Calibrate(SPI_CLOCK_LCD, "lcd", LCD_Probe, LCD_SetClock, SPIFreq);
+  bootMark("panel clock");
+  
   // Initialize LVGL
   lv_init();
   
   // Initialize display buffer
   lv_disp_draw_buf_init(&draw_buf, buf1, NULL, LVGL_BUFFER_SIZE);
+  Mem_Pool_Define("lvgl_draw", sizeof(buf1), sizeof(buf1));
+  Mem_Pool_Define("lvgl_heap", LV_MEM_SIZE);
+  Mem_Watch_Task(nullptr, "loop");
   
   // Initialize display driver
   lv_disp_drv_init(&disp_drv);
@@ -458,6 +944,9 @@ void setup() {
   disp_drv.draw_buf = &draw_buf;
   lv_disp_drv_register(&disp_drv);
   
+  // Photos reach LVGL through the cached image decoder
+  Image_Decoder_Init();
+  
   // Clear screen with black background
   lv_obj_set_style_bg_color(lv_scr_act(), lv_color_black(), 0);
   
@@ -468,25 +957,38 @@ void setup() {
   lv_obj_set_style_text_color(loadingLabel, lv_color_white(), 0);
   lv_obj_set_style_text_align(loadingLabel, LV_TEXT_ALIGN_CENTER, 0);
   lv_timer_handler();
-  delay(2000);
+  if (!warm) delay(2000);
   
   lv_label_set_text(loadingLabel, "Checking SD Card...");
   lv_timer_handler();
-  delay(500);
+  if (!warm) delay(500);
   
-  if (PhotoViewer::initSD()) {
-    if (PhotoViewer::loadImageList()) {
+  bool sdReady = PhotoViewer::initSD();        // Calibrates the card clock
+  bootMark("SD clock");
+  if (sdReady) {
+    if (PhotoViewer::loadImageList() && warm && !(restored.Flags & STATE_PHOTO_MODE)) {
+      // Resuming in LED mode; the button still starts the slideshow
+      lv_obj_del(loadingLabel);
+    } else if (PhotoViewer::hasImages()) {
       lv_label_set_text(loadingLabel, "Photos found!\nStarting slideshow...");
       lv_timer_handler();
-      delay(1000);
+      if (!warm) delay(1000);
       
-      // Clear screen and display first photo
+      // Clear screen and display the first photo, or the one shown before power off
       lv_obj_del(loadingLabel);
+      createPhotoUI();
       
-      if (PhotoViewer::showFirstImage()) {
+      bool shown = warm ? PhotoViewer::showImageAt(PhotoViewer::findImage(restored.Image_Hash, restored.Image_Index))
+                        : PhotoViewer::showFirstImage();
+      if (shown) {
+        placeHUD();
+        bootMark("first photo");
         Serial.println("Photo slideshow mode activated!");
         photoMode = true;
         lastPhotoChange = millis();
+      } else {
+        lv_obj_clean(lv_scr_act());
+        deletePhotoUI();
       }
     } else {
       lv_label_set_text(loadingLabel, "No photos found\nSwitching to\nLED Control Mode");
@@ -513,7 +1015,8 @@ void setup() {
     lv_obj_set_style_text_color(startupLabel, lv_color_white(), 0);
     
     lv_timer_handler();
-    delay(1000);
+    bootMark("LED control screen");
+    if (!warm) delay(1000);
     
     lv_obj_del(startupLabel);
   }
@@ -535,6 +1038,13 @@ void setup() {
   );
   pCharacteristic->setCallbacks(new CharacteristicCallbacks());
   
+  pTelemetry = pService->createCharacteristic(TELEMETRY_UUID, BLECharacteristic::PROPERTY_READ);
+  BLE_Link_Begin(pServer, pTelemetry);
+  
+  pLatency = pService->createCharacteristic(LATENCY_UUID,
+    BLECharacteristic::PROPERTY_READ | BLECharacteristic::PROPERTY_WRITE);
+  pLatency->setCallbacks(new LatencyCallbacks());
+  
   // Start the service
   pService->start();
   
@@ -549,14 +1059,23 @@ void setup() {
   Serial.println("BLE Server started!");
   Serial.println("Service UUID: " + String(SERVICE_UUID));
   Serial.println("Characteristic UUID: " + String(CHARACTERISTIC_UUID));
+  Serial.println("Telemetry UUID: " + String(TELEMETRY_UUID));
+  Serial.println("Latency UUID: " + String(LATENCY_UUID));
   Serial.println("Send 3 bytes (R, G, B) to control LED color");
   
-  // Generate initial random color and set as both current and target
-  generateRandomColor();
-  currentRed = targetRed;
-  currentGreen = targetGreen;
-  currentBlue = targetBlue;
-  setLEDColor();
+  // Start at the first photo's color or a random one, as both current and
+  // target, unless the restored BLE color is already showing
+  if (!colorHeld) {
+    if (randomColors()) {
+      generateRandomColor();
+    } else {
+      applyAmbient();
+    }
+    currentRed = targetRed;
+    currentGreen = targetGreen;
+    currentBlue = targetBlue;
+    setLEDColor();
+  }
   
   // Only update display if not in photo mode
   if (!photoMode) {
@@ -564,6 +1083,17 @@ void setup() {
   }
   
   lastColorChange = millis();
+  
+  // Serial bench console: "bench list", "bench <workload> [runs]", "bench all"
+  Bench_Begin(PhotoViewer::imageDirectory, PhotoViewer::imageExtension, benchRestore);
+  Bench_Register("lvgl", benchLvgl, 20);
+  Bench_Register("ble", benchBle, 50);
+  Bench_Register("dashboard", benchDashboard, 50);
+  Bench_Register("latency", benchLatency, 1, false);
+  
+  reportMemory();
+  lastMemoryReport = millis();
+  bootMark("ready");
 }
 
 void loop() {
@@ -572,10 +1102,16 @@ void loop() {
   // Check button state for photo mode toggle
   checkButton();
   
+  // Bench commands typed on the serial console
+  Bench_Poll();
+  
+  // A device that kept failing transfers drops to a slower clock here, between decodes
+  SPI_Clock_Poll();
+  
   unsigned long currentTime = millis();
   
   // Photo slideshow mode - cycle through photos with fade effect
-  if (photoMode) {
+  if (photoMode && !galleryMode) {
     if (currentTime - lastPhotoChange >= PHOTO_CHANGE_INTERVAL && !photoFading) {
       fadePhotoTransition();
       lastPhotoChange = currentTime;
@@ -583,22 +1119,55 @@ void loop() {
   }
   
   // LED control - works in both photo mode and LED control mode
-  // If not connected or no BLE color, generate new target colors periodically
-  if (!bleColorReceived || !bleConnected) {
+  // Without a BLE color or a slide color, generate new target colors periodically
+  if (randomColors()) {
     if (currentTime - lastColorChange >= COLOR_CHANGE_INTERVAL) {
       generateRandomColor();
       lastColorChange = currentTime;
     }
   }
   
+  // Fast connection interval while a central sends, relaxed when it goes quiet
+  BLE_Link_Run(currentTime);
+  
+  // Missing thumbnails are built one at a time in the background, back to
+  // back while the gallery is waiting for them
+  if (!bleCommandPending && Thumb_Pending() &&
+      (galleryMode || currentTime - lastThumbBuild >= THUMB_BUILD_INTERVAL)) {
+    int16_t built = Thumb_Run(galleryMode ? Gallery_First() : PhotoViewer::currentImageIndex);
+    if (galleryMode && built >= 0) {
+      Gallery_Refresh(built);
+    }
+    lastThumbBuild = millis();
+  }
+  
   // Smoothly fade toward target color and update LED
+  Latency_Mark(LATENCY_PICKUP, micros());
   fadeToTarget();
   setLEDColor();
+  Latency_Mark(LATENCY_LED, micros());
+  if (currentRed == targetRed && currentGreen == targetGreen && currentBlue == targetBlue) {
+    Latency_Mark(LATENCY_SETTLED, micros());
+  }
+  bleCommandPending = false;
+  
+  // Snapshot for the next boot; flash is written only when it changed, once a minute at most
+  State_Update(stateStore, currentState());
+  State_Run(stateStore, currentTime);
   
-  // Only update display UI if not in photo mode
+  // LED control screen, or the HUD over the current photo
   if (!photoMode) {
     updateDisplay();
+  } else if (!galleryMode) {
+    updateHUD();
+  }
+  
+  if (currentTime - lastMemoryReport >= MEM_REPORT_MS) {
+    reportMemory();
+    lastMemoryReport = currentTime;
   }
   
-  delay(20); // ~50 FPS for smooth fading
+  // Clock, backlight and the wait until the next loop: 20 ms (~50 FPS)
+  // while fading, up to 50 ms when idle
+  runPowerGovernor();
 }
\ No newline at end of file
@@ -0,0 +1,147 @@
+#include <unity.h>
+#include <string.h>
+
+#include "Blit_Queue.h"
+
+// Fake panel: transfers land in a square frame memory big enough for either
+// rotation and counts the transfers
+#define PANEL_SIZE LCD_HEIGHT
+
+static uint16_t Panel[PANEL_SIZE * PANEL_SIZE];
+static uint32_t Panel_Blits;
+
+static void Test_Panel(int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t* pixels)
+{
+  Panel_Blits++;
+  for (int16_t r = 0; r < h; r++)
+    for (int16_t c = 0; c < w; c++)
+      if (x + c >= 0 && x + c < PANEL_SIZE && y + r >= 0 && y + r < PANEL_SIZE)
+        Panel[(y + r) * PANEL_SIZE + x + c] = pixels[r * w + c];
+}
+
+void setUp(void)
+{
+  memset(Panel, 0, sizeof(Panel));
+  Panel_Blits = 0;
+  Blit_Queue_Panel(Test_Panel);
+  Blit_Queue_Enable(true);
+  Blit_Queue_ResetStats();
+}
+
+void tearDown(void)
+{
+}
+
+static uint16_t Test_Pixel(uint16_t frame, int16_t x, int16_t y)
+{
+  return (uint16_t)(frame * 1000 + x * 7 + y * 131 + 1);
+}
+
+// One frame as Image_Rows hands it over, a row at a time
+static void Test_Frame(uint16_t frame, int16_t width, int16_t height)
+{
+  uint16_t line[BLIT_QUEUE_WIDTH];
+  for (int16_t y = 0; y < height; y++) {
+    for (int16_t x = 0; x < width; x++)
+      line[x] = Test_Pixel(frame, x, y);
+    Blit_Queue_Put(0, y, width, 1, line);
+  }
+  Blit_Queue_Flush();
+}
+
+static bool Test_Shown(uint16_t frame, int16_t x0, int16_t y0, int16_t width, int16_t height)
+{
+  for (int16_t y = 0; y < height; y++)
+    for (int16_t x = 0; x < width; x++)
+      if (Panel[(y0 + y) * PANEL_SIZE + x0 + x] != Test_Pixel(frame, x, y))
+        return false;
+  return true;
+}
+
+// Image_Begin places the queue once per image and an animation only calls it
+// for its first frame: the later frames must land where the first did, with
+// its stride, not where the narrower image before it was
+static void test_animation_after_narrower_image(void)
+{
+  Blit_Queue_Begin((LCD_WIDTH - 60) / 2, (LCD_HEIGHT - 40) / 2, 60);
+  Test_Frame(9, 60, 40);
+
+  const int16_t x0 = (LCD_WIDTH - 150) / 2, y0 = (LCD_HEIGHT - 100) / 2;
+  Blit_Queue_Begin(x0, y0, 150);
+  for (uint16_t frame = 0; frame < 3; frame++) {
+    Test_Frame(frame, 150, 100);
+    TEST_ASSERT_TRUE(Test_Shown(frame, x0, y0, 150, 100));
+  }
+}
+
+// A JPEG's MCUs, left to right and top to bottom, as jpegDraw hands them over
+static void Test_Blocks(int16_t width, int16_t height, int16_t mcu)
+{
+  uint16_t block[BLIT_QUEUE_ROWS * BLIT_QUEUE_ROWS];
+  for (int16_t y = 0; y < height; y += mcu) {
+    for (int16_t x = 0; x < width; x += mcu) {
+      int16_t w = width - x < mcu ? width - x : mcu;
+      int16_t h = height - y < mcu ? height - y : mcu;
+      for (int16_t r = 0; r < h; r++)
+        for (int16_t c = 0; c < w; c++)
+          block[r * w + c] = Test_Pixel(0, x + c, y + r);
+      Blit_Queue_Put(x, y, w, h, block);
+    }
+  }
+  Blit_Queue_Flush();
+}
+
+// The landscape frame row by row, as PNGdec delivers it: one transfer per
+// 16 rows, and the same pixels as a transfer per row
+static void test_rows_batched_into_strips(void)
+{
+  Blit_Queue_Begin(0, 0, LCD_HEIGHT);
+  Test_Frame(0, LCD_HEIGHT, LCD_WIDTH);
+  TEST_ASSERT_TRUE(Test_Shown(0, 0, 0, LCD_HEIGHT, LCD_WIDTH));
+  TEST_ASSERT_EQUAL_UINT32((LCD_WIDTH + BLIT_QUEUE_ROWS - 1) / BLIT_QUEUE_ROWS, Panel_Blits);
+  TEST_ASSERT_EQUAL_UINT32(Panel_Blits, Blit_Queue_Totals.Strips);
+
+  memset(Panel, 0, sizeof(Panel));
+  Panel_Blits = 0;
+  Blit_Queue_Enable(false);
+  Blit_Queue_Begin(0, 0, LCD_HEIGHT);
+  Test_Frame(0, LCD_HEIGHT, LCD_WIDTH);
+  TEST_ASSERT_TRUE(Test_Shown(0, 0, 0, LCD_HEIGHT, LCD_WIDTH));
+  TEST_ASSERT_EQUAL_UINT32(LCD_WIDTH, Panel_Blits);
+}
+
+// 16x16 and 8x8 MCUs with ragged right and bottom edges: one transfer per
+// 16 rows, and the same pixels as a transfer per block
+static void test_blocks_batched_into_strips(void)
+{
+  static const int16_t mcus[] = { 16, 8 };
+  for (int16_t mcu : mcus) {
+    const int16_t width = 125, height = 110;
+    const uint32_t blocks = ((height + mcu - 1) / mcu) * ((width + mcu - 1) / mcu);
+
+    memset(Panel, 0, sizeof(Panel));
+    Panel_Blits = 0;
+    Blit_Queue_Enable(true);
+    Blit_Queue_Begin(20, 30, width);
+    Test_Blocks(width, height, mcu);
+    TEST_ASSERT_TRUE(Test_Shown(0, 20, 30, width, height));
+    TEST_ASSERT_EQUAL_UINT32((height + BLIT_QUEUE_ROWS - 1) / BLIT_QUEUE_ROWS, Panel_Blits);
+
+    memset(Panel, 0, sizeof(Panel));
+    Panel_Blits = 0;
+    Blit_Queue_Enable(false);
+    Blit_Queue_Begin(20, 30, width);
+    Test_Blocks(width, height, mcu);
+    TEST_ASSERT_TRUE(Test_Shown(0, 20, 30, width, height));
+    TEST_ASSERT_EQUAL_UINT32(blocks, Panel_Blits);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_animation_after_narrower_image);
+  RUN_TEST(test_rows_batched_into_strips);
+  RUN_TEST(test_blocks_batched_into_strips);
+  return UNITY_END();
+}
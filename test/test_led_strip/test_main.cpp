@@ -0,0 +1,118 @@
+#include <unity.h>
+#include <stdio.h>
+
+#include "LED_Strip.h"
+
+#define TEST_PIXELS 4
+#define TEST_FRAMES 1024
+#define TEST_RECORD "led_strip_test.rec"
+
+void setUp(void)
+{
+  LED_Begin(0, TEST_PIXELS);
+  LED_SetDither(true);
+}
+
+void tearDown(void)
+{
+  LED_Record(nullptr);
+  remove(TEST_RECORD);
+}
+
+/******************************************************************************
+function: Show TEST_FRAMES frames of one colour and average the recorded output
+parameter:
+    r, g, b    : 8.8 colour
+    brightness : LED_SetBrightness
+    mean       : Time-averaged R G B over every pixel, in output steps
+******************************************************************************/
+static void LED_Mean(uint16_t r, uint16_t g, uint16_t b, uint8_t brightness, double mean[3])
+{
+  TEST_ASSERT_TRUE(LED_Record(TEST_RECORD));
+  LED_SetBrightness(brightness);
+  for (uint32_t i = 0; i < TEST_FRAMES; i++) {
+    LED_Render(LED_EFFECT_SOLID, r, g, b, i * 20);
+    TEST_ASSERT_TRUE(LED_Show());
+  }
+  LED_Record(nullptr);
+
+  FILE* file = fopen(TEST_RECORD, "rb");
+  TEST_ASSERT_NOT_NULL(file);
+  char magic[4];
+  uint16_t count = 0;
+  TEST_ASSERT_EQUAL_UINT32(4, fread(magic, 1, 4, file));
+  TEST_ASSERT_EQUAL_UINT32(1, fread(&count, sizeof(count), 1, file));
+  TEST_ASSERT_EQUAL_UINT32(TEST_PIXELS, count);
+
+  uint64_t sum[3] = { 0, 0, 0 };
+  uint32_t frames = 0, time;
+  uint8_t grb[TEST_PIXELS * 3];
+  while (fread(&time, sizeof(time), 1, file) == 1 && fread(grb, 1, sizeof(grb), file) == sizeof(grb)) {
+    for (uint16_t i = 0; i < TEST_PIXELS; i++) {
+      sum[0] += grb[i * 3 + 1];
+      sum[1] += grb[i * 3];
+      sum[2] += grb[i * 3 + 2];
+    }
+    frames++;
+  }
+  fclose(file);
+  TEST_ASSERT_EQUAL_UINT32(TEST_FRAMES, frames);
+  for (uint8_t c = 0; c < 3; c++)
+    mean[c] = (double)sum[c] / ((uint64_t)TEST_FRAMES * TEST_PIXELS);
+}
+
+// What the eye should see: the gamma level scaled by brightness, in output steps
+static double LED_Target(uint16_t value, uint8_t brightness)
+{
+  return (double)LED_Light(value) * (brightness + 1) / 65536;
+}
+
+// Whole levels: the average lands within 1/256 step of the gamma table
+static void test_dither_mean_matches_gamma(void)
+{
+  static const uint8_t levels[] = { 0, 1, 7, 30, 64, 128, 200, 255 };
+  static const uint8_t brightness[] = { 255, 50, 10 };
+  for (uint8_t b : brightness) {
+    for (uint8_t v : levels) {
+      uint8_t w = 255 - v, u = v / 2;
+      double mean[3];
+      LED_Mean(v << 8, w << 8, u << 8, b, mean);
+      TEST_ASSERT_DOUBLE_WITHIN(1.0 / 256, LED_Target(v << 8, b), mean[0]);
+      TEST_ASSERT_DOUBLE_WITHIN(1.0 / 256, LED_Target(w << 8, b), mean[1]);
+      TEST_ASSERT_DOUBLE_WITHIN(1.0 / 256, LED_Target(u << 8, b), mean[2]);
+    }
+  }
+}
+
+// A fade between whole levels keeps its fraction through gamma and dither
+static void test_dither_mean_keeps_fraction(void)
+{
+  const uint8_t b = 50;
+  double mean[3];
+  LED_Mean(0x4040, 0x4080, 0x40C0, b, mean);
+  TEST_ASSERT_DOUBLE_WITHIN(1.0 / 256, LED_Target(0x4040, b), mean[0]);
+  TEST_ASSERT_DOUBLE_WITHIN(1.0 / 256, LED_Target(0x4080, b), mean[1]);
+  TEST_ASSERT_DOUBLE_WITHIN(1.0 / 256, LED_Target(0x40C0, b), mean[2]);
+  TEST_ASSERT_TRUE(mean[0] > LED_Target(0x4000, b) && mean[0] < mean[1]);
+  TEST_ASSERT_TRUE(mean[1] < mean[2] && mean[2] < LED_Target(0x4100, b));
+}
+
+// The table is the gamma curve, full scale 255.0 in 8.8
+static void test_light_follows_gamma(void)
+{
+  TEST_ASSERT_EQUAL_UINT32(0, LED_Light(0));
+  TEST_ASSERT_EQUAL_UINT32(14330, LED_Light(128 << 8));
+  TEST_ASSERT_EQUAL_UINT32(0xFF00, LED_Light(255 << 8));
+  TEST_ASSERT_EQUAL_UINT32(0xFF00, LED_Light(0xFFFF));
+  for (uint32_t v = 0; v < 0xFFFF; v++)
+    TEST_ASSERT_TRUE(LED_Light(v) <= LED_Light(v + 1));
+}
+
+int main(int argc, char** argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_dither_mean_matches_gamma);
+  RUN_TEST(test_dither_mean_keeps_fraction);
+  RUN_TEST(test_light_follows_gamma);
+  return UNITY_END();
+}
@@ -0,0 +1,116 @@
+#include <unity.h>
+#include <math.h>
+#include <string.h>
+
+#include "Pixel_Convert.h"
+
+#define TEST_WIDTH 37     // Not a multiple of the unrolled four
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+// PNGdec's getLineAsRGB565 for 8-bit truecolor, then the byte swap pngDraw did
+static uint16_t Test_Truncate(const uint8_t* c)
+{
+  uint16_t p = ((c[0] & 0xF8) << 8) | ((c[1] & 0xFC) << 3) | (c[2] >> 3);
+  return (uint16_t)(p >> 8 | p << 8);
+}
+
+// Without dither the output is bit for bit the old conversion, 3 and 4 byte pixels
+static void test_truncate_matches_old_path(void)
+{
+  uint8_t line[TEST_WIDTH * 4];
+  uint16_t out[TEST_WIDTH];
+  uint32_t seed = 7;
+  for (uint16_t y = 0; y < 64; y++) {
+    for (uint16_t i = 0; i < sizeof(line); i++) {
+      seed = seed * 1103515245 + 12345;
+      line[i] = seed >> 16;
+    }
+    for (uint8_t stride = 3; stride <= 4; stride++) {
+      Pixel_Convert_RGB(line, stride, out, TEST_WIDTH, y, false);
+      for (uint16_t x = 0; x < TEST_WIDTH; x++)
+        TEST_ASSERT_EQUAL_HEX16(Test_Truncate(line + x * stride), out[x]);
+    }
+  }
+}
+
+// Palette lines give what the expanded RGB line gives, with and without dither
+static void test_indexed_matches_rgb(void)
+{
+  uint8_t palette[256 * 3], index[TEST_WIDTH], rgb[TEST_WIDTH * 3];
+  uint16_t a[TEST_WIDTH], b[TEST_WIDTH];
+  for (uint16_t i = 0; i < sizeof(palette); i++)
+    palette[i] = (uint8_t)(i * 97 + 13);
+  for (uint16_t x = 0; x < TEST_WIDTH; x++) {
+    index[x] = (uint8_t)(x * 53);
+    memcpy(rgb + x * 3, palette + index[x] * 3, 3);
+  }
+  for (uint8_t dither = 0; dither < 2; dither++) {
+    for (uint16_t y = 0; y < PIXEL_BAYER_SIZE; y++) {
+      Pixel_Convert_Indexed(index, palette, a, TEST_WIDTH, y, dither);
+      Pixel_Convert_RGB(rgb, 3, b, TEST_WIDTH, y, dither);
+      TEST_ASSERT_EQUAL_UINT16_ARRAY(b, a, TEST_WIDTH);
+    }
+  }
+}
+
+// Mean red of a flat level over one 4x4 tile, as the panel shows it in 8-bit units
+static double Test_Tile_Red(uint8_t v, bool dither)
+{
+  uint8_t line[PIXEL_BAYER_SIZE * 3];
+  uint16_t out[PIXEL_BAYER_SIZE];
+  memset(line, v, sizeof(line));
+  double sum = 0;
+  for (uint16_t y = 0; y < PIXEL_BAYER_SIZE; y++) {
+    Pixel_Convert_RGB(line, 3, out, PIXEL_BAYER_SIZE, y, dither);
+    for (uint16_t x = 0; x < PIXEL_BAYER_SIZE; x++)
+      sum += (out[x] & 0xF8) * 255.0 / 0xF8;
+  }
+  return sum / (PIXEL_BAYER_SIZE * PIXEL_BAYER_SIZE);
+}
+
+// Dither keeps every flat level's tile average close; truncation drifts by up to a step
+static void test_dither_tile_mean(void)
+{
+  double dither = 0, truncate = 0;
+  for (uint16_t v = 0; v < 256; v++) {
+    double error = fabs(Test_Tile_Red(v, true) - v);
+    TEST_ASSERT_DOUBLE_WITHIN(1.0, v, Test_Tile_Red(v, true));
+    dither += error;
+    truncate += fabs(Test_Tile_Red(v, false) - v);
+  }
+  TEST_ASSERT_TRUE(dither / 256 < 0.5);
+  TEST_ASSERT_TRUE(dither * 4 < truncate);
+  // Black and white stay solid
+  TEST_ASSERT_DOUBLE_WITHIN(0.001, 0, Test_Tile_Red(0, true));
+  TEST_ASSERT_DOUBLE_WITHIN(0.001, 255, Test_Tile_Red(255, true));
+}
+
+static void test_dither_rule_from_name(void)
+{
+  TEST_ASSERT_EQUAL_UINT8(PIXEL_DITHER_ON, Pixel_Dither_Rule("/photos/sky.dither.png"));
+  TEST_ASSERT_EQUAL_UINT8(PIXEL_DITHER_ON, Pixel_Dither_Rule("SKY.DITHER.PNG"));
+  TEST_ASSERT_EQUAL_UINT8(PIXEL_DITHER_OFF, Pixel_Dither_Rule("/photos/logo.nodither.png"));
+  TEST_ASSERT_EQUAL_UINT8(PIXEL_DITHER_OFF, Pixel_Dither_Rule("Logo.NoDither.png"));
+  TEST_ASSERT_EQUAL_UINT8(PIXEL_DITHER_DEFAULT, Pixel_Dither_Rule("/photos/sky.png"));
+  TEST_ASSERT_EQUAL_UINT8(PIXEL_DITHER_DEFAULT, Pixel_Dither_Rule("/photos/nodither.png"));
+  TEST_ASSERT_EQUAL_UINT8(PIXEL_DITHER_DEFAULT, Pixel_Dither_Rule("/photos/sky_dither.png"));
+  TEST_ASSERT_EQUAL_UINT8(PIXEL_DITHER_DEFAULT, Pixel_Dither_Rule("/sky.dither/photo.png"));
+  TEST_ASSERT_EQUAL_UINT8(PIXEL_DITHER_DEFAULT, Pixel_Dither_Rule("/photos/dither"));
+}
+
+int main(int argc, char** argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_truncate_matches_old_path);
+  RUN_TEST(test_indexed_matches_rgb);
+  RUN_TEST(test_dither_tile_mean);
+  RUN_TEST(test_dither_rule_from_name);
+  return UNITY_END();
+}
@@ -0,0 +1,197 @@
+#include <unity.h>
+
+#include "Power_Governor.h"
+
+#define SLIDE_MS  3000    // Slideshow trace: a slide every 3 s
+#define DECODE_MS 400     // taking this long to decode
+#define FADE_MS   1000    // and the LED fading this long after each change
+
+void setUp(void)
+{
+}
+
+void tearDown(void)
+{
+}
+
+// Idle input at nowMs: nothing running, nothing scheduled
+static Power_Input Power_Idle(uint32_t nowMs)
+{
+  Power_Input in = {};
+  in.Now_Ms = nowMs;
+  in.Next_Work_Ms = POWER_NO_WORK;
+  in.Last_Input_Ms = nowMs;
+  return in;
+}
+
+// Advance the trace by what the decision asked for
+static uint32_t Power_Step(const Power_Decision& d)
+{
+  return d.Wait_Ms ? d.Wait_Ms : 1;
+}
+
+/******************************************************************************
+function: Run the slideshow trace through Power_Decide
+parameter:
+    state    : Governor, reset here
+    durMs    : Trace length
+return    : Failures: decode at the idle clock or an idle wait into the next ramp
+******************************************************************************/
+static uint32_t Power_Slideshow(Power_State& state, uint32_t durMs)
+{
+  uint32_t failures = 0;
+  uint32_t lastSlide = 0;
+  Power_Reset(state, 0);
+  for (uint32_t now = 0; now < durMs;) {
+    Power_Input in = Power_Idle(now);
+    in.Last_Input_Ms = 0;
+    uint32_t since = now - lastSlide;
+    if (since >= SLIDE_MS) {
+      lastSlide = now;
+      since = 0;
+    }
+    if (since < DECODE_MS)
+      in.Work |= POWER_WORK_DECODE;
+    if (since < FADE_MS)
+      in.Work |= POWER_WORK_LED;
+    in.Next_Work_Ms = SLIDE_MS - since;
+
+    Power_Decision d = Power_Decide(state, in);
+    if ((in.Work & POWER_WORK_DECODE) && d.Cpu_Mhz != POWER_MHZ_BUSY)
+      failures++;
+    if (d.Cpu_Mhz == POWER_MHZ_IDLE && d.Wait_Ms + POWER_RAMP_MS > in.Next_Work_Ms)
+      failures++;
+    now += Power_Step(d);
+  }
+  return failures;
+}
+
+// Heavy work raises the clock, which drops only POWER_HOLD_MS after it ends
+static void test_clock_follows_work_with_hold(void)
+{
+  Power_State state;
+  Power_Reset(state, 0);
+
+  Power_Input in = Power_Idle(0);
+  in.Work = POWER_WORK_DECODE;
+  TEST_ASSERT_EQUAL_UINT32(POWER_MHZ_BUSY, Power_Decide(state, in).Cpu_Mhz);
+  in.Work = POWER_WORK_UI;
+  in.Now_Ms = 100;
+  TEST_ASSERT_EQUAL_UINT32(POWER_MHZ_BUSY, Power_Decide(state, in).Cpu_Mhz);
+
+  // Work ended at 100 ms: still busy inside the hold, idle once it is over
+  in = Power_Idle(100 + POWER_HOLD_MS - 1);
+  TEST_ASSERT_EQUAL_UINT32(POWER_MHZ_BUSY, Power_Decide(state, in).Cpu_Mhz);
+  in = Power_Idle(100 + POWER_HOLD_MS);
+  TEST_ASSERT_EQUAL_UINT32(POWER_MHZ_IDLE, Power_Decide(state, in).Cpu_Mhz);
+  TEST_ASSERT_EQUAL_UINT32(1, state.Stats.Clock_Changes);
+
+  // An LED fade alone does not need the high clock
+  in.Now_Ms += POWER_FRAME_MS;
+  in.Work = POWER_WORK_LED;
+  Power_Decision d = Power_Decide(state, in);
+  TEST_ASSERT_EQUAL_UINT32(POWER_MHZ_IDLE, d.Cpu_Mhz);
+  TEST_ASSERT_EQUAL_UINT32(POWER_FRAME_MS, d.Wait_Ms);
+}
+
+// Bursts closer together than POWER_HOLD_MS keep the clock up between them
+static void test_hold_absorbs_bursts(void)
+{
+  Power_State state;
+  Power_Reset(state, 0);
+  for (uint32_t now = 0; now < 20000; now += POWER_FRAME_MS) {
+    Power_Input in = Power_Idle(now);
+    if (now % (POWER_HOLD_MS - 100) < 60)
+      in.Work = POWER_WORK_UI;
+    TEST_ASSERT_EQUAL_UINT32(POWER_MHZ_BUSY, Power_Decide(state, in).Cpu_Mhz);
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, state.Stats.Clock_Changes);
+}
+
+// Scheduled work raises the clock POWER_RAMP_MS ahead of it
+static void test_clock_ramps_before_scheduled_work(void)
+{
+  Power_State state;
+  Power_Reset(state, 0);
+  Power_Input in = Power_Idle(POWER_HOLD_MS);
+  in.Next_Work_Ms = POWER_RAMP_MS + 1;
+  TEST_ASSERT_EQUAL_UINT32(POWER_MHZ_IDLE, Power_Decide(state, in).Cpu_Mhz);
+  in.Now_Ms++;
+  in.Next_Work_Ms = POWER_RAMP_MS;
+  TEST_ASSERT_EQUAL_UINT32(POWER_MHZ_BUSY, Power_Decide(state, in).Cpu_Mhz);
+}
+
+// A BLE command waiting to be applied holds the clock up and the loop fast
+static void test_pending_command_stays_busy(void)
+{
+  Power_State state;
+  Power_Reset(state, 0);
+  for (uint32_t now = 0; now < 60000; now += POWER_FRAME_MS) {
+    Power_Input in = Power_Idle(now);
+    in.Ble_Pending = true;
+    in.Last_Input_Ms = 0;
+    Power_Decision d = Power_Decide(state, in);
+    TEST_ASSERT_EQUAL_UINT32(POWER_FRAME_MS, d.Wait_Ms);
+    TEST_ASSERT_EQUAL_UINT32(POWER_MHZ_BUSY, d.Cpu_Mhz);
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, state.Stats.Idle_Ms);
+}
+
+// The slideshow idles at the low clock between slides without a wait overrunning one
+static void test_slideshow_idles_between_slides(void)
+{
+  Power_State state;
+  TEST_ASSERT_EQUAL_UINT32(0, Power_Slideshow(state, 700000));
+  const Power_Stats& s = state.Stats;
+  uint32_t total = s.Busy_Ms + s.Idle_Ms;
+  // Decode plus hold is (400 + 500) / 3000 of the time; the rest is at the idle clock
+  TEST_ASSERT_UINT32_WITHIN(3, 30, s.Busy_Ms * 100 / total);
+  TEST_ASSERT_GREATER_OR_EQUAL_UINT32(65, s.Idle_Ms * 100 / total);
+  // One raise and one drop per slide
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(2 * (700000 / SLIDE_MS + 1), s.Clock_Changes);
+}
+
+// Idle waits stop POWER_RAMP_MS short of the next work and never exceed POWER_POLL_MS
+static void test_idle_wait_bounds(void)
+{
+  Power_State state;
+  Power_Reset(state, 0);
+  Power_Input in = Power_Idle(POWER_HOLD_MS);
+  in.Next_Work_Ms = POWER_RAMP_MS + 30;
+  TEST_ASSERT_EQUAL_UINT32(30, Power_Decide(state, in).Wait_Ms);
+  in.Now_Ms += 30;
+  in.Next_Work_Ms = POWER_NO_WORK;
+  TEST_ASSERT_EQUAL_UINT32(POWER_POLL_MS, Power_Decide(state, in).Wait_Ms);
+  in.Now_Ms += POWER_POLL_MS;
+  in.Work = POWER_WORK_LED;
+  TEST_ASSERT_EQUAL_UINT32(POWER_FRAME_MS, Power_Decide(state, in).Wait_Ms);
+}
+
+// The backlight steps down with time since the last input
+static void test_backlight_steps(void)
+{
+  Power_State state;
+  Power_Reset(state, 0);
+  Power_Input in = Power_Idle(0);
+  in.Last_Input_Ms = 0;
+  TEST_ASSERT_EQUAL_UINT32(POWER_BACKLIGHT_FULL, Power_Decide(state, in).Backlight);
+  in.Now_Ms = POWER_DIM_AFTER_MS;
+  TEST_ASSERT_EQUAL_UINT32(POWER_BACKLIGHT_DIM, Power_Decide(state, in).Backlight);
+  in.Now_Ms = POWER_NIGHT_AFTER_MS;
+  TEST_ASSERT_EQUAL_UINT32(POWER_BACKLIGHT_NIGHT, Power_Decide(state, in).Backlight);
+  in.Last_Input_Ms = in.Now_Ms;
+  TEST_ASSERT_EQUAL_UINT32(POWER_BACKLIGHT_FULL, Power_Decide(state, in).Backlight);
+}
+
+int main(int argc, char** argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_clock_follows_work_with_hold);
+  RUN_TEST(test_hold_absorbs_bursts);
+  RUN_TEST(test_clock_ramps_before_scheduled_work);
+  RUN_TEST(test_pending_command_stays_busy);
+  RUN_TEST(test_slideshow_idles_between_slides);
+  RUN_TEST(test_idle_wait_bounds);
+  RUN_TEST(test_backlight_steps);
+  return UNITY_END();
+}
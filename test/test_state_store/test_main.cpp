@@ -0,0 +1,130 @@
+#include <unity.h>
+#include <string.h>
+
+#include "State_Store.h"
+
+// Counting fake of the NVS store: one blob, every Save counted
+static uint8_t Fake_Data[sizeof(State_Snapshot)];
+static size_t Fake_Size = 0;
+static uint32_t Fake_Saves = 0;
+
+static bool Fake_Load(void* data, size_t size)
+{
+  if (size != Fake_Size)
+    return false;
+  memcpy(data, Fake_Data, size);
+  return true;
+}
+
+static bool Fake_Save(const void* data, size_t size)
+{
+  memcpy(Fake_Data, data, size);
+  Fake_Size = size;
+  Fake_Saves++;
+  return true;
+}
+
+static const State_KV Fake_KV = { Fake_Load, Fake_Save };
+
+void setUp(void)
+{
+  Fake_Size = 0;
+  Fake_Saves = 0;
+}
+
+void tearDown(void)
+{
+}
+
+// A change on every 20 ms pass of the loop is still at most one Save per interval
+static void test_burst_saves_once_per_interval(void)
+{
+  State_Store store;
+  State_Snapshot restored;
+  TEST_ASSERT_FALSE(State_Begin(store, &Fake_KV, 0, restored));
+
+  State_Snapshot state = {};
+  uint32_t lastSave = 0;
+  uint32_t saves = 0;
+  for (uint32_t now = 0; now < 10 * store.Interval_Ms; now += 20) {
+    state.Image_Index++;
+    state.Red = (uint8_t)now;
+    State_Update(store, state);
+    if (State_Run(store, now)) {
+      TEST_ASSERT_GREATER_OR_EQUAL_UINT32(store.Interval_Ms, now - lastSave);
+      lastSave = now;
+      saves++;
+    }
+  }
+  TEST_ASSERT_EQUAL_UINT32(saves, Fake_Saves);
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(10, Fake_Saves);
+  TEST_ASSERT_GREATER_THAN_UINT32(0, Fake_Saves);
+}
+
+// The last change of a burst is written once the interval is up, then nothing more
+static void test_burst_flushes_last_change(void)
+{
+  State_Store store;
+  State_Snapshot restored;
+  State_Begin(store, &Fake_KV, 0, restored);
+
+  State_Snapshot state = {};
+  for (uint32_t now = 0; now < 1000; now += 20) {
+    state.Green = (uint8_t)now;
+    State_Update(store, state);
+    State_Run(store, now);
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, Fake_Saves);
+  for (uint32_t now = 1000; now < 4 * store.Interval_Ms; now += 20) {
+    State_Update(store, state);
+    State_Run(store, now);
+  }
+  TEST_ASSERT_EQUAL_UINT32(1, Fake_Saves);
+
+  State_Store reloaded;
+  TEST_ASSERT_TRUE(State_Begin(reloaded, &Fake_KV, 0, restored));
+  TEST_ASSERT_EQUAL_UINT8(state.Green, restored.Green);
+}
+
+// A state equal to what flash holds is never dirty and never written
+static void test_clean_state_never_writes(void)
+{
+  State_Snapshot saved = {};
+  saved.Version = STATE_VERSION;
+  saved.Flags = STATE_PHOTO_MODE;
+  saved.Image_Index = 7;
+  Fake_Save(&saved, sizeof(saved));
+  Fake_Saves = 0;
+
+  State_Store store;
+  State_Snapshot restored;
+  TEST_ASSERT_TRUE(State_Begin(store, &Fake_KV, 0, restored));
+  for (uint32_t now = 0; now < 10 * store.Interval_Ms; now += 20) {
+    State_Update(store, restored);
+    TEST_ASSERT_FALSE(store.Dirty);
+    TEST_ASSERT_FALSE(State_Run(store, now));
+  }
+  TEST_ASSERT_EQUAL_UINT32(0, Fake_Saves);
+}
+
+// A blob of another version is ignored at boot
+static void test_other_version_ignored(void)
+{
+  State_Snapshot saved = {};
+  saved.Version = STATE_VERSION + 1;
+  Fake_Save(&saved, sizeof(saved));
+
+  State_Store store;
+  State_Snapshot restored;
+  TEST_ASSERT_FALSE(State_Begin(store, &Fake_KV, 0, restored));
+}
+
+int main(int argc, char** argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_burst_saves_once_per_interval);
+  RUN_TEST(test_burst_flushes_last_change);
+  RUN_TEST(test_clean_state_never_writes);
+  RUN_TEST(test_other_version_ignored);
+  return UNITY_END();
+}
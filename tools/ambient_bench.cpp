@@ -0,0 +1,134 @@
+/*
+ * Host benchmark: cost of the ambient colour histogram against PNG decode.
+ *
+ * Build and run from the repository root (zlib needed):
+ *     g++ -O2 -Iinclude tools/ambient_bench.cpp src/Ambient_Color.cpp src/Pixel_Convert.cpp -lz -o ambient_bench
+ *     ./ambient_bench [runs]
+ *
+ * A 320x172 truecolor photo stand-in (sky gradient over an orange half,
+ * with noise) is Paeth-filtered and deflated as a PNG encoder would. Each
+ * image is then decoded the way PNGdec and pngDraw do it: inflate a row,
+ * undo the filter, convert to panel RGB565. The "ambient" pass also
+ * samples rows exactly as pngDraw does (Ambient_Row / Ambient_Add) between
+ * Ambient_Begin and Ambient_End. The two passes are interleaved and the
+ * best of each is kept, so clock changes hit both alike.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#include <zlib.h>
+
+#include "Ambient_Color.h"
+#include "Pixel_Convert.h"
+
+#define BENCH_WIDTH  320
+#define BENCH_HEIGHT 172
+#define BENCH_IMAGES 50       // Images per timed pass
+
+static std::vector<uint8_t> Bench_Deflated;
+static uint8_t Bench_Rows[2][1 + BENCH_WIDTH * 3];
+static uint16_t Bench_Line[BENCH_WIDTH];
+static volatile uint16_t Bench_Sink;
+
+static uint8_t Bench_Paeth(int a, int b, int c)
+{
+  int p = a + b - c, pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+  return pa <= pb && pa <= pc ? a : pb <= pc ? b : c;
+}
+
+// Photo stand-in, each row prefixed with the Paeth filter type
+static void Bench_Make()
+{
+  std::vector<uint8_t> raw, previous(BENCH_WIDTH * 3, 0), row(BENCH_WIDTH * 3);
+  uint32_t seed = 1;
+  for (int y = 0; y < BENCH_HEIGHT; y++) {
+    for (int x = 0; x < BENCH_WIDTH; x++) {
+      seed = seed * 1103515245 + 12345;
+      int n = (seed >> 16) % 12;
+      uint8_t* p = &row[x * 3];
+      if (y < BENCH_HEIGHT / 3) {
+        p[0] = 40 + y / 2 + n; p[1] = 90 + y / 2 + n; p[2] = 200 + n;
+      } else {
+        p[0] = 230 + n / 2; p[1] = 120 + x / 8 + n; p[2] = 30 + n;
+      }
+    }
+    raw.push_back(4);
+    for (int i = 0; i < BENCH_WIDTH * 3; i++) {
+      int a = i >= 3 ? row[i - 3] : 0, c = i >= 3 ? previous[i - 3] : 0;
+      raw.push_back(row[i] - Bench_Paeth(a, previous[i], c));
+    }
+    previous = row;
+  }
+  uLongf size = compressBound(raw.size());
+  Bench_Deflated.resize(size);
+  compress2(Bench_Deflated.data(), &size, raw.data(), raw.size(), 6);
+  Bench_Deflated.resize(size);
+  printf("image %dx%d, %zu bytes deflated\n", BENCH_WIDTH, BENCH_HEIGHT, Bench_Deflated.size());
+}
+
+// One image through inflate, unfilter and conversion; sampled if ambient
+static void Bench_Decode(bool ambient)
+{
+  z_stream stream = {};
+  inflateInit(&stream);
+  stream.next_in = Bench_Deflated.data();
+  stream.avail_in = Bench_Deflated.size();
+  memset(Bench_Rows, 0, sizeof(Bench_Rows));
+  if (ambient)
+    Ambient_Begin(BENCH_HEIGHT);
+
+  for (int y = 0; y < BENCH_HEIGHT; y++) {
+    uint8_t* row = Bench_Rows[y & 1];
+    const uint8_t* up = Bench_Rows[~y & 1] + 1;
+    stream.next_out = row;
+    stream.avail_out = sizeof(Bench_Rows[0]);
+    while (stream.avail_out)
+      if (inflate(&stream, Z_NO_FLUSH) < 0)
+        exit(1);
+    uint8_t* pixels = row + 1;
+    for (int i = 0; i < BENCH_WIDTH * 3; i++)
+      pixels[i] += Bench_Paeth(i >= 3 ? pixels[i - 3] : 0, up[i], i >= 3 ? up[i - 3] : 0);
+
+    Pixel_Convert_RGB(pixels, 3, Bench_Line, BENCH_WIDTH, y, false);
+    if (ambient && Ambient_Row(y)) {
+      for (int i = 0; i < BENCH_WIDTH; i += AMBIENT_STEP)
+        Ambient_Add((Bench_Line[i] >> 8) | (Bench_Line[i] << 8));
+    }
+    Bench_Sink = Bench_Line[y % BENCH_WIDTH];
+  }
+  inflateEnd(&stream);
+  if (ambient)
+    Ambient_End();
+}
+
+static double Bench_Pass(bool ambient)
+{
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < BENCH_IMAGES; i++)
+    Bench_Decode(ambient);
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / BENCH_IMAGES;
+}
+
+int main(int argc, char** argv)
+{
+  int runs = argc > 1 ? atoi(argv[1]) : 20;
+  Bench_Make();
+  Bench_Pass(false);
+  Bench_Pass(true);
+
+  double plain = 1e30, sampled = 1e30;
+  for (int r = 0; r < runs; r++) {
+    double t = Bench_Pass(false);
+    plain = t < plain ? t : plain;
+    t = Bench_Pass(true);
+    sampled = t < sampled ? t : sampled;
+  }
+  printf("decode %.1f us, with ambient %.1f us, histogram %+.1f%% (best of %d)\n", plain, sampled,
+         (sampled - plain) * 100 / plain, runs);
+  printf("ambient %02x%02x%02x share=%u%% samples=%lu\n", Ambient_Last.Red, Ambient_Last.Green, Ambient_Last.Blue,
+         Ambient_Last.Share, (unsigned long)Ambient_Hist.Samples);
+  return 0;
+}
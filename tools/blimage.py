@@ -0,0 +1,258 @@
+#!/usr/bin/env python3
+"""
+Convert images into the SD card formats understood by the BLELights viewer.
+
+Usage:
+    python tools/blimage.py tile photo.jpg photo.blt [--tile 32]
+    python tools/blimage.py raw photo.jpg photo.565 [--fit]
+    python tools/blimage.py indexed art.png art.p8 [--colors 256] [--dither] [--fit]
+    python tools/blimage.py rle art.png art.rle [--fit]
+    python tools/blimage.py anim loop.gif loop.bla [--fps 15] [--codec rle|raw] [--fit]
+    python tools/blimage.py anim f000.png f001.png ... loop.bla --fps 12
+
+Requires Pillow (pip install pillow).
+"""
+
+import argparse
+import struct
+import sys
+
+from PIL import Image, ImageSequence
+
+
+def rgb565_be(img):
+    """Pack an RGB image into RGB565 pixels in panel (big-endian) byte order."""
+    raw = img.tobytes()
+    out = bytearray(len(raw) // 3 * 2)
+    for i in range(0, len(raw) // 3):
+        r, g, b = raw[3 * i], raw[3 * i + 1], raw[3 * i + 2]
+        v = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3)
+        out[2 * i] = v >> 8
+        out[2 * i + 1] = v & 0xFF
+    return bytes(out)
+
+
+PANEL_W, PANEL_H = 172, 320
+
+
+def fit_panel(img):
+    """Shrink to the panel (portrait, or landscape for wide images), keeping aspect."""
+    w, h = img.size
+    bw, bh = (PANEL_H, PANEL_W) if w > h and w > PANEL_W else (PANEL_W, PANEL_H)
+    scale = min(bw / w, bh / h, 1.0)
+    if scale < 1.0:
+        img = img.resize((max(1, int(w * scale)), max(1, int(h * scale))), Image.LANCZOS)
+    return img
+
+
+def load(args):
+    img = Image.open(args.input).convert("RGB")
+    return fit_panel(img) if getattr(args, "fit", False) else img
+
+
+def cmd_raw(args):
+    img = load(args)
+    w, h = img.size
+    with open(args.output, "wb") as f:
+        f.write(struct.pack("<4sHH", b"B565", w, h))
+        f.write(rgb565_be(img))
+    print("%s: %dx%d RGB565" % (args.output, w, h))
+
+
+def cmd_indexed(args):
+    img = load(args)
+    w, h = img.size
+    dither = Image.Dither.FLOYDSTEINBERG if args.dither else Image.Dither.NONE
+    q = img.quantize(colors=args.colors, method=Image.Quantize.MEDIANCUT, dither=dither)
+    pal = q.getpalette()[: 3 * 256]
+    pal += [0] * (3 * 256 - len(pal))
+    palette = rgb565_be(Image.frombytes("RGB", (256, 1), bytes(pal)))
+    with open(args.output, "wb") as f:
+        f.write(struct.pack("<4sHH", b"BLP8", w, h))
+        f.write(palette)
+        f.write(q.tobytes())
+    print("%s: %dx%d, %d colours" % (args.output, w, h, len(q.getcolors(256) or [])))
+
+
+RLE_STRIP_ROWS = 16
+
+
+def rle_encode(pixels):
+    """Encode panel-order RGB565 bytes with the Frame_Codec.h pixel RLE."""
+    px = [pixels[i:i + 2] for i in range(0, len(pixels), 2)]
+    out = bytearray()
+    literal = []
+
+    def flush():
+        while literal:
+            chunk = literal[:128]
+            del literal[:128]
+            out.append(len(chunk) - 1)
+            for p in chunk:
+                out.extend(p)
+
+    i = 0
+    while i < len(px):
+        run = 1
+        while i + run < len(px) and run < 129 and px[i + run] == px[i]:
+            run += 1
+        if run >= 2:
+            flush()
+            out.append(0x80 + run - 2)
+            out += px[i]
+        else:
+            literal.append(px[i])
+        i += run
+    flush()
+    return bytes(out)
+
+
+def rle_strips(img, strip_rows=RLE_STRIP_ROWS):
+    """Encode an image as independently decodable strips of strip_rows rows."""
+    w, h = img.size
+    return [rle_encode(rgb565_be(img.crop((0, y, w, min(h, y + strip_rows)))))
+            for y in range(0, h, strip_rows)]
+
+
+def cmd_rle(args):
+    img = load(args)
+    w, h = img.size
+    strips = rle_strips(img)
+    header = struct.pack("<4sHHHH", b"BLZ1", w, h, RLE_STRIP_ROWS, len(strips))
+    offset = len(header) + (len(strips) + 1) * 4
+    offsets = []
+    for data in strips:
+        offsets.append(offset)
+        offset += len(data)
+    offsets.append(offset)
+    with open(args.output, "wb") as f:
+        f.write(header)
+        f.write(struct.pack("<%dI" % len(offsets), *offsets))
+        for data in strips:
+            f.write(data)
+    print("%s: %dx%d, %d strips, %d bytes (%.0f%% of raw)" % (args.output, w, h, len(strips), offset,
+                                                             100.0 * offset / (w * h * 2 + 8)))
+
+
+def cmd_anim(args):
+    *inputs, output = args.files
+    if not inputs:
+        sys.exit("anim needs at least one input and an output")
+    frames = []
+    durations = []
+    for name in inputs:
+        for frame in ImageSequence.Iterator(Image.open(name)):
+            durations.append(frame.info.get("duration", 0))
+            frames.append(frame.convert("RGB"))
+    if args.fit:
+        frames = [fit_panel(f) for f in frames]
+    w, h = frames[0].size
+    frames = [f if f.size == (w, h) else f.resize((w, h)) for f in frames]
+
+    fps = args.fps
+    if not fps:
+        avg = sum(durations) / len(durations) if any(durations) else 0
+        fps = max(1, min(60, round(1000 / avg))) if avg else 15
+
+    codec = 1 if args.codec == "rle" else 0
+    blobs = []
+    for f in frames:
+        if codec:
+            blobs.append(b"".join(struct.pack("<H", len(s)) + s for s in rle_strips(f)))
+        else:
+            blobs.append(rgb565_be(f))
+
+    header = struct.pack("<4sHHHHHBx", b"BLA1", w, h, len(frames), fps, RLE_STRIP_ROWS, codec)
+    offset = len(header) + (len(blobs) + 1) * 4
+    offsets = []
+    for data in blobs:
+        offsets.append(offset)
+        offset += len(data)
+    offsets.append(offset)
+    with open(output, "wb") as f:
+        f.write(header)
+        f.write(struct.pack("<%dI" % len(offsets), *offsets))
+        for data in blobs:
+            f.write(data)
+    print("%s: %dx%d, %d frames at %d fps, %s, %d bytes (largest frame %d)" % (
+        output, w, h, len(frames), fps, args.codec, offset, max(len(b) for b in blobs)))
+
+
+def cmd_tile(args):
+    img = Image.open(args.input).convert("RGB")
+    w, h = img.size
+    tw = th = args.tile
+    cols = (w + tw - 1) // tw
+    rows = (h + th - 1) // th
+
+    # Tiled_Header: magic, width, height, tile w/h, cols, rows, codec, reserved
+    header = struct.pack("<4sHHHHHHB3x", b"BLT1", w, h, tw, th, cols, rows, 0)
+    index_size = (cols * rows + 1) * 4
+    offset = len(header) + index_size
+
+    offsets = []
+    tiles = []
+    for ty in range(rows):
+        for tx in range(cols):
+            # Edge tiles are padded with black to the full tile size
+            tile = Image.new("RGB", (tw, th))
+            tile.paste(img.crop((tx * tw, ty * th, min(w, (tx + 1) * tw), min(h, (ty + 1) * th))))
+            data = rgb565_be(tile)
+            offsets.append(offset)
+            tiles.append(data)
+            offset += len(data)
+    offsets.append(offset)
+
+    with open(args.output, "wb") as f:
+        f.write(header)
+        f.write(struct.pack("<%dI" % len(offsets), *offsets))
+        for data in tiles:
+            f.write(data)
+    print("%s: %dx%d, %dx%d tiles of %dx%d, %d bytes" % (args.output, w, h, cols, rows, tw, th, offset))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest="command", required=True)
+
+    p = sub.add_parser("tile", help="tiled RGB565 image (.blt) for pan and zoom")
+    p.add_argument("input")
+    p.add_argument("output")
+    p.add_argument("--tile", type=int, default=32, help="tile edge in pixels (max 64)")
+    p.set_defaults(func=cmd_tile)
+
+    p = sub.add_parser("raw", help="raw RGB565 image (.565)")
+    p.add_argument("input")
+    p.add_argument("output")
+    p.add_argument("--fit", action="store_true", help="shrink to the panel first")
+    p.set_defaults(func=cmd_raw)
+
+    p = sub.add_parser("indexed", help="8-bit palette image (.p8) for art with few colours")
+    p.add_argument("input")
+    p.add_argument("output")
+    p.add_argument("--colors", type=int, default=256, help="palette size, 2..256")
+    p.add_argument("--dither", action="store_true", help="Floyd-Steinberg dither while quantising")
+    p.add_argument("--fit", action="store_true", help="shrink to the panel first")
+    p.set_defaults(func=cmd_indexed)
+
+    p = sub.add_parser("rle", help="run-length compressed RGB565 image (.rle)")
+    p.add_argument("input")
+    p.add_argument("output")
+    p.add_argument("--fit", action="store_true", help="shrink to the panel first")
+    p.set_defaults(func=cmd_rle)
+
+    p = sub.add_parser("anim", help="looping frame sequence (.bla) from a GIF or numbered frames")
+    p.add_argument("files", nargs="+", help="input frames or GIF(s), then the output file")
+    p.add_argument("--fps", type=int, default=0, help="target frame rate (default: from the GIF, else 15)")
+    p.add_argument("--codec", choices=("rle", "raw"), default="rle")
+    p.add_argument("--fit", action="store_true", help="shrink frames to the panel first")
+    p.set_defaults(func=cmd_anim)
+
+    args = parser.parse_args()
+    if getattr(args, "tile", 32) > 64:
+        sys.exit("tile edge must be 64 or less")
+    args.func(args)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,102 @@
+/*
+ * Host benchmark: PNG line conversion with ordered dither against plain truncation.
+ *
+ * Build and run from the repository root:
+ *     g++ -Os -Iinclude tools/dither_bench.cpp src/Pixel_Convert.cpp -o dither_bench
+ *     ./dither_bench [runs]
+ *
+ * Three conversions of the same 320x172 truecolor image are timed,
+ * interleaved, best of each kept:
+ *   old       PNGdec's getLineAsRGB565 loop, then pngDraw's byte swap loop
+ *   truncate  Pixel_Convert_RGB without dither
+ *   dither    Pixel_Convert_RGB with the 4x4 Bayer dither
+ * It then prints how far a 4x4 tile of each flat level lands from that
+ * level on the panel (which shows 5-bit q as q * 255 / 31), averaged over
+ * all 256 levels of the red channel: the banding the dither removes.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+#include "Pixel_Convert.h"
+
+#define BENCH_WIDTH  320
+#define BENCH_HEIGHT 172
+#define BENCH_IMAGES 20       // Images per timed pass
+
+static uint8_t Bench_Image[BENCH_HEIGHT][BENCH_WIDTH * 3];
+static uint16_t Bench_Line[BENCH_WIDTH];
+static volatile uint16_t Bench_Sink;
+
+// What pngDraw did before: PNGdec's big-endian RGB565, then swapped to panel order
+__attribute__((noinline)) static void Bench_Old(const uint8_t* p, uint16_t* out, uint16_t width)
+{
+  for (uint16_t x = 0; x < width; x++, p += 3)
+    out[x] = ((p[0] & 0xF8) << 8) | ((p[1] & 0xFC) << 3) | (p[2] >> 3);
+  for (uint16_t i = 0; i < width; i++)
+    out[i] = ((out[i] >> 8) & 0xFF) | ((out[i] << 8) & 0xFF00);
+}
+
+// Microseconds per image for one pass of the given conversion
+static double Bench_Pass(int mode)
+{
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < BENCH_IMAGES; i++) {
+    for (uint16_t y = 0; y < BENCH_HEIGHT; y++) {
+      if (mode == 0)
+        Bench_Old(Bench_Image[y], Bench_Line, BENCH_WIDTH);
+      else
+        Pixel_Convert_RGB(Bench_Image[y], 3, Bench_Line, BENCH_WIDTH, y, mode == 2);
+      Bench_Sink = Bench_Line[y];
+    }
+  }
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / BENCH_IMAGES;
+}
+
+// Mean distance of a flat level's 4x4 tile from the level, red channel, 8-bit units
+static double Bench_Tile_Error(bool dither)
+{
+  double total = 0;
+  for (int v = 0; v < 256; v++) {
+    uint8_t line[PIXEL_BAYER_SIZE * 3];
+    uint16_t out[PIXEL_BAYER_SIZE];
+    memset(line, v, sizeof(line));
+    double sum = 0;
+    for (uint16_t y = 0; y < PIXEL_BAYER_SIZE; y++) {
+      Pixel_Convert_RGB(line, 3, out, PIXEL_BAYER_SIZE, y, dither);
+      for (uint16_t x = 0; x < PIXEL_BAYER_SIZE; x++)
+        sum += (out[x] & 0xF8) / 8 * 255.0 / 31;
+    }
+    total += fabs(sum / (PIXEL_BAYER_SIZE * PIXEL_BAYER_SIZE) - v);
+  }
+  return total / 256;
+}
+
+int main(int argc, char** argv)
+{
+  static const char* const names[] = { "old", "truncate", "dither" };
+  int runs = argc > 1 ? atoi(argv[1]) : 30;
+  uint32_t seed = 7;
+  for (uint16_t y = 0; y < BENCH_HEIGHT; y++) {
+    for (uint16_t i = 0; i < BENCH_WIDTH * 3; i++) {
+      seed = seed * 1103515245 + 12345;
+      Bench_Image[y][i] = seed >> 16;
+    }
+  }
+
+  double best[3] = { 1e30, 1e30, 1e30 };
+  for (int r = 0; r < runs; r++) {
+    for (int mode = 0; mode < 3; mode++) {
+      double us = Bench_Pass(mode);
+      best[mode] = us < best[mode] ? us : best[mode];
+    }
+  }
+  for (int mode = 0; mode < 3; mode++)
+    printf("%-9s %7.1f us per %dx%d image (%.2fx old)\n", names[mode], best[mode], BENCH_WIDTH, BENCH_HEIGHT,
+           best[mode] / best[0]);
+  printf("tile-mean error: truncate %.2f, dither %.2f (8-bit levels)\n", Bench_Tile_Error(false), Bench_Tile_Error(true));
+  return 0;
+}
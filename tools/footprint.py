@@ -0,0 +1,74 @@
+#!/usr/bin/env python3
+"""
+Report the largest static symbols in the firmware ELF.
+
+Runs after every PlatformIO build (extra_scripts in platformio.ini) and can
+also be run by hand:
+    python tools/footprint.py .pio/build/<env>/firmware.elf [--top 25] [--nm riscv32-esp-elf-nm]
+
+Symbols are split by address into internal RAM (.bss, .data, IRAM code) and
+flash (.text, .rodata); RAM is what limits buffers and caches, so it is
+listed first with a total per type.
+"""
+
+import argparse
+import os
+import subprocess
+import sys
+
+# ESP32-C6 HP SRAM and LP SRAM; everything else is flash-mapped
+RAM_RANGES = [(0x40800000, 0x40880000), (0x50000000, 0x50004000)]
+KINDS = {"b": "bss", "d": "data", "t": "text", "r": "rodata", "v": "data", "w": "text"}
+
+
+def symbols(elf, nm):
+    out = subprocess.run([nm, "--print-size", "--size-sort", "--demangle", elf],
+                         check=True, capture_output=True, text=True).stdout
+    for line in out.splitlines():
+        parts = line.split(None, 3)
+        if len(parts) < 4:
+            continue
+        addr, size, kind, name = int(parts[0], 16), int(parts[1], 16), parts[2], parts[3]
+        ram = any(lo <= addr < hi for lo, hi in RAM_RANGES)
+        yield name, size, KINDS.get(kind.lower(), kind), ram
+
+
+def report(elf, nm, top):
+    syms = list(symbols(elf, nm))
+    print("footprint: %s" % elf)
+    for ram in (True, False):
+        group = sorted((s for s in syms if s[3] == ram), key=lambda s: -s[1])
+        totals = {}
+        for _, size, kind, _ in group:
+            totals[kind] = totals.get(kind, 0) + size
+        print("%s: %s" % ("RAM" if ram else "flash",
+                          ", ".join("%s %d" % kv for kv in sorted(totals.items(), key=lambda kv: -kv[1]))))
+        for name, size, kind, _ in group[:top]:
+            print("  %8d  %-6s %s" % (size, kind, name))
+
+
+try:
+    Import("env")  # noqa: F821 - provided by PlatformIO
+except NameError:
+    env = None
+
+if env is not None:
+    def footprint_after_build(source, target, env):
+        nm = env.subst("$CC").replace("gcc", "nm")
+        os.environ["PATH"] = env["ENV"].get("PATH", os.environ.get("PATH", ""))
+        try:
+            report(str(target[0]), nm, 20)
+        except (OSError, subprocess.CalledProcessError) as e:
+            print("footprint: %s" % e)
+
+    env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", footprint_after_build)
+elif __name__ == "__main__":
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("elf")
+    parser.add_argument("--top", type=int, default=25, help="symbols listed per memory")
+    parser.add_argument("--nm", default="riscv32-esp-elf-nm")
+    args = parser.parse_args()
+    try:
+        report(args.elf, args.nm, args.top)
+    except FileNotFoundError:
+        sys.exit("%s not found, pass --nm" % args.nm)
@@ -0,0 +1,67 @@
+#!/usr/bin/env python3
+"""
+Inspect an LED strip recording written by the host build of LED_Strip.cpp.
+
+Usage:
+    python tools/ledrec.py strip.rec                 frame count and timing
+    python tools/ledrec.py strip.rec --png out.png   one row per frame, one column per LED
+    python tools/ledrec.py strip.rec --mean 0:8      time-averaged output of LEDs 0..7
+
+--mean shows what a dithered level looks like to the eye: a steady colour
+whose gamma-corrected value falls between two output steps should average
+to that value, e.g. 14330 / 65280 * 255 * (brightness + 1) / 256 for 128.
+
+The PNG needs Pillow (pip install pillow).
+"""
+
+import argparse
+import struct
+import sys
+
+
+def read(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    if data[:4] != b"LEDR":
+        sys.exit("%s: not an LED recording" % path)
+    (count,) = struct.unpack_from("<H", data, 4)
+    size = 4 + count * 3
+    frames = []
+    for pos in range(6, len(data) - size + 1, size):
+        (t,) = struct.unpack_from("<I", data, pos)
+        frames.append((t, data[pos + 4:pos + size]))
+    return count, frames
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("recording")
+    parser.add_argument("--png", help="write the frames as an image")
+    parser.add_argument("--mean", metavar="FIRST:LAST", help="average R G B of these LEDs over all frames")
+    args = parser.parse_args()
+
+    count, frames = read(args.recording)
+    print("%d LEDs, %d frames" % (count, len(frames)))
+    if len(frames) > 1:
+        gaps = [b[0] - a[0] for a, b in zip(frames, frames[1:])]
+        span = frames[-1][0] - frames[0][0]
+        print("interval us: min %d mean %d max %d, %.1f fps" % (
+            min(gaps), sum(gaps) // len(gaps), max(gaps), (len(frames) - 1) * 1e6 / span if span else 0))
+
+    if args.mean and frames:
+        first, last = (int(v) for v in args.mean.split(":"))
+        for i in range(first, min(last, count)):
+            g, r, b = (sum(f[3 * i + c] for _, f in frames) / len(frames) for c in range(3))
+            print("LED %d: R %.3f G %.3f B %.3f" % (i, r, g, b))
+
+    if args.png and frames:
+        from PIL import Image
+        img = Image.new("RGB", (count, len(frames)))
+        # Frames are recorded in strip (GRB) order
+        img.putdata([(f[3 * i + 1], f[3 * i], f[3 * i + 2]) for _, f in frames for i in range(count)])
+        img.save(args.png)
+        print("wrote %s" % args.png)
+
+
+if __name__ == "__main__":
+    main()